@@ -8,11 +8,31 @@ TEMPLATE = app
 
 SOURCES +=  \
     main.cpp \
+    tst_appendtest.cpp \
+    tst_asyncruntest.cpp \
+    tst_binaryformattest.cpp \
+    tst_blockverifytest.cpp \
     tst_checkremovedtest.cpp \
+    tst_chunkindextest.cpp \
     tst_cleanhashfiletest.cpp \
+    tst_dryruntest.cpp \
+    tst_eventsinktest.cpp \
+    tst_failfasttest.cpp \
     tst_freshupdatetest.cpp \
+    tst_hashertest.cpp \
     tst_hmacupdatetest.cpp \
+    tst_journaltest.cpp \
+    tst_jsonhashfiletest.cpp \
     tst_partialupdatetest.cpp \
+    tst_progresstest.cpp \
+    tst_quickverifytest.cpp \
+    tst_resultstreamtest.cpp \
+    tst_resumetest.cpp \
+    tst_runstatstest.cpp \
+    tst_scrubtest.cpp \
+    tst_slowfilestest.cpp \
+    tst_synctest.cpp \
+    tst_tracetest.cpp \
     tst_updatemodifiedtest.cpp \
     tst_updatenewtest.cpp \
     tst_verifytest.cpp
@@ -6,6 +6,26 @@
 #include "tst_hmacupdatetest.cpp"
 #include "tst_cleanhashfiletest.cpp"
 #include "tst_checkremovedtest.cpp"
+#include "tst_binaryformattest.cpp"
+#include "tst_journaltest.cpp"
+#include "tst_resumetest.cpp"
+#include "tst_hashertest.cpp"
+#include "tst_appendtest.cpp"
+#include "tst_blockverifytest.cpp"
+#include "tst_chunkindextest.cpp"
+#include "tst_scrubtest.cpp"
+#include "tst_synctest.cpp"
+#include "tst_dryruntest.cpp"
+#include "tst_quickverifytest.cpp"
+#include "tst_failfasttest.cpp"
+#include "tst_asyncruntest.cpp"
+#include "tst_resultstreamtest.cpp"
+#include "tst_eventsinktest.cpp"
+#include "tst_progresstest.cpp"
+#include "tst_runstatstest.cpp"
+#include "tst_tracetest.cpp"
+#include "tst_slowfilestest.cpp"
+#include "tst_jsonhashfiletest.cpp"
 
 int main(int argc, char** argv){
     int status = 0;
@@ -50,5 +70,87 @@ int main(int argc, char** argv){
         status |= QTest::qExec(&test, argc, argv);
     }
 
+    {
+        BinaryFormatTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+
+    {
+        JournalTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ResumeTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        HasherTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        AppendTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        BlockVerifyTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ChunkIndexTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ScrubTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        SyncTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        DryRunTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        QuickVerifyTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        FailFastTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        AsyncRunTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ResultStreamTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        EventSinkTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        ProgressTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        RunStatsTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        TraceTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        SlowFilesTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+    {
+        JsonHashFileTest test;
+        status |= QTest::qExec(&test, argc, argv);
+    }
+
     return status;
 }
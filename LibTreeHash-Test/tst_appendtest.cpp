@@ -0,0 +1,137 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test updating files which only grew by hashing the appended data
+class AppendTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString dataFile;
+    QString hashFile;
+    QByteArray content;
+    int mtimeOffset = 0;
+
+public:
+    AppendTest(){}
+    ~AppendTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        dataFile = dir.filePath("data/log.txt");
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        content.resize(200 * 1024);
+        for(qsizetype i = 0; i < content.size(); i++)
+            content[i] = static_cast<char>(i * 13 + i / 251);
+        writeData(content, false);
+    }
+
+    void keepHashState(){
+        runUpdate(RunMode::UPDATE);
+
+        const QJsonObject entry = loadEntry();
+        QCOMPARE(entry.value("size").toInteger(-1), content.size());
+        QVERIFY2(!entry.value("hashState").toString().isEmpty(), "hash-state was not stored");
+        QVERIFY2(!entry.value("tailFingerprint").toString().isEmpty(), "tail-fingerprint was not stored");
+        QCOMPARE(entry.value("hash").toString(), expectedHash());
+    }
+
+    void appendedData(){
+        const QByteArray appended(70 * 1024, 'a');
+        content.append(appended);
+        writeData(appended, true);
+
+        runUpdate(RunMode::UPDATE_MODIFIED);
+
+        const QJsonObject entry = loadEntry();
+        QCOMPARE(entry.value("size").toInteger(-1), content.size());
+        QCOMPARE(entry.value("hash").toString(), expectedHash());
+    }
+
+    void onlyAppendedDataIsHashed(){
+        // a change before the fingerprinted tail is not detected -> the hash must differ from a full rehash
+        content[10] = static_cast<char>(content[10] + 1);
+        content.append("more data\n");
+        writeData(content, false);
+
+        runUpdate(RunMode::UPDATE_MODIFIED);
+        QVERIFY2(loadEntry().value("hash").toString() != expectedHash(), "the whole file was hashed");
+
+        // rehash everything to get a correct entry for the next test
+        runUpdate(RunMode::UPDATE);
+        QCOMPARE(loadEntry().value("hash").toString(), expectedHash());
+    }
+
+    void changedTail(){
+        // the last hashed bytes changed -> the whole file has to be hashed
+        content[content.size() - 5] = 'X';
+        content.append("appended\n");
+        writeData(content, false);
+
+        runUpdate(RunMode::UPDATE_MODIFIED);
+        QCOMPARE(loadEntry().value("hash").toString(), expectedHash());
+    }
+
+private:
+    void writeData(const QByteArray& data, bool append){
+        QFile file(dataFile);
+        QVERIFY(file.open(append ? QFile::OpenModeFlag::Append : QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(data), data.size());
+
+        // UPDATE_MODIFIED compares the mtime in seconds
+        mtimeOffset += 10;
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(mtimeOffset), QFileDevice::FileTime::FileModificationTime));
+    }
+
+    void runUpdate(RunMode mode){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(mode);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setHashStateMinSize(0);
+            treeHash.setFiles({dataFile});
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    QJsonObject loadEntry(){
+        QFile file(hashFile);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return QJsonDocument::fromJson(file.readAll()).object().value("files").toObject().value("data/log.txt").toObject();
+    }
+
+    QString expectedHash(){
+        return QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Algorithm::Keccak_512).toHex());
+    }
+};
+
+#include "tst_appendtest.moc"
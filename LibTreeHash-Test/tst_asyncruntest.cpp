@@ -0,0 +1,98 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <atomic>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test controlling a run in the background
+class AsyncRunTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    AsyncRunTest(){}
+    ~AsyncRunTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 3; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(QByteArray(1024, 'a' + i)) > 0);
+            files.append(path);
+        }
+    }
+
+    void pauseAndResume(){
+        std::atomic<int> processed(0);
+        EventListener listener = createListener(processed);
+
+        LibTreeHash treeHash(listener);
+        setup(treeHash, RunMode::UPDATE);
+
+        treeHash.pause();
+        RunHandle handle = treeHash.runAsync();
+        QVERIFY(handle.isPaused());
+        QVERIFY(!handle.waitFor(std::chrono::milliseconds(300)));
+        QCOMPARE(processed.load(), 0);
+
+        handle.resume();
+        QVERIFY(!handle.isPaused());
+        handle.wait();
+        QVERIFY(handle.isFinished());
+        QCOMPARE(processed.load(), 3);
+        QVERIFY(!treeHash.wasInterrupted());
+    }
+
+    void cancelPaused(){
+        std::atomic<int> processed(0);
+        EventListener listener = createListener(processed);
+
+        LibTreeHash treeHash(listener);
+        setup(treeHash, RunMode::VERIFY);
+
+        treeHash.pause();
+        RunHandle handle = treeHash.runAsync();
+        handle.cancel();
+        QVERIFY(handle.waitFor(std::chrono::seconds(10)));
+        handle.wait();
+        QVERIFY(treeHash.wasInterrupted());
+        QVERIFY(processed.load() < 3);
+    }
+
+private:
+    EventListener createListener(std::atomic<int>& processed){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [&processed](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+            processed++;
+        };
+        return listener;
+    }
+
+    void setup(LibTreeHash& treeHash, RunMode mode){
+        treeHash.setMode(mode);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+    }
+};
+
+#include "tst_asyncruntest.moc"
@@ -0,0 +1,153 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <sys/stat.h>
+
+#include "testfiles.h"
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test conversion between JSON and binary hash-files (and compact JSON)
+class BinaryFormatTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestFiles files;
+
+public:
+    BinaryFormatTest(){}
+    ~BinaryFormatTest(){}
+
+private slots:
+    void initTestCase(){
+        files.setup(true, false, false);
+    }
+
+    void cleanupTestCase(){
+        files.cleanup();
+    }
+
+    void convertToBinary(){
+        convert(HashFileFormat::BINARY);
+
+        QFile hashFile(files.getD1ExpectedFilePath());
+        QVERIFY(hashFile.open(QFile::OpenModeFlag::ReadOnly));
+        QVERIFY2(hashFile.read(8) == "TREEHASH", "hash-file was not written in binary format");
+    }
+
+    void verifyBinary(){
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+
+        LibTreeHash treeHash(listener);
+
+        QStringList paths = listAllFilesInDir(files.getD1Data().path(), false, false);
+
+        try{
+            treeHash.setMode(RunMode::VERIFY);
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(files.getD1ExpectedFilePath());
+            treeHash.setFiles(paths);
+
+            QVERIFY(treeHash.getHashFileFormat() == HashFileFormat::BINARY);
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    void convertToJson(){
+        convert(HashFileFormat::JSON);
+
+        QFile expectedJsonFile(":testfiles/d1-expected.json");
+        expectedJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject expectedJson = QJsonDocument::fromJson(expectedJsonFile.readAll()).object();
+
+        QFile actualJsonFile(files.getD1ExpectedFilePath());
+        actualJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject actualJson = QJsonDocument::fromJson(actualJsonFile.readAll()).object();
+
+        QString cmp = TestFiles::compareHashFiles(actualJson, expectedJson);
+        QVERIFY2(cmp.isNull(),
+                 QString("converted hash-file did not contain the expected content (%1)").arg(cmp).toStdString().c_str());
+    }
+
+    void convertToCompactJson(){
+        convert(HashFileFormat::JSON, true);
+
+        QFile expectedJsonFile(":testfiles/d1-expected.json");
+        expectedJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject expectedJson = QJsonDocument::fromJson(expectedJsonFile.readAll()).object();
+
+        QFile actualJsonFile(files.getD1ExpectedFilePath());
+        actualJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QByteArray actualData = actualJsonFile.readAll();
+        QVERIFY2(!actualData.contains('\n'), "hash-file was not written compact");
+        QJsonObject actualJson = QJsonDocument::fromJson(actualData).object();
+
+        QString cmp = TestFiles::compareHashFiles(actualJson, expectedJson);
+        QVERIFY2(cmp.isNull(),
+                 QString("converted hash-file did not contain the expected content (%1)").arg(cmp).toStdString().c_str());
+    }
+
+    void reopenAfterSave(){
+        LibTreeHash treeHash(failingListener());
+
+        try{
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(files.getD1ExpectedFilePath());
+            treeHash.saveHashFile();
+            treeHash.saveHashFile();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        // the save replaced the file -> the devices must refer to the new one
+        struct stat onDisk, src, dst;
+        QCOMPARE(stat(QFile::encodeName(files.getD1ExpectedFilePath()).constData(), &onDisk), 0);
+        QCOMPARE(fstat(treeHash.getHashesFileSrc().handle(), &src), 0);
+        QCOMPARE(src.st_ino, onDisk.st_ino);
+        if(treeHash.getHashesFileDst().isOpen()){
+            QCOMPARE(fstat(treeHash.getHashesFileDst().handle(), &dst), 0);
+            QCOMPARE(dst.st_ino, onDisk.st_ino);
+        }
+    }
+
+private:
+    EventListener failingListener(){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(false, ("treeHash reported a process file: " + path).toStdString().c_str());
+        };
+        return listener;
+    }
+
+    void convert(HashFileFormat format, bool compact = false){
+        LibTreeHash treeHash(failingListener());
+
+        try{
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(files.getD1ExpectedFilePath());
+            treeHash.setHashFileFormat(format);
+            treeHash.setCompactHashFile(compact);
+            treeHash.saveHashFile();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+};
+
+#include "tst_binaryformattest.moc"
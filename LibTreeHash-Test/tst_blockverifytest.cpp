@@ -0,0 +1,171 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test verifying files (or samples of them) by their block-hashes
+class BlockVerifyTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr qint64 BLOCK_SIZE = 4096;
+
+    QTemporaryDir dir;
+    QString dataFile;
+    QString hashFile;
+    QByteArray content;
+    QList<std::pair<qint64, qint64>> corruptRanges;
+    bool processed = false;
+    SampleCoverage coverage;
+
+public:
+    BlockVerifyTest(){}
+    ~BlockVerifyTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        dataFile = dir.filePath("data/big.bin");
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        // the last block is incomplete
+        content.resize(10 * BLOCK_SIZE + 123);
+        for(qsizetype i = 0; i < content.size(); i++)
+            content[i] = static_cast<char>(i * 17 + i / 509);
+        writeData();
+    }
+
+    void storeBlockHashes(){
+        run(RunMode::UPDATE, 1);
+
+        const QJsonObject entry = loadEntry();
+        QCOMPARE(entry.value("blockSize").toInteger(-1), BLOCK_SIZE);
+        QCOMPARE(entry.value("size").toInteger(-1), content.size());
+        // 11 blocks of Keccak_512 digests (hex)
+        QCOMPARE(entry.value("blockHashes").toString().size(), 11 * 64 * 2);
+    }
+
+    void verifyParallel(){
+        run(RunMode::VERIFY, 4);
+        QVERIFY2(processed, "file did not match");
+        QVERIFY(corruptRanges.isEmpty());
+    }
+
+    void corruptBlocks(){
+        // one byte in block 2 and the blocks 5 and 6 -> two ranges
+        content[2 * BLOCK_SIZE + 100] = static_cast<char>(content[2 * BLOCK_SIZE + 100] + 1);
+        content[6 * BLOCK_SIZE - 1] = static_cast<char>(content[6 * BLOCK_SIZE - 1] + 1);
+        content[6 * BLOCK_SIZE] = static_cast<char>(content[6 * BLOCK_SIZE] + 1);
+        writeData();
+
+        run(RunMode::VERIFY, 3);
+        QVERIFY(!processed);
+        QCOMPARE(corruptRanges.size(), 2);
+        QCOMPARE(corruptRanges[0], std::make_pair(2 * BLOCK_SIZE, BLOCK_SIZE));
+        QCOMPARE(corruptRanges[1], std::make_pair(5 * BLOCK_SIZE, 2 * BLOCK_SIZE));
+    }
+
+    void corruptLastBlock(){
+        run(RunMode::UPDATE, 1);
+
+        content[content.size() - 1] = 'X';
+        writeData();
+
+        run(RunMode::VERIFY, 2);
+        QVERIFY(!processed);
+        QCOMPARE(corruptRanges.size(), 1);
+        QCOMPARE(corruptRanges[0], std::make_pair(10 * BLOCK_SIZE, qint64(123)));
+    }
+
+    void fullCoverage(){
+        run(RunMode::VERIFY, 1);
+        QCOMPARE(coverage.totalBytes, content.size());
+        QCOMPARE(coverage.checkedBytes, content.size());
+        QCOMPARE(coverage.sampledFiles, 0);
+    }
+
+    void sampledVerify(){
+        run(RunMode::UPDATE, 1);
+
+        // every block is corrupt -> exactly the checked ones are reported
+        for(qsizetype i = 0; i < content.size(); i += BLOCK_SIZE)
+            content[i] = static_cast<char>(content[i] + 1);
+        writeData();
+
+        run(RunMode::VERIFY, 2, 0.3, 42);
+        QVERIFY(!processed);
+        QCOMPARE(coverage.totalBytes, content.size());
+        QCOMPARE(coverage.sampledFiles, 1);
+        QVERIFY(coverage.checkedBytes >= 3 * BLOCK_SIZE);
+        QVERIFY(coverage.checkedBytes < content.size());
+
+        qint64 reported = 0;
+        for(const auto& range : corruptRanges)
+            reported += range.second;
+        QCOMPARE(reported, coverage.checkedBytes);
+
+        // the same seed checks the same blocks
+        const QList<std::pair<qint64, qint64>> ranges = corruptRanges;
+        run(RunMode::VERIFY, 3, 0.3, 42);
+        QCOMPARE(corruptRanges, ranges);
+    }
+
+private:
+    void writeData(){
+        QFile file(dataFile);
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(content), content.size());
+    }
+
+    void run(RunMode mode, int threads, double sampleRate = 1.0, quint64 seed = 0){
+        corruptRanges.clear();
+        processed = false;
+
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [this](QString path, bool success) -> void{
+            processed = success;
+        };
+        listener.onCorruptRange = [this](QString path, qint64 offset, qint64 length) -> void{
+            QCOMPARE(path, dataFile);
+            corruptRanges.append(std::make_pair(offset, length));
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(mode);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setBlockSize(BLOCK_SIZE);
+            treeHash.setThreadCount(threads);
+            treeHash.setSampleRate(sampleRate, seed);
+            treeHash.setFiles({dataFile});
+
+            treeHash.run();
+            coverage = treeHash.getSampleCoverage();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    QJsonObject loadEntry(){
+        QFile file(hashFile);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return QJsonDocument::fromJson(file.readAll()).object().value("files").toObject().value("data/big.bin").toObject();
+    }
+};
+
+#include "tst_blockverifytest.moc"
@@ -63,6 +63,56 @@ private slots:
         }
     }
 
+    void probeForRemovedFiles(){
+        QString root = files.getD1Data().path();
+        QString hashfile = files.getD1ExpectedFilePath();
+
+        TreeHash::EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(false, ("treeHash reported a process file: " + path).toStdString().c_str());
+        };
+
+        TreeHash::LibTreeHash treeHash(listener);
+
+        try {
+            treeHash.setHashesFilePath(hashfile);
+            treeHash.setRootDir(root);
+            QStringList missing = treeHash.probeForRemovedFiles();
+
+            QVERIFY(missing.size() == 1);
+            QVERIFY(missing.at(0) == "d1/d2/f3.dat");
+        } catch (...) {
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    void chooseStrategyForCoveredTree(){
+        // the hash-file lists every file of the tree -> probing can not be cheaper than walking
+        QString root = files.getD1Data().path();
+        QString hashfile = files.getD1ExpectedFilePath();
+
+        TreeHash::EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+
+        TreeHash::LibTreeHash treeHash(listener);
+
+        try {
+            treeHash.setHashesFilePath(hashfile);
+            treeHash.setRootDir(root);
+            QVERIFY(treeHash.chooseRemovedFilesStrategy() == TreeHash::RemovedFilesStrategy::WALK_TREE);
+        } catch (...) {
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
 };
 
 #include "tst_checkremovedtest.moc"
@@ -0,0 +1,145 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test the content-defined chunk-list and the reported changes of modified files
+class ChunkIndexTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr qint64 CHUNK_SIZE = 4096;
+
+    QTemporaryDir dir;
+    QString dataFile;
+    QString hashFile;
+    QByteArray content;
+    int mtimeOffset = 0;
+    qint64 changedChunks = -1, chunkCount = -1, changedBytes = -1;
+
+public:
+    ChunkIndexTest(){}
+    ~ChunkIndexTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        dataFile = dir.filePath("data/disk.img");
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        // the chunk-boundaries need non-repeating data
+        content.resize(1024 * 1024);
+        quint32 rnd = 12345;
+        for(qsizetype i = 0; i < content.size(); i++){
+            rnd = rnd * 1103515245 + 12345;
+            content[i] = static_cast<char>(rnd >> 24);
+        }
+        writeData();
+    }
+
+    void storeChunks(){
+        runUpdate(RunMode::UPDATE);
+
+        const QJsonObject entry = loadEntry();
+        QCOMPARE(entry.value("chunkSize").toInteger(-1), CHUNK_SIZE);
+        QCOMPARE(entry.value("size").toInteger(-1), content.size());
+
+        // the chunks cover the whole file
+        const QByteArray chunks = QByteArray::fromHex(entry.value("chunks").toString().toLatin1());
+        QVERIFY(chunks.size() % 20 == 0);
+        qint64 sum = 0;
+        for(qsizetype i = 0; i < chunks.size(); i += 20)
+            sum += qFromLittleEndian<quint32>(chunks.constData() + i);
+        QCOMPARE(sum, content.size());
+        QVERIFY(chunks.size() / 20 > content.size() / CHUNK_SIZE / 2);
+    }
+
+    void reportChanges(){
+        // an insertion shifts the following data but only changes the chunks around it
+        content.insert(content.size() / 2, "inserted data");
+        content[content.size() / 5] = static_cast<char>(content[content.size() / 5] + 1);
+        writeData();
+
+        runUpdate(RunMode::UPDATE_MODIFIED);
+
+        QCOMPARE(loadEntry().value("hash").toString(), expectedHash());
+        QCOMPARE(chunkCount, QByteArray::fromHex(loadEntry().value("chunks").toString().toLatin1()).size() / 20);
+        QVERIFY2(changedChunks >= 2 && changedChunks <= 8, QString("%1 chunks changed").arg(changedChunks).toStdString().c_str());
+        QVERIFY(changedBytes < content.size() / 8);
+    }
+
+    void noChanges(){
+        // only the mtime changed
+        writeData();
+
+        runUpdate(RunMode::UPDATE_MODIFIED);
+        QCOMPARE(changedChunks, 0);
+        QCOMPARE(changedBytes, 0);
+    }
+
+private:
+    void writeData(){
+        QFile file(dataFile);
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(content), content.size());
+
+        // UPDATE_MODIFIED compares the mtime in seconds
+        mtimeOffset += 10;
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(mtimeOffset), QFileDevice::FileTime::FileModificationTime));
+    }
+
+    void runUpdate(RunMode mode){
+        changedChunks = chunkCount = changedBytes = -1;
+
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+        listener.onChunkChanges = [this](QString path, qint64 changed, qint64 count, qint64 bytes) -> void{
+            changedChunks = changed;
+            chunkCount = count;
+            changedBytes = bytes;
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(mode);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setChunkSize(CHUNK_SIZE);
+            treeHash.setFiles({dataFile});
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    QJsonObject loadEntry(){
+        QFile file(hashFile);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return QJsonDocument::fromJson(file.readAll()).object().value("files").toObject().value("data/disk.img").toObject();
+    }
+
+    QString expectedHash(){
+        return QString::fromLatin1(QCryptographicHash::hash(content, QCryptographicHash::Algorithm::Keccak_512).toHex());
+    }
+};
+
+#include "tst_chunkindextest.moc"
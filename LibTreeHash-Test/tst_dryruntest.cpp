@@ -0,0 +1,114 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDateTime>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test classifying the files by their metadata before (or instead of) reading them
+class DryRunTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    DryRunTest(){}
+    ~DryRunTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        writeFile("data/unchanged.txt", "unchanged", 0);
+        writeFile("data/resized.txt", "old content", 0);
+        files = {dir.filePath("data/unchanged.txt"), dir.filePath("data/resized.txt")};
+
+        LibTreeHash treeHash = createTreeHash(RunMode::UPDATE, EventListener());
+        treeHash.run();
+
+        writeFile("data/resized.txt", "new and longer content", 10);
+        writeFile("data/new.txt", "new", 10);
+        files.append(dir.filePath("data/new.txt"));
+        files.append(dir.filePath("data/not-existing.txt"));
+    }
+
+    void plan(){
+        RunPlan plan = createTreeHash(RunMode::VERIFY, EventListener()).dryRun();
+        QCOMPARE(plan.hashFiles, 1);
+        QCOMPARE(plan.hashBytes, 9);
+        QCOMPARE(plan.sizeMismatches, 1);
+        QCOMPARE(plan.missingEntries, 1);
+        QCOMPARE(plan.invalidFiles, 1);
+
+        plan = createTreeHash(RunMode::UPDATE_MODIFIED, EventListener()).dryRun();
+        QCOMPARE(plan.hashFiles, 1);
+        QCOMPARE(plan.hashBytes, 22);
+        QCOMPARE(plan.skippedFiles, 1);
+        QCOMPARE(plan.skippedBytes, 9);
+        QCOMPARE(plan.missingEntries, 1);
+
+        plan = createTreeHash(RunMode::UPDATE_NEW, EventListener()).dryRun();
+        QCOMPARE(plan.hashFiles, 1);
+        QCOMPARE(plan.hashBytes, 3);
+        QCOMPARE(plan.skippedFiles, 2);
+
+        plan = createTreeHash(RunMode::UPDATE, EventListener()).dryRun();
+        QCOMPARE(plan.hashFiles, 3);
+        QCOMPARE(plan.hashBytes, 34);
+        QCOMPARE(plan.invalidFiles, 1);
+    }
+
+    void verifyFailsOnSize(){
+        bool resizedFailed = false;
+        QString warning;
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [&warning](QString msg, QString path) -> void{
+            if(path.endsWith("data/resized.txt"))
+                warning = msg;
+        };
+        listener.onFileProcessed = [&resizedFailed](QString path, bool success) -> void{
+            if(path.endsWith("data/resized.txt"))
+                resizedFailed = !success;
+            else if(path.endsWith("data/unchanged.txt"))
+                QVERIFY2(success, "expected success");
+        };
+
+        LibTreeHash treeHash = createTreeHash(RunMode::VERIFY, listener);
+        treeHash.run();
+        QVERIFY2(resizedFailed, "file with changed size did not fail");
+        QCOMPARE(warning, QString("size of file differs from the stored one (22 instead of 11 bytes)"));
+    }
+
+private:
+    void writeFile(const QString& relPath, const QByteArray& data, int mtimeOffset){
+        QFile file(dir.filePath(relPath));
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(data), data.size());
+
+        // UPDATE_MODIFIED compares the mtime in seconds
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(mtimeOffset), QFileDevice::FileTime::FileModificationTime));
+    }
+
+    LibTreeHash createTreeHash(RunMode mode, const EventListener& listener){
+        LibTreeHash treeHash(listener);
+        treeHash.setMode(mode);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        return treeHash;
+    }
+};
+
+#include "tst_dryruntest.moc"
@@ -0,0 +1,111 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test delivering the events in batches
+class EventSinkTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    class CollectingSink : public EventSink{
+    public:
+        unsigned wanted;
+        std::vector<size_t> batches;
+        std::vector<Event> events;
+
+        CollectingSink(unsigned wanted) : wanted(wanted) {}
+
+        unsigned wantedEvents() const override{
+            return this->wanted;
+        }
+
+        void onEvents(std::span<const Event> events) override{
+            this->batches.push_back(events.size());
+            this->events.insert(this->events.end(), events.begin(), events.end());
+        }
+    };
+
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    EventSinkTest(){}
+    ~EventSinkTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 5; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write("content") > 0);
+            files.append(path);
+        }
+        files.append(dir.filePath("data/not-existing.txt"));
+    }
+
+    void batches(){
+        const auto sink = std::make_shared<CollectingSink>(static_cast<unsigned>(EventType::FILE_PROCESSED)
+                                                           | static_cast<unsigned>(EventType::WARNING));
+        int processed = 0;
+        EventListener listener;
+        listener.onFileProcessed = [&processed](QString path, bool success) -> void{
+            processed++;
+        };
+
+        LibTreeHash treeHash(listener);
+        setup(treeHash);
+        treeHash.setEventSink(sink, 2);
+        treeHash.run();
+
+        // the listener is still called
+        QCOMPARE(processed, 6);
+
+        QCOMPARE(sink->batches, std::vector<size_t>({2, 2, 2, 1}));
+        int fileEvents = 0, warnings = 0;
+        for(const Event& event : sink->events){
+            if(event.type == EventType::FILE_PROCESSED){
+                QCOMPARE(event.success, !event.path.endsWith("not-existing.txt"));
+                fileEvents++;
+            }else{
+                QCOMPARE(event.type, EventType::WARNING);
+                QCOMPARE(event.path, files.last());
+                warnings++;
+            }
+        }
+        QCOMPARE(fileEvents, 6);
+        QCOMPARE(warnings, 1);
+    }
+
+    void unwanted(){
+        const auto sink = std::make_shared<CollectingSink>(static_cast<unsigned>(EventType::ERROR));
+
+        LibTreeHash treeHash(EventListener::VOID_EVENT_LISTENER);
+        setup(treeHash);
+        treeHash.setEventSink(sink);
+        treeHash.run();
+
+        QVERIFY(sink->batches.empty());
+    }
+
+private:
+    void setup(LibTreeHash& treeHash){
+        treeHash.setMode(RunMode::UPDATE);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+    }
+};
+
+#include "tst_eventsinktest.moc"
@@ -0,0 +1,96 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test stopping VERIFY at the first mismatch
+class FailFastTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    FailFastTest(){}
+    ~FailFastTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 3; i++){
+            files.append(dir.filePath(QString("data/f%1.txt").arg(i)));
+            writeFile(files.last(), "content");
+        }
+
+        EventListener listener;
+        LibTreeHash treeHash(listener);
+        treeHash.setMode(RunMode::UPDATE);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        treeHash.run();
+
+        // same size, other content
+        writeFile(files[0], "CONTENT");
+        writeFile(files[1], "CONTENT");
+    }
+
+    void allFiles(){
+        int processed = 0;
+        bool stopped = true;
+        runVerify(false, processed, stopped);
+        QCOMPARE(processed, 3);
+        QVERIFY(!stopped);
+    }
+
+    void failFast(){
+        int processed = 0;
+        bool stopped = false;
+        runVerify(true, processed, stopped);
+        QCOMPARE(processed, 1);
+        QVERIFY(stopped);
+    }
+
+private:
+    void writeFile(const QString& path, const QByteArray& data){
+        QFile file(path);
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(data), data.size());
+    }
+
+    void runVerify(bool failFast, int& processed, bool& stopped){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [&processed](QString path, bool success) -> void{
+            processed++;
+        };
+
+        LibTreeHash treeHash(listener);
+        try{
+            treeHash.setMode(RunMode::VERIFY);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setFiles(files);
+            treeHash.setFailFast(failFast);
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+        stopped = treeHash.wasStoppedOnFailure();
+    }
+};
+
+#include "tst_failfasttest.moc"
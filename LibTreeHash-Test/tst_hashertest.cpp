@@ -0,0 +1,120 @@
+#include <QtTest>
+
+#include <QCryptographicHash>
+#include <QMessageAuthenticationCode>
+
+#include "hasher.h"
+
+using namespace TreeHash;
+
+/// test the resumable hash-functions against QCryptographicHash
+class HasherTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QByteArray data;
+
+public:
+    HasherTest(){}
+    ~HasherTest(){}
+
+private slots:
+    void initTestCase(){
+        data.resize(5000);
+        for(qsizetype i = 0; i < data.size(); i++)
+            data[i] = static_cast<char>(i * 7 + 3);
+    }
+
+    void keccakEmpty(){
+        std::unique_ptr<Hasher> hasher = Hasher::create(QCryptographicHash::Algorithm::Keccak_512);
+        QCOMPARE(hasher->result().toHex(), QByteArray("0eab42de4c3ceb9235fc91acffe746b29c29a8c366b7c60e4e67c466f36a4304"
+                                                      "c00fa9caf9d87976ba469bcbe06713b435f091ef2769fb160cdab33d3670680e"));
+    }
+
+    void matchesQt_data(){
+        QTest::addColumn<QCryptographicHash::Algorithm>("algorithm");
+        QTest::addColumn<QByteArray>("key");
+
+        const QList<QCryptographicHash::Algorithm> algorithms = {
+            QCryptographicHash::Algorithm::Sha224, QCryptographicHash::Algorithm::Sha256,
+            QCryptographicHash::Algorithm::Sha384, QCryptographicHash::Algorithm::Sha512,
+            QCryptographicHash::Algorithm::Keccak_224, QCryptographicHash::Algorithm::Keccak_256,
+            QCryptographicHash::Algorithm::Keccak_384, QCryptographicHash::Algorithm::Keccak_512,
+            QCryptographicHash::Algorithm::Sha3_224, QCryptographicHash::Algorithm::Sha3_256,
+            QCryptographicHash::Algorithm::Sha3_384, QCryptographicHash::Algorithm::Sha3_512,
+            QCryptographicHash::Algorithm::Blake2b_160, QCryptographicHash::Algorithm::Blake2b_256,
+            QCryptographicHash::Algorithm::Blake2b_384, QCryptographicHash::Algorithm::Blake2b_512,
+            QCryptographicHash::Algorithm::Md5
+        };
+        const QMetaEnum algorithmEnum = QMetaEnum::fromType<QCryptographicHash::Algorithm>();
+        for(QCryptographicHash::Algorithm alg : algorithms){
+            QTest::newRow(algorithmEnum.valueToKey(alg)) << alg << QByteArray();
+            QTest::newRow((QByteArray(algorithmEnum.valueToKey(alg)) + " HMAC").constData()) << alg << QByteArray("key");
+            QTest::newRow((QByteArray(algorithmEnum.valueToKey(alg)) + " HMAC long key").constData()) << alg << QByteArray(200, 'k');
+        }
+    }
+
+    void matchesQt(){
+        QFETCH(QCryptographicHash::Algorithm, algorithm);
+        QFETCH(QByteArray, key);
+
+        // lengths around the block-sizes of all algorithms
+        for(qsizetype len : {0, 1, 55, 56, 64, 71, 72, 73, 104, 111, 112, 128, 129, 136, 144, 145, 1000, 5000}){
+            const QByteArray input = data.left(len);
+
+            QByteArray expected;
+            if(key.isEmpty()){
+                expected = QCryptographicHash::hash(input, algorithm);
+            }else{
+                QMessageAuthenticationCode mac(algorithm, key);
+                mac.addData(input);
+                expected = mac.result();
+            }
+
+            std::unique_ptr<Hasher> hasher = Hasher::create(algorithm, key);
+            hasher->addData(input.constData(), static_cast<size_t>(len));
+            QVERIFY2(hasher->result() == expected, QString("digest differs (length %1)").arg(len).toStdString().c_str());
+        }
+    }
+
+    void resume_data(){
+        matchesQt_data();
+    }
+
+    void resume(){
+        QFETCH(QCryptographicHash::Algorithm, algorithm);
+        QFETCH(QByteArray, key);
+
+        std::unique_ptr<Hasher> expectedHasher = Hasher::create(algorithm, key);
+        expectedHasher->addData(data.constData(), static_cast<size_t>(data.size()));
+        const QByteArray expected = expectedHasher->result();
+
+        std::unique_ptr<Hasher> hasher = Hasher::create(algorithm, key);
+        if(!hasher->isResumable()){
+            QVERIFY(hasher->saveState().isEmpty());
+            return;
+        }
+
+        // save and restore the state after every chunk
+        size_t pos = 0, chunk = 1;
+        while(pos < static_cast<size_t>(data.size())){
+            const size_t n = std::min(chunk, static_cast<size_t>(data.size()) - pos);
+            hasher->addData(data.constData() + pos, n);
+            pos += n;
+            chunk = chunk * 3 + 1;
+
+            const QByteArray state = hasher->saveState();
+            hasher = Hasher::create(algorithm, key);
+            QVERIFY(hasher->restoreState(state));
+        }
+        QCOMPARE(hasher->result(), expected);
+
+        // a state of another algorithm must be rejected
+        std::unique_ptr<Hasher> other = Hasher::create(algorithm == QCryptographicHash::Algorithm::Sha256
+                                                           ? QCryptographicHash::Algorithm::Sha512 : QCryptographicHash::Algorithm::Sha256);
+        QVERIFY(!other->restoreState(Hasher::create(algorithm, key)->saveState()));
+    }
+};
+
+#include "tst_hashertest.moc"
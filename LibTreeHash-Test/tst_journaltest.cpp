@@ -0,0 +1,211 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+
+#include <sys/stat.h>
+#include <unistd.h>
+
+#include "testfiles.h"
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test saving changes to the journal and folding it into the hash-file
+class JournalTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestFiles files;
+
+public:
+    JournalTest(){}
+    ~JournalTest(){}
+
+private slots:
+    void initTestCase(){
+        files.setup(false, true, false);
+    }
+
+    void cleanupTestCase(){
+        files.cleanup();
+    }
+
+    void updateToJournal(){
+        QDir dataDir = files.getD1FalseData();
+        QString hashFile = files.getD1FalseMissingHashPath();
+        QByteArray originalContent = readFile(hashFile);
+
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(RunMode::UPDATE_NEW);
+            treeHash.setRootDir(dataDir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(true);
+            treeHash.setFiles(listAllFilesInDir(dataDir.path(), false, false));
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QVERIFY2(readFile(hashFile) == originalContent, "hash-file was rewritten");
+        QVERIFY2(QFileInfo(hashFile + ".journal").size() > 12, "journal contains no records");
+    }
+
+    void verifyWithJournal(){
+        // the journal must be applied on load
+        verifyAll();
+    }
+
+    void verifyWithTornJournal(){
+        // simulate a crash while appending
+        QFile journal(files.getD1FalseMissingHashPath() + ".journal");
+        QVERIFY(journal.open(QFile::OpenModeFlag::Append));
+        journal.write(QByteArray("\x20\x00\x00\x00\x11\x22", 6));
+        journal.close();
+
+        verifyAll();
+    }
+
+    void compactJournal(){
+        QString hashFile = files.getD1FalseMissingHashPath();
+
+        LibTreeHash treeHash(failingListener());
+
+        try{
+            treeHash.setRootDir(files.getD1FalseData().path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(true);
+            treeHash.compactJournal();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QCOMPARE(QFileInfo(hashFile + ".journal").size(), qint64(12));
+        compareWithExpected(hashFile);
+    }
+
+    void inPlaceSaveAfterCompaction(){
+        QString hashFile = files.getD1FalseMissingHashPath();
+        QString hashDir = QFileInfo(hashFile).absolutePath();
+
+        LibTreeHash treeHash(failingListener());
+
+        try{
+            treeHash.setRootDir(files.getD1FalseData().path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(true);
+            treeHash.compactJournal();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        // the compaction replaced the file -> the devices must refer to the new one
+        struct stat onDisk, src;
+        QCOMPARE(stat(QFile::encodeName(hashFile).constData(), &onDisk), 0);
+        QCOMPARE(fstat(treeHash.getHashesFileSrc().handle(), &src), 0);
+        QCOMPARE(src.st_ino, onDisk.st_ino);
+
+        // the compacted journal is empty; removing it lets the save below succeed in a read-only dir
+        treeHash.setJournalEnabled(false);
+        QVERIFY(QFile::remove(hashFile + ".journal"));
+
+        // a read-only dir makes the save rewrite the file in place
+        const QFile::Permissions dirPermissions = QFile::permissions(hashDir);
+        QVERIFY(QFile::setPermissions(hashDir, QFile::Permission::ReadOwner | QFile::Permission::ExeOwner));
+        if(access(QFile::encodeName(hashDir).constData(), W_OK) == 0){
+            QFile::setPermissions(hashDir, dirPermissions);
+            QSKIP("the dir stays writeable for this user");
+        }
+
+        try{
+            treeHash.setCompactHashFile(true);
+            treeHash.saveHashFile();
+        }catch(...){
+            QFile::setPermissions(hashDir, dirPermissions);
+            QVERIFY2(false, "treeHash threw exception");
+        }
+        QVERIFY(QFile::setPermissions(hashDir, dirPermissions));
+
+        QVERIFY2(!readFile(hashFile).contains('\n'), "the save did not reach the hash-file");
+        compareWithExpected(hashFile);
+    }
+
+    void fullSaveRemovesJournal(){
+        QString hashFile = files.getD1FalseMissingHashPath();
+
+        LibTreeHash treeHash(failingListener());
+
+        try{
+            treeHash.setRootDir(files.getD1FalseData().path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.saveHashFile();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QVERIFY2(!QFileInfo::exists(hashFile + ".journal"), "journal was not removed");
+        compareWithExpected(hashFile);
+    }
+
+private:
+    EventListener failingListener(){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(false, ("treeHash reported a process file: " + path).toStdString().c_str());
+        };
+        return listener;
+    }
+
+    void verifyAll(){
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(RunMode::VERIFY);
+            treeHash.setRootDir(files.getD1FalseData().path());
+            treeHash.setHashesFilePath(files.getD1FalseMissingHashPath());
+            treeHash.setFiles(listAllFilesInDir(files.getD1FalseData().path(), false, false));
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    void compareWithExpected(const QString& hashFile){
+        QJsonObject expectedJson = QJsonDocument::fromJson(readFile(files.getD1FalseExpectedHashPath())).object();
+        QJsonObject actualJson = QJsonDocument::fromJson(readFile(hashFile)).object();
+
+        QString cmp = TestFiles::compareHashFiles(actualJson, expectedJson);
+        QVERIFY2(cmp.isNull(),
+                 QString("hash-file did not contain the expected content (%1)").arg(cmp).toStdString().c_str());
+    }
+
+    static QByteArray readFile(const QString& path){
+        QFile file(path);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return file.readAll();
+    }
+};
+
+#include "tst_journaltest.moc"
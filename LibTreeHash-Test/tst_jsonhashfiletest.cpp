@@ -0,0 +1,178 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "jsonhashfile.h"
+#include "libtreehash.h"
+
+using namespace TreeHash;
+using namespace nlohmann;
+
+/// test loading JSON hash-files which are not in the layout written by this library
+class JsonHashFileTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    int fileCount = 0;
+
+public:
+    JsonHashFileTest(){}
+    ~JsonHashFileTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+    }
+
+    void reorderedKeys(){
+        json settings;
+        QString error;
+        const auto entries = load(R"({"version": ")" + version() + R"(", "settings": {"hashAlgorithm": "Sha256"},
+                                     "files": {"a": {"lastModified": 1, "hash": "00ff"}}})", settings, &error);
+        QVERIFY2(entries != nullptr, error.toStdString().c_str());
+        QCOMPARE(entries->size(), size_t(1));
+        QCOMPARE(entries->entry(0).path, std::string_view("a"));
+        QCOMPARE(entries->entry(0).hash.toByteArray(), QByteArray::fromHex("00ff"));
+        QCOMPARE(entries->entry(0).lastModified, qint64(1));
+        QVERIFY(settings.value("hashAlgorithm", "") == "Sha256");
+    }
+
+    void repeatedKey(){
+        json settings;
+        QString error;
+        // like in a DOM the last value wins
+        const auto entries = load(R"({"files": {"a": {"hash": "00"}}, "files": {"b": {"hash": "11"}},
+                                     "settings": {"x": 1}, "settings": {"x": 2, "y": [1, {"z": 3}], "y": [4]},
+                                     "version": ")" + version() + "\"}", settings, &error);
+        QVERIFY2(entries != nullptr, error.toStdString().c_str());
+        QCOMPARE(entries->size(), size_t(1));
+        QCOMPARE(entries->entry(0).path, std::string_view("b"));
+        QCOMPARE(settings, json::parse(R"({"x": 2, "y": [4]})"));
+    }
+
+    void unknownKeys(){
+        json settings;
+        QString error;
+        const auto entries = load(R"({"files": {"a": {"hash": "00ff", "comment": [1, {"b": [2]}], "lastModified": 5}},
+                                     "extra": {"files": {"c": {"hash": "22"}}}, "more": [{"settings": 1}],
+                                     "settings": {"s": {"nested": [true, null, 1.5]}}, "version": ")" + version() + "\"}",
+                                  settings, &error);
+        QVERIFY2(entries != nullptr, error.toStdString().c_str());
+        QCOMPARE(entries->size(), size_t(1));
+        QCOMPARE(entries->entry(0).path, std::string_view("a"));
+        QCOMPARE(entries->entry(0).hash.toByteArray(), QByteArray::fromHex("00ff"));
+        QCOMPARE(entries->entry(0).lastModified, qint64(5));
+        QCOMPARE(settings, json::parse(R"({"s": {"nested": [true, null, 1.5]}})"));
+    }
+
+    void emptyFile(){
+        json settings = json::object();
+        QString error("unset");
+        const auto entries = load(QByteArray(), settings, &error);
+        QVERIFY(entries != nullptr);
+        QCOMPARE(entries->size(), size_t(0));
+        QVERIFY(settings.is_null());
+        QVERIFY(error.isNull());
+    }
+
+    void wrongVersion(){
+        json settings;
+        QString error;
+        QVERIFY(load(R"({"files": {}, "settings": {}, "version": "1.0"})", settings, &error) == nullptr);
+        QVERIFY(!error.isEmpty());
+
+        QVERIFY(load(R"({"files": {}, "settings": {}, "version": 2})", settings, &error) == nullptr);
+        QVERIFY(load(R"({"files": {}, "settings": {}})", settings, &error) == nullptr);
+    }
+
+    void nanosecondTimes(){
+        // as written by an update (times in ns since epoch have 19 digits)
+        json settings;
+        QString error;
+        bool fastPath = false;
+        const auto entries = load(R"({"files": {"a": {"ctimeNs": 1760000000123456789, "hash": "00ff", "inode": 1234,
+                                     "lastModified": 1760000000, "mtimeNs": 1760000000987654321, "size": 10}},
+                                     "settings": {}, "version": ")" + version() + "\"}", settings, &error, &fastPath);
+        QVERIFY2(entries != nullptr, error.toStdString().c_str());
+        QVERIFY(fastPath);
+        QCOMPARE(entries->entry(0).mtimeNs, qint64(1760000000987654321));
+        QCOMPARE(entries->entry(0).ctimeNs, qint64(1760000000123456789));
+
+        // the biggest value still fits, a bigger one falls back to the generic parser
+        load(R"({"files": {"a": {"hash": "00", "mtimeNs": 9223372036854775807}}, "version": ")" + version() + "\"}",
+             settings, &error, &fastPath);
+        QVERIFY(fastPath);
+        load(R"({"files": {"a": {"hash": "00", "mtimeNs": 9223372036854775808}}, "version": ")" + version() + "\"}",
+             settings, &error, &fastPath);
+        QVERIFY(!fastPath);
+    }
+
+    void fallback_data(){
+        QTest::addColumn<QByteArray>("content");
+
+        QTest::newRow("escaped path") << QByteArray(R"({"files": {"dir\/a": {"hash": "00ff", "lastModified": 1, "size": 10},
+                                                    "z": {"hash": "11", "lastModified": 2}}, "settings": {"k": "v"}, "version": ")")
+                                             + version() + "\"}";
+        QTest::newRow("float lastModified") << QByteArray(R"({"files": {"dir/a": {"hash": "00ff", "lastModified": 1.0, "size": 10},
+                                                          "z": {"hash": "11", "lastModified": 2}}, "settings": {"k": "v"}, "version": ")")
+                                                   + version() + "\"}";
+        QTest::newRow("unknown entry key") << QByteArray(R"({"files": {"dir/a": {"hash": "00ff", "lastModified": 1, "size": 10},
+                                                         "z": {"comment": "x", "hash": "11", "lastModified": 2}}, "settings": {"k": "v"}, "version": ")")
+                                                  + version() + "\"}";
+        QTest::newRow("settings first") << QByteArray(R"({"settings": {"k": "v"}, "files": {"dir/a": {"hash": "00ff", "lastModified": 1, "size": 10},
+                                                      "z": {"hash": "11", "lastModified": 2}}, "version": ")")
+                                               + version() + "\"}";
+    }
+
+    void fallback(){
+        QFETCH(QByteArray, content);
+
+        json expectedSettings, settings;
+        QString error;
+        bool fastPath = false;
+        const auto expected = load(R"({"files": {"dir/a": {"hash": "00ff", "lastModified": 1, "size": 10},
+                                      "z": {"hash": "11", "lastModified": 2}}, "settings": {"k": "v"}, "version": ")" + version() + "\"}",
+                                   expectedSettings, &error, &fastPath);
+        QVERIFY2(expected != nullptr, error.toStdString().c_str());
+        QVERIFY(fastPath);
+
+        const auto entries = load(content, settings, &error, &fastPath);
+        QVERIFY2(entries != nullptr, error.toStdString().c_str());
+        QVERIFY(!fastPath);
+        QCOMPARE(settings, expectedSettings);
+        compareEntries(*entries, *expected);
+    }
+
+private:
+    static void compareEntries(const HashTable& actual, const HashTable& expected){
+        QCOMPARE(actual.size(), expected.size());
+        for(size_t i = 0; i < expected.size(); i++){
+            const EntryView a = actual.entry(i), e = expected.entry(i);
+            QCOMPARE(a.path, e.path);
+            QCOMPARE(a.hash.toByteArray(), e.hash.toByteArray());
+            QCOMPARE(a.lastModified, e.lastModified);
+            QCOMPARE(a.size, e.size);
+            QCOMPARE(a.mtimeNs, e.mtimeNs);
+            QCOMPARE(a.ctimeNs, e.ctimeNs);
+            QCOMPARE(a.inode, e.inode);
+        }
+    }
+
+    static QByteArray version(){
+        return QByteArray::fromStdString(LibTreeHash::FILE_VERSION);
+    }
+
+    std::shared_ptr<const HashTable> load(const QByteArray& content, json& settings, QString* error, bool* fastPath = nullptr){
+        QFile file(dir.filePath(QString("hashes%1.json").arg(fileCount++)));
+        if(!file.open(QFile::OpenModeFlag::ReadWrite) || file.write(content) != content.size() || !file.seek(0)){
+            *error = "unable to write hash-file";
+            return nullptr;
+        }
+        return JsonHashFile::load(file, settings, error, fastPath);
+    }
+};
+
+#include "tst_jsonhashfiletest.moc"
@@ -0,0 +1,88 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test reporting the progress of a run
+class ProgressTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr qint64 BIG_FILE_SIZE = 3 * 1024 * 1024;
+
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    ProgressTest(){}
+    ~ProgressTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        writeFile("data/small.txt", QByteArray(100, 's'));
+        writeFile("data/big.bin", QByteArray(BIG_FILE_SIZE, 'b'));
+        files.append(dir.filePath("data/not-existing.txt"));
+    }
+
+    void progress(){
+        std::vector<Progress> reports;
+        EventListener listener;
+        listener.onProgress = [&reports](const Progress& progress) -> void{
+            reports.push_back(progress);
+        };
+
+        LibTreeHash treeHash(listener);
+        treeHash.setMode(RunMode::UPDATE);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        treeHash.setProgressInterval(0);
+        treeHash.run();
+
+        QVERIFY(reports.size() >= 2);
+        const Progress& first = reports.front();
+        QCOMPARE(first.totalFiles, 3);
+        QCOMPARE(first.totalBytes, BIG_FILE_SIZE + 100);
+        QCOMPARE(first.processedFiles, 0);
+        QCOMPARE(first.processedBytes, 0);
+
+        // the big file is read in several parts -> some reports are in the middle of it
+        bool inFile = false;
+        for(const Progress& report : reports){
+            if(report.processedBytes > 100 && report.processedBytes < BIG_FILE_SIZE)
+                inFile = true;
+        }
+        QVERIFY2(inFile, "no progress was reported while the big file was read");
+
+        const Progress& last = reports.back();
+        QCOMPARE(last.processedFiles, 3);
+        QCOMPARE(last.processedBytes, last.totalBytes);
+        QVERIFY(last.etaSeconds <= 0);
+        QCOMPARE(last.devices.size(), size_t(1));
+        QCOMPARE(last.devices[0].readBytes, BIG_FILE_SIZE + 100);
+
+        const Progress polled = treeHash.getProgress();
+        QCOMPARE(polled.processedFiles, last.processedFiles);
+        QCOMPARE(polled.processedBytes, last.processedBytes);
+    }
+
+private:
+    void writeFile(const QString& relPath, const QByteArray& data){
+        QFile file(dir.filePath(relPath));
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(data), data.size());
+        files.append(file.fileName());
+    }
+};
+
+#include "tst_progresstest.moc"
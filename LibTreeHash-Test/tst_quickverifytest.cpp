@@ -0,0 +1,111 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDateTime>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test checking the files only by their metadata
+class QuickVerifyTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    QuickVerifyTest(){}
+    ~QuickVerifyTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(const QString name : {"a.txt", "b.txt", "c.txt"}){
+            const QString path = dir.filePath("data/" + name);
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(name.toUtf8()) > 0);
+            files.append(path);
+        }
+
+        EventListener listener;
+        LibTreeHash treeHash(listener);
+        treeHash.setMode(RunMode::UPDATE);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        treeHash.run();
+    }
+
+    void unchanged(){
+        QCOMPARE(runQuickVerify(false), QStringList());
+    }
+
+    void suspect(){
+        // same content but another mtime -> suspect
+        QFile file(dir.filePath("data/a.txt"));
+        QVERIFY(file.open(QFile::OpenModeFlag::ReadWrite));
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(100), QFileDevice::FileTime::FileModificationTime));
+        file.close();
+
+        int warnings = 0;
+        QCOMPARE(runQuickVerify(false, &warnings), QStringList({"a.txt"}));
+        QCOMPARE(warnings, 1);
+
+        // the content is unchanged -> the escalated check succeeds
+        QCOMPARE(runQuickVerify(true), QStringList());
+    }
+
+    void changedSize(){
+        QFile file(dir.filePath("data/b.txt"));
+        QVERIFY(file.open(QFile::OpenModeFlag::Append));
+        QVERIFY(file.write("more") > 0);
+        file.close();
+
+        QCOMPARE(runQuickVerify(true), QStringList({"b.txt"}));
+    }
+
+private:
+    /**
+     * @return the names of the files which failed
+     */
+    QStringList runQuickVerify(bool escalate, int* warnings = nullptr){
+        QStringList failed;
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [warnings](QString msg, QString path) -> void{
+            if(warnings != nullptr)
+                (*warnings)++;
+        };
+        listener.onFileProcessed = [&failed](QString path, bool success) -> void{
+            if(!success)
+                failed.append(QFileInfo(path).fileName());
+        };
+
+        LibTreeHash treeHash(listener);
+        try{
+            treeHash.setMode(RunMode::VERIFY_QUICK);
+            treeHash.setEscalateSuspects(escalate);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setFiles(files);
+
+            treeHash.run();
+        }catch(...){
+            failed.append("treeHash threw exception");
+        }
+        return failed;
+    }
+};
+
+#include "tst_quickverifytest.moc"
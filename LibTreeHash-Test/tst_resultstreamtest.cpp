@@ -0,0 +1,115 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QCryptographicHash>
+#include <atomic>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test consuming the results of a run at the own pace
+class ResultStreamTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    ResultStreamTest(){}
+    ~ResultStreamTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 5; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(content(i)) > 0);
+            files.append(path);
+        }
+    }
+
+    void results(){
+        std::atomic<int> processed(0);
+        LibTreeHash treeHash(createListener(processed));
+        setup(treeHash, RunMode::UPDATE);
+
+        int i = 0;
+        for(const FileResult& result : treeHash.results()){
+            QCOMPARE(result.path, files[i]);
+            QVERIFY(result.success);
+            QCOMPARE(result.digest, QCryptographicHash::hash(content(i), QCryptographicHash::Algorithm::Keccak_512));
+            QCOMPARE(result.bytes, content(i).size());
+            QVERIFY(result.duration.count() >= 0);
+            i++;
+        }
+        QCOMPARE(i, 5);
+        QCOMPARE(processed.load(), 5);
+    }
+
+    void backpressure(){
+        std::atomic<int> processed(0);
+        LibTreeHash treeHash(createListener(processed));
+        setup(treeHash, RunMode::VERIFY);
+
+        ResultStream stream = treeHash.results(1);
+        QVERIFY(!stream.handle().waitFor(std::chrono::milliseconds(300)));
+        // one result is buffered and the run waits with the next one
+        QCOMPARE(processed.load(), 2);
+
+        int count = 0;
+        for(const FileResult& result : stream){
+            QVERIFY(result.success);
+            count++;
+        }
+        QCOMPARE(count, 5);
+    }
+
+    void stopConsuming(){
+        std::atomic<int> processed(0);
+        LibTreeHash treeHash(createListener(processed));
+        setup(treeHash, RunMode::VERIFY);
+
+        {
+            ResultStream stream = treeHash.results(1);
+            ResultStream::Iterator iter = stream.begin();
+            QVERIFY(iter != stream.end());
+        }
+        QVERIFY(treeHash.wasInterrupted());
+        QVERIFY(processed.load() < 5);
+    }
+
+private:
+    QByteArray content(int i){
+        return QByteArray(100 * (i + 1), 'a' + i);
+    }
+
+    EventListener createListener(std::atomic<int>& processed){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [&processed](QString path, bool success) -> void{
+            processed++;
+        };
+        return listener;
+    }
+
+    void setup(LibTreeHash& treeHash, RunMode mode){
+        treeHash.setMode(mode);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+    }
+};
+
+#include "tst_resultstreamtest.moc"
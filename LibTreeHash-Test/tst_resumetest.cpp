@@ -0,0 +1,155 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+
+#include "testfiles.h"
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test interrupting an update and resuming it
+class ResumeTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    TestFiles files;
+    QString hashFile;
+
+public:
+    ResumeTest(){}
+    ~ResumeTest(){}
+
+private slots:
+    void initTestCase(){
+        files.setup(true, false, false);
+        hashFile = files.getD1Hashes().path() + "/resume.json";
+    }
+
+    void cleanupTestCase(){
+        files.cleanup();
+    }
+
+    void interruptUpdate(){
+        LibTreeHash* treeHashPtr = nullptr;
+        int processed = 0;
+
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [&treeHashPtr, &processed](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+            processed++;
+            treeHashPtr->requestStop();
+        };
+
+        LibTreeHash treeHash(listener);
+        treeHashPtr = &treeHash;
+
+        try{
+            treeHash.setMode(RunMode::UPDATE);
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(true);
+            treeHash.setFiles(listAllFilesInDir(files.getD1Data().path(), false, false));
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QVERIFY2(treeHash.wasInterrupted(), "run was not interrupted");
+        QCOMPARE(processed, 1);
+    }
+
+    void resumeUpdate(){
+        int processed = 0;
+
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [&processed](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+            processed++;
+        };
+
+        LibTreeHash treeHash(listener);
+        const QStringList paths = listAllFilesInDir(files.getD1Data().path(), false, false);
+
+        try{
+            treeHash.setMode(RunMode::UPDATE);
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(true);
+            treeHash.setResume(true);
+            treeHash.setFiles(paths);
+
+            treeHash.run();
+            treeHash.compactJournal();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QVERIFY2(!treeHash.wasInterrupted(), "run was interrupted");
+        QCOMPARE(processed, static_cast<int>(paths.size()) - 1);
+
+        QFile expectedJsonFile(":testfiles/d1-expected.json");
+        expectedJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject expectedJson = QJsonDocument::fromJson(expectedJsonFile.readAll()).object();
+
+        QFile actualJsonFile(hashFile);
+        actualJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject actualJson = QJsonDocument::fromJson(actualJsonFile.readAll()).object();
+
+        QString cmp = TestFiles::compareHashFiles(actualJson, expectedJson);
+        QVERIFY2(cmp.isNull(),
+                 QString("resumed hash-file did not contain the expected content (%1)").arg(cmp).toStdString().c_str());
+    }
+
+    void checkpointWithoutJournal(){
+        // every file exceeds the size-limit -> the hash-file is saved after each one
+        const QString checkpointFile = files.getD1Hashes().path() + "/checkpoint.json";
+        LibTreeHash* treeHashPtr = nullptr;
+
+        EventListener listener = failingListener();
+        listener.onFileProcessed = [&treeHashPtr](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+            treeHashPtr->requestStop();
+        };
+
+        LibTreeHash treeHash(listener, false);
+        treeHashPtr = &treeHash;
+
+        try{
+            treeHash.setMode(RunMode::UPDATE);
+            treeHash.setRootDir(files.getD1Data().path());
+            treeHash.setHashesFilePath(checkpointFile);
+            treeHash.setCheckpointInterval(0, 1);
+            treeHash.setFiles(listAllFilesInDir(files.getD1Data().path(), false, false));
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+
+        QFile actualJsonFile(checkpointFile);
+        actualJsonFile.open(QFile::OpenModeFlag::ReadOnly);
+        QJsonObject actualJson = QJsonDocument::fromJson(actualJsonFile.readAll()).object();
+        QCOMPARE(actualJson.value("files").toObject().count(), qsizetype(1));
+    }
+
+private:
+    EventListener failingListener(){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(false, ("treeHash reported a process file: " + path).toStdString().c_str());
+        };
+        return listener;
+    }
+};
+
+#include "tst_resumetest.moc"
@@ -0,0 +1,84 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test measuring the stages of a run
+class RunStatsTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+
+public:
+    RunStatsTest(){}
+    ~RunStatsTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 3; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(QByteArray(1000, 'a' + i)) > 0);
+            files.append(path);
+        }
+    }
+
+    void update(){
+        const RunStats stats = run(RunMode::UPDATE, true);
+        QCOMPARE(stats.files, 3);
+        QCOMPARE(stats.readFiles, 3);
+        QCOMPARE(stats.skippedFiles, 0);
+        QCOMPARE(stats.readBytes, 3000);
+        QCOMPARE(stats.plan.calls, 3);
+        QCOMPARE(stats.open.calls, 3);
+        QVERIFY(stats.read.calls >= 3);
+        QVERIFY(stats.hash.calls >= 3);
+        QVERIFY(stats.save.calls >= 1);
+        QCOMPARE(stats.total.calls, 1);
+        QVERIFY(stats.total.nanoseconds > 0);
+    }
+
+    void skipped(){
+        const RunStats stats = run(RunMode::UPDATE_NEW, true);
+        QCOMPARE(stats.files, 3);
+        QCOMPARE(stats.readFiles, 0);
+        QCOMPARE(stats.skippedFiles, 3);
+        QCOMPARE(stats.readBytes, 0);
+        QCOMPARE(stats.open.calls, 0);
+        // the hash-file was loaded before the run
+        QCOMPARE(stats.load.calls, 1);
+    }
+
+    void disabled(){
+        const RunStats stats = run(RunMode::VERIFY, false);
+        QCOMPARE(stats.readFiles, 3);
+        QCOMPARE(stats.read.calls, 0);
+        QCOMPARE(stats.total.nanoseconds, 0);
+    }
+
+private:
+    RunStats run(RunMode mode, bool collect){
+        LibTreeHash treeHash(EventListener::VOID_EVENT_LISTENER);
+        treeHash.setMode(mode);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        treeHash.setCollectStats(collect);
+        return treeHash.run();
+    }
+};
+
+#include "tst_runstatstest.moc"
@@ -0,0 +1,144 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test VERIFY with a budget which continues with the files which were not verified for the longest time
+class ScrubTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    static constexpr qint64 FILE_SIZE = 1024;
+    static constexpr int FILE_COUNT = 6;
+
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+    QStringList processed;
+    bool budgetExhausted = false;
+
+public:
+    ScrubTest(){}
+    ~ScrubTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+
+        for(int i = 0; i < FILE_COUNT; i++){
+            files.append(dir.filePath(QString("file%1.bin").arg(i)));
+            QFile file(files.last());
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QCOMPARE(file.write(QByteArray(FILE_SIZE, static_cast<char>('a' + i))), FILE_SIZE);
+        }
+
+        run(RunMode::UPDATE, false);
+    }
+
+    void recordVerified(){
+        run(RunMode::VERIFY, false, 2 * FILE_SIZE);
+        QVERIFY(budgetExhausted);
+        QCOMPARE(processed.size(), 2);
+
+        // the verified files have a lastVerified
+        const QJsonObject entries = loadEntries();
+        int verified = 0;
+        for(const QString& key : entries.keys()){
+            if(entries.value(key).toObject().contains("lastVerified")){
+                QVERIFY(processed.contains(dir.filePath(key)));
+                verified++;
+            }
+        }
+        QCOMPARE(verified, 2);
+    }
+
+    void continueWithOldest(){
+        // the files of the last test were verified -> the others go first
+        QStringList all = processed;
+        run(RunMode::VERIFY, false, 2 * FILE_SIZE);
+        all.append(processed);
+        run(RunMode::VERIFY, false, 2 * FILE_SIZE);
+        all.append(processed);
+
+        all.removeDuplicates();
+        QCOMPARE(all.size(), FILE_COUNT);
+
+        // everything was verified within the budget
+        run(RunMode::VERIFY, false, 0);
+        QVERIFY(!budgetExhausted);
+        QCOMPARE(processed.size(), FILE_COUNT);
+    }
+
+    void journalOnly(){
+        // start with files which were never verified (lastVerified has only a resolution of seconds)
+        run(RunMode::UPDATE, false);
+
+        QFile file(hashFile);
+        QVERIFY(file.open(QFile::OpenModeFlag::ReadOnly));
+        const QByteArray before = file.readAll();
+        file.close();
+
+        QStringList all;
+        for(int i = 0; i < FILE_COUNT / 2; i++){
+            run(RunMode::VERIFY, true, 2 * FILE_SIZE);
+            QCOMPARE(processed.size(), 2);
+            all.append(processed);
+        }
+        all.removeDuplicates();
+        QCOMPARE(all.size(), FILE_COUNT);
+
+        // only the journal was written
+        QVERIFY(file.open(QFile::OpenModeFlag::ReadOnly));
+        QCOMPARE(file.readAll(), before);
+        QVERIFY(QFile::exists(hashFile + ".journal"));
+    }
+
+private:
+    void run(RunMode mode, bool journal, qint64 budgetBytes = 0){
+        processed.clear();
+
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [this](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+            processed.append(path);
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(mode);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setJournalEnabled(journal);
+            treeHash.setRecordVerified(true);
+            treeHash.setVerifyBudget(0, budgetBytes);
+            treeHash.setFiles(files);
+
+            treeHash.run();
+            budgetExhausted = treeHash.wasBudgetExhausted();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    QJsonObject loadEntries(){
+        QFile file(hashFile);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return QJsonDocument::fromJson(file.readAll()).object().value("files").toObject();
+    }
+};
+
+#include "tst_scrubtest.moc"
@@ -0,0 +1,130 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+
+#include <algorithm>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test reporting the slowest files of a run
+class SlowFilesTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QStringList files;
+    QStringList bigFiles;
+
+public:
+    SlowFilesTest(){}
+    ~SlowFilesTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 3; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(QByteArray(1000 * (i + 1), 'a' + i)) > 0);
+            files.append(path);
+        }
+
+        // large enough to take part in the straggler detection
+        QVERIFY(QDir(dir.path()).mkdir("big"));
+        for(int i = 0; i < 4; i++){
+            const QString path = dir.filePath(QString("big/f%1.bin").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(QByteArray((i + 1) * 1024 * 1024, 'a' + i)) > 0);
+            bigFiles.append(path);
+        }
+    }
+
+    void disabled(){
+        std::vector<FileTiming> slowest, stragglers;
+        run(0, slowest, stragglers);
+        QVERIFY(slowest.empty());
+        QVERIFY(stragglers.empty());
+    }
+
+    void slowest(){
+        std::vector<FileTiming> slowest, stragglers;
+        run(2, slowest, stragglers);
+        QCOMPARE(slowest.size(), size_t(2));
+        QVERIFY(slowest[0].duration >= slowest[1].duration);
+        for(const FileTiming& timing : slowest){
+            QVERIFY(files.contains(timing.path));
+            QCOMPARE(timing.bytes, QFileInfo(timing.path).size());
+            QVERIFY(!timing.device.isEmpty());
+        }
+        // the files are too small to be stragglers
+        QVERIFY(stragglers.empty());
+    }
+
+    void moreThanFiles(){
+        std::vector<FileTiming> slowest, stragglers;
+        run(10, slowest, stragglers);
+        QCOMPARE(slowest.size(), size_t(files.size()));
+    }
+
+    void stragglers(){
+        // with a ratio above 1 at least the file of the median is a straggler
+        std::vector<FileTiming> slowest, stragglers;
+        QStringList warned;
+        run(2, slowest, stragglers, bigFiles, dir.filePath("big-hashes.json"), 2.0, &warned);
+        QVERIFY(!stragglers.empty());
+        QVERIFY(std::is_sorted(stragglers.begin(), stragglers.end(), [](const FileTiming& a, const FileTiming& b) -> bool{
+            return a.bytesPerSecond < b.bytesPerSecond;
+        }));
+        QCOMPARE(warned.size(), qsizetype(stragglers.size()));
+        for(const FileTiming& timing : stragglers){
+            QVERIFY(bigFiles.contains(timing.path));
+            QVERIFY(timing.bytes >= 1024 * 1024);
+            QVERIFY(timing.bytesPerSecond > 0);
+            QVERIFY(warned.contains(timing.path));
+        }
+    }
+
+private:
+    void run(int count, std::vector<FileTiming>& slowest, std::vector<FileTiming>& stragglers){
+        run(count, slowest, stragglers, files, hashFile, 0.1, nullptr);
+    }
+
+    void run(int count, std::vector<FileTiming>& slowest, std::vector<FileTiming>& stragglers,
+             const QStringList& paths, const QString& hashesPath, double stragglerRatio, QStringList* warned){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [warned](QString msg, QString path) -> void{
+            if(warned != nullptr && msg.contains("far below the median"))
+                warned->append(path);
+        };
+
+        LibTreeHash treeHash(listener);
+        try{
+            treeHash.setMode(RunMode::UPDATE);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashesPath);
+            treeHash.setFiles(paths);
+            treeHash.setSlowFileReport(count, stragglerRatio);
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+        slowest = treeHash.getSlowestFiles();
+        stragglers = treeHash.getStragglers();
+    }
+};
+
+#include "tst_slowfilestest.moc"
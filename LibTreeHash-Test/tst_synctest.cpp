@@ -0,0 +1,134 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QDateTime>
+#include <QJsonDocument>
+#include <QCryptographicHash>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test updating modified files, adding new files and removing deleted files in one run
+class SyncTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    int mtimeOffset = 0;
+
+public:
+    SyncTest(){}
+    ~SyncTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        writeFile("data/unchanged.txt", "unchanged");
+        writeFile("data/modified.txt", "old content");
+        writeFile("data/removed.txt", "removed");
+
+        runSync();
+
+        const QJsonObject entries = loadEntries();
+        QCOMPARE(entries.size(), 3);
+        QCOMPARE(entries.value("data/modified.txt").toObject().value("hash").toString(), expectedHash("old content"));
+    }
+
+    void sync(){
+        // the stored hash of this file is replaced, so that it can be seen if the file was hashed again
+        setStoredHash("data/unchanged.txt", "00");
+
+        writeFile("data/modified.txt", "new content");
+        writeFile("data/new.txt", "new");
+        QVERIFY(QFile::remove(dir.filePath("data/removed.txt")));
+
+        runSync();
+
+        const QJsonObject entries = loadEntries();
+        QCOMPARE(entries.size(), 3);
+        QVERIFY2(!entries.contains("data/removed.txt"), "entry of removed file was not removed");
+        QCOMPARE(entries.value("data/unchanged.txt").toObject().value("hash").toString(), QString("00"));
+        QCOMPARE(entries.value("data/modified.txt").toObject().value("hash").toString(), expectedHash("new content"));
+        QCOMPARE(entries.value("data/new.txt").toObject().value("hash").toString(), expectedHash("new"));
+    }
+
+private:
+    void writeFile(const QString& relPath, const QByteArray& data){
+        QFile file(dir.filePath(relPath));
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        QCOMPARE(file.write(data), data.size());
+
+        // SYNC compares the mtime in seconds
+        mtimeOffset += 10;
+        QVERIFY(file.setFileTime(QDateTime::currentDateTime().addSecs(mtimeOffset), QFileDevice::FileTime::FileModificationTime));
+    }
+
+    void runSync(){
+        EventListener listener;
+        listener.onError = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported error: " + msg).toStdString().c_str());
+        };
+        listener.onWarning = [](QString msg, QString path) -> void{
+            QVERIFY2(false, ("treeHash reported warning: " + msg).toStdString().c_str());
+        };
+        listener.onFileProcessed = [](QString path, bool success) -> void{
+            QVERIFY2(success, ("treeHash reported could not process file: " + path).toStdString().c_str());
+        };
+
+        LibTreeHash treeHash(listener);
+
+        try{
+            treeHash.setMode(RunMode::SYNC);
+            treeHash.setRootDir(dir.path());
+            treeHash.setHashesFilePath(hashFile);
+            treeHash.setFiles(listFiles());
+
+            treeHash.run();
+        }catch(...){
+            QVERIFY2(false, "treeHash threw exception");
+        }
+    }
+
+    QStringList listFiles(){
+        QStringList files;
+        QDirIterator iter(dir.filePath("data"), QDir::Filter::Files, QDirIterator::IteratorFlag::Subdirectories);
+        while(iter.hasNext())
+            files.append(iter.next());
+        return files;
+    }
+
+    QJsonObject loadEntries(){
+        QFile file(hashFile);
+        file.open(QFile::OpenModeFlag::ReadOnly);
+        return QJsonDocument::fromJson(file.readAll()).object().value("files").toObject();
+    }
+
+    void setStoredHash(const QString& relPath, const QString& hash){
+        QFile file(hashFile);
+        QVERIFY(file.open(QFile::OpenModeFlag::ReadOnly));
+        QJsonObject root = QJsonDocument::fromJson(file.readAll()).object();
+        file.close();
+
+        QJsonObject entries = root.value("files").toObject();
+        QJsonObject entry = entries.value(relPath).toObject();
+        entry.insert("hash", hash);
+        entries.insert(relPath, entry);
+        root.insert("files", entries);
+
+        QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly | QFile::OpenModeFlag::Truncate));
+        file.write(QJsonDocument(root).toJson());
+    }
+
+    QString expectedHash(const QByteArray& data){
+        return QString::fromLatin1(QCryptographicHash::hash(data, QCryptographicHash::Algorithm::Keccak_512).toHex());
+    }
+};
+
+#include "tst_synctest.moc"
@@ -0,0 +1,98 @@
+#include <QtTest>
+
+#include <QTemporaryDir>
+#include <QFile>
+#include <QJsonDocument>
+#include <QJsonArray>
+
+#include "libtreehash.h"
+
+using namespace TreeHash;
+
+/// test writing the trace of a run
+class TraceTest : public QObject
+{
+    Q_OBJECT
+
+private:
+    QTemporaryDir dir;
+    QString hashFile;
+    QString traceFile;
+    QStringList files;
+
+public:
+    TraceTest(){}
+    ~TraceTest(){}
+
+private slots:
+    void initTestCase(){
+        QVERIFY(dir.isValid());
+        hashFile = dir.filePath("hashes.json");
+        traceFile = dir.filePath("trace.json");
+        QVERIFY(QDir(dir.path()).mkdir("data"));
+
+        for(int i = 0; i < 3; i++){
+            const QString path = dir.filePath(QString("data/f%1.txt").arg(i));
+            QFile file(path);
+            QVERIFY(file.open(QFile::OpenModeFlag::WriteOnly));
+            QVERIFY(file.write(QByteArray(1000, 'a' + i)) > 0);
+            files.append(path);
+        }
+    }
+
+    void trace(){
+        run(65536);
+
+        QMap<QString, int> spans;
+        bool threadNamed = false;
+        for(const QJsonValue event : loadEvents()){
+            const QJsonObject obj = event.toObject();
+            if(obj.value("ph").toString() == "X"){
+                QVERIFY(obj.value("dur").toDouble() >= 0);
+                spans[obj.value("name").toString()]++;
+            }else if(obj.value("name").toString() == "thread_name"){
+                threadNamed = true;
+            }
+        }
+        QVERIFY(threadNamed);
+        QCOMPARE(spans.value("file"), 3);
+        QCOMPARE(spans.value("open"), 3);
+        QCOMPARE(spans.value("index update"), 3);
+        QVERIFY(spans.value("read chunk") >= 3);
+        QVERIFY(spans.value("hash chunk") >= 3);
+        QVERIFY(spans.value("save") >= 1);
+        QCOMPARE(spans.value("run"), 1);
+    }
+
+    void ringBuffer(){
+        run(4);
+
+        int spans = 0;
+        for(const QJsonValue event : loadEvents()){
+            if(event.toObject().value("ph").toString() == "X")
+                spans++;
+        }
+        // only the newest spans are kept (the run itself ends last)
+        QCOMPARE(spans, 4);
+    }
+
+private:
+    void run(size_t capacity){
+        LibTreeHash treeHash(EventListener::VOID_EVENT_LISTENER);
+        treeHash.setMode(RunMode::UPDATE);
+        treeHash.setRootDir(dir.path());
+        treeHash.setHashesFilePath(hashFile);
+        treeHash.setFiles(files);
+        treeHash.setTraceFile(traceFile, capacity);
+        treeHash.run();
+    }
+
+    QJsonArray loadEvents(){
+        QFile file(traceFile);
+        if(!file.open(QFile::OpenModeFlag::ReadOnly))
+            return QJsonArray();
+        return QJsonDocument::fromJson(file.readAll()).object().value("traceEvents").toArray();
+    }
+};
+
+#include "tst_tracetest.moc"
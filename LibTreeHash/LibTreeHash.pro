@@ -10,11 +10,26 @@ CONFIG += c++20
 DEFINES += QT_DISABLE_DEPRECATED_BEFORE=0x060000    # disables all the APIs deprecated before Qt 6.0.0
 
 SOURCES += \
-    libtreehash.cpp
+    binaryhashfile.cpp \
+    hasher.cpp \
+    hashindex.cpp \
+    journal.cpp \
+    jsonhashfile.cpp \
+    libtreehash.cpp \
+    progresstracker.cpp \
+    tracer.cpp
 
 HEADERS += \
+    binaryhashfile.h \
+    chunkedwriter.h \
     ext/nlohmann/json.hpp \
-    libtreehash.h
+    hasher.h \
+    hashindex.h \
+    journal.h \
+    jsonhashfile.h \
+    libtreehash.h \
+    progresstracker.h \
+    tracer.h
 
 # Default rules for deployment.
 unix {
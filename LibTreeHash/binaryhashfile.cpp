@@ -0,0 +1,228 @@
+#include "binaryhashfile.h"
+#include "chunkedwriter.h"
+#include <QFileDevice>
+#include <bit>
+#include <cstring>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace TreeHash;
+
+namespace{
+
+bool checkSection(quint64 offset, quint64 size, quint64 fileSize){
+    return offset <= fileSize && size <= fileSize - offset;
+}
+
+bool parseHeader(const char* data, quint64 size, BinaryHashFile::Header& header, QString* error){
+    if(size < sizeof(BinaryHashFile::Header)){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to load hash-file: file is truncated (header)");
+        return false;
+    }
+    std::memcpy(&header, data, sizeof(header));
+
+    if(std::memcmp(header.magic, BinaryHashFile::MAGIC, sizeof(BinaryHashFile::MAGIC)) != 0
+            || header.version != BinaryHashFile::VERSION){
+        if(error != nullptr)
+            *error = QStringLiteral("can not load version of hashfile");
+        return false;
+    }
+
+    // records may be bigger than known (fields added later)
+    if(header.headerSize < sizeof(BinaryHashFile::Header)
+            || header.recordSize < sizeof(HashTable::Record)
+            || header.entryCount > size / header.recordSize
+            || !checkSection(header.recordsOffset, header.entryCount * header.recordSize, size)
+            || !checkSection(header.stringsOffset, header.stringsSize, size)
+            || !checkSection(header.hashesOffset, header.hashesSize, size)
+            || !checkSection(header.settingsOffset, header.settingsSize, size)){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to load hash-file: file is malformed (invalid header)");
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief returns true if the records can be used directly as HashTable::Record
+ */
+bool isMappable(const BinaryHashFile::Header& header){
+    return header.recordSize == sizeof(HashTable::Record) && header.recordsOffset % alignof(HashTable::Record) == 0;
+}
+
+/**
+ * @brief copies the entries (of records which can not be mapped)
+ */
+std::shared_ptr<const HashTable> copyEntries(const char* data, const BinaryHashFile::Header& header, QString* error){
+    HashTable::Builder builder;
+    builder.reserve(header.entryCount);
+    for(quint64 i = 0; i < header.entryCount; i++){
+        HashTable::Record rec;
+        std::memcpy(&rec, data + header.recordsOffset + i * header.recordSize, sizeof(rec));
+
+        if(!checkSection(rec.pathOffset, rec.pathLength, header.stringsSize)
+                || !checkSection(rec.hashOffset, rec.hashLength, header.hashesSize)){
+            if(error != nullptr)
+                *error = QStringLiteral("unable to load hash-file: file is malformed (invalid record)");
+            return nullptr;
+        }
+
+        EntryView entry;
+        entry.path = std::string_view(data + header.stringsOffset + rec.pathOffset, rec.pathLength);
+        entry.hash = QByteArrayView(data + header.hashesOffset + rec.hashOffset, rec.hashLength);
+        entry.lastModified = rec.lastModified;
+        entry.size = rec.size;
+        entry.lastVerified = rec.lastVerified;
+        entry.mtimeNs = rec.mtimeNs;
+        entry.ctimeNs = rec.ctimeNs;
+        entry.inode = rec.inode;
+
+        // the other data is optional -> drop it if it is malformed
+        const char* extra = entry.hash.data() + rec.hashLength;
+        if(checkSection(rec.hashOffset + rec.hashLength,
+                        static_cast<quint64>(rec.hashStateLength) + rec.tailFingerprintLength + rec.blockHashesLength + rec.chunksLength,
+                        header.hashesSize)){
+            entry.hashState = QByteArrayView(extra, rec.hashStateLength);
+            entry.tailFingerprint = QByteArrayView(extra + rec.hashStateLength, rec.tailFingerprintLength);
+            entry.blockSize = rec.blockSize;
+            entry.blockHashes = QByteArrayView(extra + rec.hashStateLength + rec.tailFingerprintLength, rec.blockHashesLength);
+            entry.chunkSize = rec.chunkSize;
+            entry.chunks = QByteArrayView(entry.blockHashes.data() + rec.blockHashesLength, rec.chunksLength);
+        }
+
+        builder.add(entry);
+    }
+
+    if(error != nullptr)
+        *error = QString();
+    return builder.build();
+}
+
+}
+
+bool BinaryHashFile::isBinary(QFileDevice& file){
+    char magic[sizeof(MAGIC)];
+    return file.peek(magic, sizeof(magic)) == sizeof(magic)
+            && std::memcmp(magic, MAGIC, sizeof(MAGIC)) == 0;
+}
+
+std::shared_ptr<const HashTable> BinaryHashFile::load(QFileDevice& file, QByteArray& settings, QString* error){
+    if constexpr(std::endian::native != std::endian::little){
+        if(error != nullptr)
+            *error = QStringLiteral("binary hash-files are only supported on little-endian systems");
+        return nullptr;
+    }
+
+    Header header;
+
+    // map regular files, so that nothing has to be read before the first lookup
+    struct stat fileInfo;
+    const int fd = file.handle();
+    if(fd != -1 && fstat(fd, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode) && fileInfo.st_size > 0){
+        const size_t size = static_cast<size_t>(fileInfo.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_SHARED, fd, 0);
+        if(mapping != MAP_FAILED){
+            const char* data = static_cast<const char*>(mapping);
+            if(!parseHeader(data, size, header, error)){
+                munmap(mapping, size);
+                return nullptr;
+            }
+
+            settings = QByteArray(data + header.settingsOffset, header.settingsSize);
+
+            if(!isMappable(header)){
+                // other record-layout (e.g. a newer minor revision with bigger records) -> copy
+                std::shared_ptr<const HashTable> entries = copyEntries(data, header, error);
+                munmap(mapping, size);
+                return entries;
+            }
+
+            if(error != nullptr)
+                *error = QString();
+            return HashTable::fromMemory(reinterpret_cast<const HashTable::Record*>(data + header.recordsOffset), header.entryCount,
+                                         data + header.stringsOffset, header.stringsSize,
+                                         data + header.hashesOffset, header.hashesSize,
+                                         mapping, size);
+        }
+    }
+
+    // not mappable (e.g. stdin) -> read and copy the entries
+    const QByteArray content = file.readAll();
+    const char* data = content.constData();
+    if(!parseHeader(data, content.size(), header, error))
+        return nullptr;
+
+    settings = QByteArray(data + header.settingsOffset, header.settingsSize);
+    return copyEntries(data, header, error);
+}
+
+bool BinaryHashFile::save(QFileDevice& file, const HashIndex& index, const QByteArray& settings, QString* error){
+    // the header needs the sizes of all sections
+    quint64 stringsSize = 0, hashesSize = 0;
+    index.forEach([&stringsSize, &hashesSize](const EntryView& entry) -> void{
+        stringsSize += entry.path.size();
+        hashesSize += entry.hash.size() + entry.hashState.size() + entry.tailFingerprint.size()
+                      + entry.blockHashes.size() + entry.chunks.size();
+    });
+
+    Header header;
+    std::memset(&header, 0, sizeof(header));
+    std::memcpy(header.magic, MAGIC, sizeof(MAGIC));
+    header.version = VERSION;
+    header.headerSize = sizeof(Header);
+    header.recordSize = sizeof(HashTable::Record);
+    header.entryCount = index.size();
+    header.recordsOffset = sizeof(Header);
+    header.stringsOffset = header.recordsOffset + header.entryCount * sizeof(HashTable::Record);
+    header.stringsSize = stringsSize;
+    header.hashesOffset = header.stringsOffset + stringsSize;
+    header.hashesSize = hashesSize;
+    header.settingsOffset = header.hashesOffset + hashesSize;
+    header.settingsSize = settings.size();
+
+    ChunkedWriter out(file);
+    out.write(&header, sizeof(header));
+
+    quint64 pathOffset = 0, hashOffset = 0;
+    index.forEach([&out, &pathOffset, &hashOffset](const EntryView& entry) -> void{
+        HashTable::Record rec;
+        rec.pathOffset = pathOffset;
+        rec.pathLength = static_cast<quint32>(entry.path.size());
+        rec.hashOffset = hashOffset;
+        rec.hashLength = static_cast<quint32>(entry.hash.size());
+        rec.lastModified = entry.lastModified;
+        rec.size = entry.size;
+        rec.hashStateLength = static_cast<quint32>(entry.hashState.size());
+        rec.tailFingerprintLength = static_cast<quint32>(entry.tailFingerprint.size());
+        rec.blockSize = static_cast<quint32>(entry.blockSize);
+        rec.blockHashesLength = static_cast<quint32>(entry.blockHashes.size());
+        rec.chunkSize = static_cast<quint32>(entry.chunkSize);
+        rec.chunksLength = static_cast<quint32>(entry.chunks.size());
+        rec.lastVerified = entry.lastVerified;
+        rec.mtimeNs = entry.mtimeNs;
+        rec.ctimeNs = entry.ctimeNs;
+        rec.inode = entry.inode;
+        out.write(&rec, sizeof(rec));
+
+        pathOffset += rec.pathLength;
+        hashOffset += static_cast<quint64>(rec.hashLength) + rec.hashStateLength + rec.tailFingerprintLength
+                      + rec.blockHashesLength + rec.chunksLength;
+    });
+
+    index.forEach([&out](const EntryView& entry) -> void{
+        out.write(entry.path.data(), entry.path.size());
+    });
+    index.forEach([&out](const EntryView& entry) -> void{
+        out.write(entry.hash.data(), entry.hash.size());
+        out.write(entry.hashState.data(), entry.hashState.size());
+        out.write(entry.tailFingerprint.data(), entry.tailFingerprint.size());
+        out.write(entry.blockHashes.data(), entry.blockHashes.size());
+        out.write(entry.chunks.data(), entry.chunks.size());
+    });
+
+    out.write(settings.constData(), settings.size());
+
+    return out.finish(error);
+}
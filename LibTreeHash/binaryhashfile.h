@@ -0,0 +1,67 @@
+#ifndef BINARYHASHFILE_H
+#define BINARYHASHFILE_H
+
+#include <QString>
+#include <QByteArray>
+#include <memory>
+#include "hashindex.h"
+
+class QFileDevice;
+
+namespace TreeHash{
+
+/**
+ * @brief reads and writes the binary hash-file format (version 3; see FileFormat.txt)
+ */
+class BinaryHashFile{
+public:
+
+    static constexpr char MAGIC[8] = {'T', 'R', 'E', 'E', 'H', 'A', 'S', 'H'};
+    static constexpr quint32 VERSION = 3;
+
+    struct Header{
+        char magic[8];
+        quint32 version;
+        quint32 headerSize;
+        quint32 recordSize;
+        quint32 reserved;
+        quint64 entryCount;
+        quint64 recordsOffset;
+        quint64 stringsOffset;
+        quint64 stringsSize;
+        quint64 hashesOffset;
+        quint64 hashesSize;
+        quint64 settingsOffset;
+        quint64 settingsSize;
+    };
+    static_assert(sizeof(Header) == 88, "the binary format relies on the layout of Header");
+
+    /**
+     * @brief checks (without consuming any data) if the file starts with the magic of the binary format
+     */
+    static bool isBinary(QFileDevice& file);
+
+    /**
+     * @brief loads the entries of a binary hash-file;
+     *      regular files are memory-mapped, so no data is copied and lookups can start immediately
+     * @param file the hash-file (must be open for reading)
+     * @param settings will be set to the stored settings (a JSON-object)
+     * @param error if not nullptr an error-message will be stored on failure (null-string on success)
+     * @return the entries or nullptr on failure
+     */
+    static std::shared_ptr<const HashTable> load(QFileDevice& file, QByteArray& settings, QString* error);
+
+    /**
+     * @brief writes the index as binary hash-file (streamed, no seeking is needed)
+     * @param file the destination (must be open for writing)
+     * @param index the entries to write
+     * @param settings the settings to store (a JSON-object)
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true on success
+     */
+    static bool save(QFileDevice& file, const HashIndex& index, const QByteArray& settings, QString* error);
+};
+
+}
+
+#endif // BINARYHASHFILE_H
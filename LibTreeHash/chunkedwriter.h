@@ -0,0 +1,64 @@
+#ifndef CHUNKEDWRITER_H
+#define CHUNKEDWRITER_H
+
+#include <QByteArray>
+#include <QFileDevice>
+#include <QString>
+#include <string_view>
+
+namespace TreeHash{
+
+/**
+ * @brief buffers small writes and passes them in big chunks to the device
+ */
+class ChunkedWriter{
+public:
+    static constexpr qsizetype CHUNK_SIZE = 1024 * 1024;
+
+    explicit ChunkedWriter(QFileDevice& file)
+        : file(file)
+    {
+        this->buffer.reserve(CHUNK_SIZE);
+    }
+
+    void write(const void* data, qsizetype len){
+        if(this->failed)
+            return;
+
+        this->buffer.append(static_cast<const char*>(data), len);
+        if(this->buffer.size() >= CHUNK_SIZE)
+            this->flush();
+    }
+
+    void write(std::string_view str){
+        this->write(str.data(), static_cast<qsizetype>(str.size()));
+    }
+
+    /**
+     * @brief writes the remaining data
+     * @return true if all writes succeeded
+     */
+    bool finish(QString* error){
+        this->flush();
+        if(this->failed && error != nullptr)
+            *error = this->file.errorString();
+        return !this->failed;
+    }
+
+private:
+    QFileDevice& file;
+    QByteArray buffer;
+    bool failed = false;
+
+    void flush(){
+        if(this->failed || this->buffer.isEmpty())
+            return;
+        if(this->file.write(this->buffer) != this->buffer.size())
+            this->failed = true;
+        this->buffer.clear();
+    }
+};
+
+}
+
+#endif // CHUNKEDWRITER_H
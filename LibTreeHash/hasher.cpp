@@ -0,0 +1,849 @@
+#include "hasher.h"
+#include <QMessageAuthenticationCode>
+#include <algorithm>
+#include <array>
+#include <bit>
+#include <cstring>
+#include <string_view>
+#include <vector>
+
+using namespace TreeHash;
+
+namespace{
+
+constexpr size_t MAX_BLOCK_SIZE = 144;// Keccak-224
+constexpr quint8 STATE_VERSION = 1;
+
+// the state is serialized as little-endian
+
+template<typename T>
+void putLE(QByteArray& out, T val){
+    for(size_t i = 0; i < sizeof(T); i++)
+        out.append(static_cast<char>(static_cast<quint64>(val) >> (8 * i)));
+}
+
+template<typename T>
+T getLE(const char* data){
+    quint64 val = 0;
+    for(size_t i = 0; i < sizeof(T); i++)
+        val |= static_cast<quint64>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return static_cast<T>(val);
+}
+
+template<typename T>
+T getBE(const quint8* data){
+    T val = 0;
+    for(size_t i = 0; i < sizeof(T); i++)
+        val = static_cast<T>((val << 8) | data[i]);
+    return val;
+}
+
+template<typename T>
+void putBE(quint8* out, T val){
+    for(size_t i = 0; i < sizeof(T); i++)
+        out[i] = static_cast<quint8>(val >> (8 * (sizeof(T) - 1 - i)));
+}
+
+/**
+ * @brief hash-function which processes the data in blocks (its state are the chaining-words and the buffered partial block)
+ */
+class ResumableHasher : public Hasher{
+public:
+    virtual size_t getBlockSize() const = 0;
+};
+
+template<typename Word, size_t WORDS>
+class BlockHasher : public ResumableHasher{
+public:
+
+    BlockHasher(QCryptographicHash::Algorithm algorithm, size_t blockSize, bool deferLastBlock)
+        : algorithm(algorithm), blockSize(blockSize), deferLastBlock(deferLastBlock)
+    {}
+
+    size_t getBlockSize() const override{
+        return this->blockSize;
+    }
+
+    void addData(const char* data, size_t len) override{
+        const auto* bytes = reinterpret_cast<const quint8*>(data);
+        this->totalLength += len;
+
+        while(len > 0){
+            if(this->buffered == this->blockSize){
+                // only reached if the last block is deferred (more data follows, so it was not the last one)
+                this->compressBlock(this->buffer.data());
+                this->buffered = 0;
+            }
+
+            if(this->buffered == 0 && (len > this->blockSize || (len == this->blockSize && !this->deferLastBlock))){
+                this->compressBlock(bytes);
+                bytes += this->blockSize;
+                len -= this->blockSize;
+                continue;
+            }
+
+            const size_t n = std::min(this->blockSize - this->buffered, len);
+            std::memcpy(this->buffer.data() + this->buffered, bytes, n);
+            this->buffered += n;
+            bytes += n;
+            len -= n;
+
+            if(this->buffered == this->blockSize && !this->deferLastBlock){
+                this->compressBlock(this->buffer.data());
+                this->buffered = 0;
+            }
+        }
+    }
+
+    bool isResumable() const override{
+        return true;
+    }
+
+    QByteArray saveState() const override{
+        QByteArray out;
+        out.reserve(static_cast<qsizetype>(14 + this->buffered + WORDS * sizeof(Word)));
+        putLE<quint8>(out, STATE_VERSION);
+        putLE<quint32>(out, static_cast<quint32>(this->algorithm));
+        putLE<quint64>(out, this->totalLength);
+        putLE<quint8>(out, static_cast<quint8>(this->buffered));
+        out.append(reinterpret_cast<const char*>(this->buffer.data()), static_cast<qsizetype>(this->buffered));
+        for(Word w : this->h)
+            putLE<Word>(out, w);
+        return out;
+    }
+
+    bool restoreState(QByteArrayView state) override{
+        const char* data = state.data();
+        if(state.size() < 14
+                || getLE<quint8>(data) != STATE_VERSION
+                || getLE<quint32>(data + 1) != static_cast<quint32>(this->algorithm))
+            return false;
+
+        const quint64 length = getLE<quint64>(data + 5);
+        const size_t bufferLen = getLE<quint8>(data + 13);
+        const size_t maxBuffered = this->deferLastBlock ? this->blockSize : this->blockSize - 1;
+        if(bufferLen > maxBuffered || bufferLen > length
+                || (length - bufferLen) % this->blockSize != 0
+                || static_cast<size_t>(state.size()) != 14 + bufferLen + WORDS * sizeof(Word))
+            return false;
+
+        this->totalLength = length;
+        this->buffered = bufferLen;
+        this->compressed = length - bufferLen;
+        std::memcpy(this->buffer.data(), data + 14, bufferLen);
+        const char* words = data + 14 + bufferLen;
+        for(size_t i = 0; i < WORDS; i++)
+            this->h[i] = getLE<Word>(words + i * sizeof(Word));
+        return true;
+    }
+
+protected:
+    const QCryptographicHash::Algorithm algorithm;
+    const size_t blockSize;
+    /// if set the last full block is kept in the buffer until more data arrives (for functions which finalize it differently)
+    const bool deferLastBlock;
+
+    std::array<Word, WORDS> h{};
+    std::array<quint8, MAX_BLOCK_SIZE> buffer{};
+    size_t buffered = 0;
+    quint64 totalLength = 0;
+    /// count of bytes passed to compress() (including the current block)
+    quint64 compressed = 0;
+
+    virtual void compress(const quint8* block) = 0;
+
+private:
+    void compressBlock(const quint8* block){
+        this->compressed += this->blockSize;
+        this->compress(block);
+    }
+};
+
+// SHA-2 (FIPS 180-4)
+
+constexpr std::array<quint32, 64> SHA256_K = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2
+};
+
+constexpr std::array<quint64, 80> SHA512_K = {
+    0x428a2f98d728ae22, 0x7137449123ef65cd, 0xb5c0fbcfec4d3b2f, 0xe9b5dba58189dbbc, 0x3956c25bf348b538,
+    0x59f111f1b605d019, 0x923f82a4af194f9b, 0xab1c5ed5da6d8118, 0xd807aa98a3030242, 0x12835b0145706fbe,
+    0x243185be4ee4b28c, 0x550c7dc3d5ffb4e2, 0x72be5d74f27b896f, 0x80deb1fe3b1696b1, 0x9bdc06a725c71235,
+    0xc19bf174cf692694, 0xe49b69c19ef14ad2, 0xefbe4786384f25e3, 0x0fc19dc68b8cd5b5, 0x240ca1cc77ac9c65,
+    0x2de92c6f592b0275, 0x4a7484aa6ea6e483, 0x5cb0a9dcbd41fbd4, 0x76f988da831153b5, 0x983e5152ee66dfab,
+    0xa831c66d2db43210, 0xb00327c898fb213f, 0xbf597fc7beef0ee4, 0xc6e00bf33da88fc2, 0xd5a79147930aa725,
+    0x06ca6351e003826f, 0x142929670a0e6e70, 0x27b70a8546d22ffc, 0x2e1b21385c26c926, 0x4d2c6dfc5ac42aed,
+    0x53380d139d95b3df, 0x650a73548baf63de, 0x766a0abb3c77b2a8, 0x81c2c92e47edaee6, 0x92722c851482353b,
+    0xa2bfe8a14cf10364, 0xa81a664bbc423001, 0xc24b8b70d0f89791, 0xc76c51a30654be30, 0xd192e819d6ef5218,
+    0xd69906245565a910, 0xf40e35855771202a, 0x106aa07032bbd1b8, 0x19a4c116b8d2d0c8, 0x1e376c085141ab53,
+    0x2748774cdf8eeb99, 0x34b0bcb5e19b48a8, 0x391c0cb3c5c95a63, 0x4ed8aa4ae3418acb, 0x5b9cca4f7763e373,
+    0x682e6ff3d6b2b8a3, 0x748f82ee5defb2fc, 0x78a5636f43172f60, 0x84c87814a1f0ab72, 0x8cc702081a6439ec,
+    0x90befffa23631e28, 0xa4506cebde82bde9, 0xbef9a3f7b2c67915, 0xc67178f2e372532b, 0xca273eceea26619c,
+    0xd186b8c721c0c207, 0xeada7dd6cde0eb1e, 0xf57d4f7fee6ed178, 0x06f067aa72176fba, 0x0a637dc5a2c898a6,
+    0x113f9804bef90dae, 0x1b710b35131c471b, 0x28db77f523047d84, 0x32caab7b40c72493, 0x3c9ebe0a15c9bebc,
+    0x431d67c49c100d4c, 0x4cc5d4becb3e42b6, 0x597f299cfc657e2a, 0x5fcb6fab3ad6faec, 0x6c44198c4a475817
+};
+
+constexpr std::array<quint32, 8> SHA224_IV = {
+    0xc1059ed8, 0x367cd507, 0x3070dd17, 0xf70e5939, 0xffc00b31, 0x68581511, 0x64f98fa7, 0xbefa4fa4
+};
+constexpr std::array<quint32, 8> SHA256_IV = {
+    0x6a09e667, 0xbb67ae85, 0x3c6ef372, 0xa54ff53a, 0x510e527f, 0x9b05688c, 0x1f83d9ab, 0x5be0cd19
+};
+constexpr std::array<quint64, 8> SHA384_IV = {
+    0xcbbb9d5dc1059ed8, 0x629a292a367cd507, 0x9159015a3070dd17, 0x152fecd8f70e5939,
+    0x67332667ffc00b31, 0x8eb44a8768581511, 0xdb0c2e0d64f98fa7, 0x47b5481dbefa4fa4
+};
+constexpr std::array<quint64, 8> SHA512_IV = {
+    0x6a09e667f3bcc908, 0xbb67ae8584caa73b, 0x3c6ef372fe94f82b, 0xa54ff53a5f1d36f1,
+    0x510e527fade682d1, 0x9b05688c2b3e6c1f, 0x1f83d9abfb41bd6b, 0x5be0cd19137e2179
+};
+
+/**
+ * @brief SHA-224 / SHA-256 (Word = quint32) and SHA-384 / SHA-512 (Word = quint64)
+ */
+template<typename Word>
+class Sha2Hasher : public BlockHasher<Word, 8>{
+public:
+
+    Sha2Hasher(QCryptographicHash::Algorithm algorithm, const std::array<Word, 8>& iv, size_t digestSize)
+        : BlockHasher<Word, 8>(algorithm, 16 * sizeof(Word), false), digestSize(digestSize)
+    {
+        this->h = iv;
+    }
+
+    QByteArray result() override{
+        // padding: 0x80, zeros, message-length in bits (big-endian, twice the word-size)
+        const size_t lengthSize = 2 * sizeof(Word);
+        const quint64 bitLength = this->totalLength * 8;
+
+        std::array<quint8, 2 * MAX_BLOCK_SIZE> padding{};
+        padding[0] = 0x80;
+        size_t padLen = this->blockSize - this->buffered;
+        if(padLen < 1 + lengthSize)
+            padLen += this->blockSize;
+        putBE<quint64>(padding.data() + padLen - 8, bitLength);
+        this->addData(reinterpret_cast<const char*>(padding.data()), padLen);
+
+        std::array<quint8, 8 * sizeof(Word)> digest;
+        for(size_t i = 0; i < 8; i++)
+            putBE<Word>(digest.data() + i * sizeof(Word), this->h[i]);
+        return QByteArray(reinterpret_cast<const char*>(digest.data()), static_cast<qsizetype>(this->digestSize));
+    }
+
+protected:
+    void compress(const quint8* block) override{
+        constexpr bool IS_512 = sizeof(Word) == 8;
+        constexpr int ROUNDS = IS_512 ? 80 : 64;
+
+        Word w[80];
+        for(int i = 0; i < 16; i++)
+            w[i] = getBE<Word>(block + i * sizeof(Word));
+        for(int i = 16; i < ROUNDS; i++){
+            Word s0, s1;
+            if constexpr(IS_512){
+                s0 = std::rotr(w[i - 15], 1) ^ std::rotr(w[i - 15], 8) ^ (w[i - 15] >> 7);
+                s1 = std::rotr(w[i - 2], 19) ^ std::rotr(w[i - 2], 61) ^ (w[i - 2] >> 6);
+            }else{
+                s0 = std::rotr(w[i - 15], 7) ^ std::rotr(w[i - 15], 18) ^ (w[i - 15] >> 3);
+                s1 = std::rotr(w[i - 2], 17) ^ std::rotr(w[i - 2], 19) ^ (w[i - 2] >> 10);
+            }
+            w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+        }
+
+        Word a = this->h[0], b = this->h[1], c = this->h[2], d = this->h[3];
+        Word e = this->h[4], f = this->h[5], g = this->h[6], hh = this->h[7];
+        for(int i = 0; i < ROUNDS; i++){
+            Word S1, S0, k;
+            if constexpr(IS_512){
+                S1 = std::rotr(e, 14) ^ std::rotr(e, 18) ^ std::rotr(e, 41);
+                S0 = std::rotr(a, 28) ^ std::rotr(a, 34) ^ std::rotr(a, 39);
+                k = SHA512_K[i];
+            }else{
+                S1 = std::rotr(e, 6) ^ std::rotr(e, 11) ^ std::rotr(e, 25);
+                S0 = std::rotr(a, 2) ^ std::rotr(a, 13) ^ std::rotr(a, 22);
+                k = static_cast<Word>(SHA256_K[i]);
+            }
+            const Word ch = (e & f) ^ (~e & g);
+            const Word maj = (a & b) ^ (a & c) ^ (b & c);
+            const Word t1 = hh + S1 + ch + k + w[i];
+            const Word t2 = S0 + maj;
+            hh = g;
+            g = f;
+            f = e;
+            e = d + t1;
+            d = c;
+            c = b;
+            b = a;
+            a = t1 + t2;
+        }
+
+        this->h[0] += a;
+        this->h[1] += b;
+        this->h[2] += c;
+        this->h[3] += d;
+        this->h[4] += e;
+        this->h[5] += f;
+        this->h[6] += g;
+        this->h[7] += hh;
+    }
+
+private:
+    const size_t digestSize;
+};
+
+// Keccak / SHA-3 (FIPS 202)
+
+constexpr std::array<quint64, 24> KECCAK_RC = {
+    0x0000000000000001, 0x0000000000008082, 0x800000000000808a, 0x8000000080008000,
+    0x000000000000808b, 0x0000000080000001, 0x8000000080008081, 0x8000000000008009,
+    0x000000000000008a, 0x0000000000000088, 0x0000000080008009, 0x000000008000000a,
+    0x000000008000808b, 0x800000000000008b, 0x8000000000008089, 0x8000000000008003,
+    0x8000000000008002, 0x8000000000000080, 0x000000000000800a, 0x800000008000000a,
+    0x8000000080008081, 0x8000000000008080, 0x0000000080000001, 0x8000000080008008
+};
+
+void keccakF1600(std::array<quint64, 25>& st){
+    // fully unrolled with the lanes in locals (index = x + 5 * y), so that they can be kept in registers
+    quint64 a0 = st[0], a1 = st[1], a2 = st[2], a3 = st[3], a4 = st[4];
+    quint64 a5 = st[5], a6 = st[6], a7 = st[7], a8 = st[8], a9 = st[9];
+    quint64 a10 = st[10], a11 = st[11], a12 = st[12], a13 = st[13], a14 = st[14];
+    quint64 a15 = st[15], a16 = st[16], a17 = st[17], a18 = st[18], a19 = st[19];
+    quint64 a20 = st[20], a21 = st[21], a22 = st[22], a23 = st[23], a24 = st[24];
+
+    for(int round = 0; round < 24; round++){
+        // theta
+        const quint64 c0 = a0 ^ a5 ^ a10 ^ a15 ^ a20;
+        const quint64 c1 = a1 ^ a6 ^ a11 ^ a16 ^ a21;
+        const quint64 c2 = a2 ^ a7 ^ a12 ^ a17 ^ a22;
+        const quint64 c3 = a3 ^ a8 ^ a13 ^ a18 ^ a23;
+        const quint64 c4 = a4 ^ a9 ^ a14 ^ a19 ^ a24;
+        const quint64 d0 = c4 ^ std::rotl(c1, 1);
+        const quint64 d1 = c0 ^ std::rotl(c2, 1);
+        const quint64 d2 = c1 ^ std::rotl(c3, 1);
+        const quint64 d3 = c2 ^ std::rotl(c4, 1);
+        const quint64 d4 = c3 ^ std::rotl(c0, 1);
+
+        // rho and pi: (x, y) -> (y, 2x + 3y)
+        const quint64 b0 = a0 ^ d0;
+        const quint64 b1 = std::rotl(a6 ^ d1, 44);
+        const quint64 b2 = std::rotl(a12 ^ d2, 43);
+        const quint64 b3 = std::rotl(a18 ^ d3, 21);
+        const quint64 b4 = std::rotl(a24 ^ d4, 14);
+        const quint64 b5 = std::rotl(a3 ^ d3, 28);
+        const quint64 b6 = std::rotl(a9 ^ d4, 20);
+        const quint64 b7 = std::rotl(a10 ^ d0, 3);
+        const quint64 b8 = std::rotl(a16 ^ d1, 45);
+        const quint64 b9 = std::rotl(a22 ^ d2, 61);
+        const quint64 b10 = std::rotl(a1 ^ d1, 1);
+        const quint64 b11 = std::rotl(a7 ^ d2, 6);
+        const quint64 b12 = std::rotl(a13 ^ d3, 25);
+        const quint64 b13 = std::rotl(a19 ^ d4, 8);
+        const quint64 b14 = std::rotl(a20 ^ d0, 18);
+        const quint64 b15 = std::rotl(a4 ^ d4, 27);
+        const quint64 b16 = std::rotl(a5 ^ d0, 36);
+        const quint64 b17 = std::rotl(a11 ^ d1, 10);
+        const quint64 b18 = std::rotl(a17 ^ d2, 15);
+        const quint64 b19 = std::rotl(a23 ^ d3, 56);
+        const quint64 b20 = std::rotl(a2 ^ d2, 62);
+        const quint64 b21 = std::rotl(a8 ^ d3, 55);
+        const quint64 b22 = std::rotl(a14 ^ d4, 39);
+        const quint64 b23 = std::rotl(a15 ^ d0, 41);
+        const quint64 b24 = std::rotl(a21 ^ d1, 2);
+
+        // chi
+        a0 = b0 ^ (~b1 & b2);
+        a1 = b1 ^ (~b2 & b3);
+        a2 = b2 ^ (~b3 & b4);
+        a3 = b3 ^ (~b4 & b0);
+        a4 = b4 ^ (~b0 & b1);
+        a5 = b5 ^ (~b6 & b7);
+        a6 = b6 ^ (~b7 & b8);
+        a7 = b7 ^ (~b8 & b9);
+        a8 = b8 ^ (~b9 & b5);
+        a9 = b9 ^ (~b5 & b6);
+        a10 = b10 ^ (~b11 & b12);
+        a11 = b11 ^ (~b12 & b13);
+        a12 = b12 ^ (~b13 & b14);
+        a13 = b13 ^ (~b14 & b10);
+        a14 = b14 ^ (~b10 & b11);
+        a15 = b15 ^ (~b16 & b17);
+        a16 = b16 ^ (~b17 & b18);
+        a17 = b17 ^ (~b18 & b19);
+        a18 = b18 ^ (~b19 & b15);
+        a19 = b19 ^ (~b15 & b16);
+        a20 = b20 ^ (~b21 & b22);
+        a21 = b21 ^ (~b22 & b23);
+        a22 = b22 ^ (~b23 & b24);
+        a23 = b23 ^ (~b24 & b20);
+        a24 = b24 ^ (~b20 & b21);
+
+        // iota
+        a0 ^= KECCAK_RC[round];
+    }
+
+    st[0] = a0; st[1] = a1; st[2] = a2; st[3] = a3; st[4] = a4;
+    st[5] = a5; st[6] = a6; st[7] = a7; st[8] = a8; st[9] = a9;
+    st[10] = a10; st[11] = a11; st[12] = a12; st[13] = a13; st[14] = a14;
+    st[15] = a15; st[16] = a16; st[17] = a17; st[18] = a18; st[19] = a19;
+    st[20] = a20; st[21] = a21; st[22] = a22; st[23] = a23; st[24] = a24;
+}
+
+class KeccakHasher : public BlockHasher<quint64, 25>{
+public:
+
+    /**
+     * @param digestSize the rate is derived from it (capacity = 2 * digestSize)
+     * @param padding domain-separation byte (0x01 for Keccak, 0x06 for SHA-3)
+     */
+    KeccakHasher(QCryptographicHash::Algorithm algorithm, size_t digestSize, quint8 padding)
+        : BlockHasher<quint64, 25>(algorithm, 200 - 2 * digestSize, false), digestSize(digestSize), padding(padding)
+    {}
+
+    QByteArray result() override{
+        std::memset(this->buffer.data() + this->buffered, 0, this->blockSize - this->buffered);
+        this->buffer[this->buffered] ^= this->padding;
+        this->buffer[this->blockSize - 1] ^= 0x80;
+        this->compress(this->buffer.data());
+
+        // the digest is smaller than the rate -> no further permutation is needed
+        QByteArray digest;
+        for(size_t i = 0; i * 8 < this->digestSize; i++)
+            putLE<quint64>(digest, this->h[i]);
+        digest.truncate(static_cast<qsizetype>(this->digestSize));
+        return digest;
+    }
+
+protected:
+    void compress(const quint8* block) override{
+        for(size_t i = 0; i < this->blockSize / 8; i++)
+            this->h[i] ^= getLE<quint64>(reinterpret_cast<const char*>(block) + i * 8);
+        keccakF1600(this->h);
+    }
+
+private:
+    const size_t digestSize;
+    const quint8 padding;
+};
+
+// BLAKE2b (RFC 7693)
+
+constexpr std::array<std::array<quint8, 16>, 10> BLAKE2B_SIGMA = {{
+    {0, 1, 2, 3, 4, 5, 6, 7, 8, 9, 10, 11, 12, 13, 14, 15},
+    {14, 10, 4, 8, 9, 15, 13, 6, 1, 12, 0, 2, 11, 7, 5, 3},
+    {11, 8, 12, 0, 5, 2, 15, 13, 10, 14, 3, 6, 7, 1, 9, 4},
+    {7, 9, 3, 1, 13, 12, 11, 14, 2, 6, 5, 10, 4, 0, 15, 8},
+    {9, 0, 5, 7, 2, 4, 10, 15, 14, 1, 11, 12, 6, 8, 3, 13},
+    {2, 12, 6, 10, 0, 11, 8, 3, 4, 13, 7, 5, 15, 14, 1, 9},
+    {12, 5, 1, 15, 14, 13, 4, 10, 0, 7, 6, 3, 9, 2, 8, 11},
+    {13, 11, 7, 14, 12, 1, 3, 9, 5, 0, 15, 4, 8, 6, 2, 10},
+    {6, 15, 14, 9, 11, 3, 0, 8, 12, 2, 13, 7, 1, 4, 10, 5},
+    {10, 2, 8, 4, 7, 6, 1, 5, 15, 11, 9, 14, 3, 12, 13, 0}
+}};
+
+class Blake2bHasher : public BlockHasher<quint64, 8>{
+public:
+
+    Blake2bHasher(QCryptographicHash::Algorithm algorithm, size_t digestSize)
+        : BlockHasher<quint64, 8>(algorithm, 128, true), digestSize(digestSize)
+    {
+        this->h = SHA512_IV;
+        this->h[0] ^= 0x01010000 ^ digestSize;// no key
+    }
+
+    QByteArray result() override{
+        std::memset(this->buffer.data() + this->buffered, 0, this->blockSize - this->buffered);
+        this->process(this->buffer.data(), this->totalLength, true);
+
+        QByteArray digest;
+        for(quint64 w : this->h)
+            putLE<quint64>(digest, w);
+        digest.truncate(static_cast<qsizetype>(this->digestSize));
+        return digest;
+    }
+
+protected:
+    void compress(const quint8* block) override{
+        this->process(block, this->compressed, false);
+    }
+
+private:
+    const size_t digestSize;
+
+    void process(const quint8* block, quint64 counter, bool last){
+        quint64 m[16];
+        for(int i = 0; i < 16; i++)
+            m[i] = getLE<quint64>(reinterpret_cast<const char*>(block) + i * 8);
+
+        quint64 v[16];
+        for(int i = 0; i < 8; i++){
+            v[i] = this->h[i];
+            v[i + 8] = SHA512_IV[i];
+        }
+        v[12] ^= counter;// the upper half of the 128-bit counter is always 0 here
+        if(last)
+            v[14] = ~v[14];
+
+        const auto g = [&v, &m](int a, int b, int c, int d, int x, int y){
+            v[a] = v[a] + v[b] + m[x];
+            v[d] = std::rotr(v[d] ^ v[a], 32);
+            v[c] = v[c] + v[d];
+            v[b] = std::rotr(v[b] ^ v[c], 24);
+            v[a] = v[a] + v[b] + m[y];
+            v[d] = std::rotr(v[d] ^ v[a], 16);
+            v[c] = v[c] + v[d];
+            v[b] = std::rotr(v[b] ^ v[c], 63);
+        };
+
+        for(int round = 0; round < 12; round++){
+            const auto& s = BLAKE2B_SIGMA[round % 10];
+            g(0, 4, 8, 12, s[0], s[1]);
+            g(1, 5, 9, 13, s[2], s[3]);
+            g(2, 6, 10, 14, s[4], s[5]);
+            g(3, 7, 11, 15, s[6], s[7]);
+            g(0, 5, 10, 15, s[8], s[9]);
+            g(1, 6, 11, 12, s[10], s[11]);
+            g(2, 7, 8, 13, s[12], s[13]);
+            g(3, 4, 9, 14, s[14], s[15]);
+        }
+
+        for(int i = 0; i < 8; i++)
+            this->h[i] ^= v[i] ^ v[i + 8];
+    }
+};
+
+std::unique_ptr<ResumableHasher> createResumable(QCryptographicHash::Algorithm algorithm){
+    using Alg = QCryptographicHash::Algorithm;
+    switch(algorithm){
+        case Alg::Sha224:
+            return std::make_unique<Sha2Hasher<quint32>>(algorithm, SHA224_IV, 28);
+        case Alg::Sha256:
+            return std::make_unique<Sha2Hasher<quint32>>(algorithm, SHA256_IV, 32);
+        case Alg::Sha384:
+            return std::make_unique<Sha2Hasher<quint64>>(algorithm, SHA384_IV, 48);
+        case Alg::Sha512:
+            return std::make_unique<Sha2Hasher<quint64>>(algorithm, SHA512_IV, 64);
+        case Alg::Keccak_224:
+            return std::make_unique<KeccakHasher>(algorithm, 28, 0x01);
+        case Alg::Keccak_256:
+            return std::make_unique<KeccakHasher>(algorithm, 32, 0x01);
+        case Alg::Keccak_384:
+            return std::make_unique<KeccakHasher>(algorithm, 48, 0x01);
+        case Alg::Keccak_512:
+            return std::make_unique<KeccakHasher>(algorithm, 64, 0x01);
+        case Alg::Sha3_224:
+            return std::make_unique<KeccakHasher>(algorithm, 28, 0x06);
+        case Alg::Sha3_256:
+            return std::make_unique<KeccakHasher>(algorithm, 32, 0x06);
+        case Alg::Sha3_384:
+            return std::make_unique<KeccakHasher>(algorithm, 48, 0x06);
+        case Alg::Sha3_512:
+            return std::make_unique<KeccakHasher>(algorithm, 64, 0x06);
+        case Alg::Blake2b_160:
+            return std::make_unique<Blake2bHasher>(algorithm, 20);
+        case Alg::Blake2b_256:
+            return std::make_unique<Blake2bHasher>(algorithm, 32);
+        case Alg::Blake2b_384:
+            return std::make_unique<Blake2bHasher>(algorithm, 48);
+        case Alg::Blake2b_512:
+            return std::make_unique<Blake2bHasher>(algorithm, 64);
+        default:
+            return nullptr;
+    }
+}
+
+/**
+ * @brief HMAC (RFC 2104) over a resumable hash-function; the state is the state of the inner hash
+ *      (the block-sizes match the ones of QMessageAuthenticationCode)
+ */
+class HmacHasher : public Hasher{
+public:
+
+    HmacHasher(QCryptographicHash::Algorithm algorithm, const QByteArray& key)
+        : algorithm(algorithm), inner(createResumable(algorithm))
+    {
+        const size_t blockSize = this->inner->getBlockSize();
+
+        QByteArray paddedKey = key;
+        if(static_cast<size_t>(paddedKey.size()) > blockSize){
+            std::unique_ptr<ResumableHasher> keyHash = createResumable(algorithm);
+            keyHash->addData(paddedKey.constData(), static_cast<size_t>(paddedKey.size()));
+            paddedKey = keyHash->result();
+        }
+        paddedKey.append(QByteArray(static_cast<qsizetype>(blockSize) - paddedKey.size(), '\0'));
+
+        QByteArray innerPad = paddedKey;
+        this->outerPad = paddedKey;
+        for(size_t i = 0; i < blockSize; i++){
+            innerPad[i] = static_cast<char>(innerPad[i] ^ 0x36);
+            this->outerPad[i] = static_cast<char>(this->outerPad[i] ^ 0x5c);
+        }
+        this->inner->addData(innerPad.constData(), blockSize);
+    }
+
+    void addData(const char* data, size_t len) override{
+        this->inner->addData(data, len);
+    }
+
+    QByteArray result() override{
+        const QByteArray innerDigest = this->inner->result();
+
+        std::unique_ptr<ResumableHasher> outer = createResumable(this->algorithm);
+        outer->addData(this->outerPad.constData(), static_cast<size_t>(this->outerPad.size()));
+        outer->addData(innerDigest.constData(), static_cast<size_t>(innerDigest.size()));
+        return outer->result();
+    }
+
+    bool isResumable() const override{
+        return true;
+    }
+
+    QByteArray saveState() const override{
+        return this->inner->saveState();
+    }
+
+    bool restoreState(QByteArrayView state) override{
+        return this->inner->restoreState(state);
+    }
+
+private:
+    const QCryptographicHash::Algorithm algorithm;
+    std::unique_ptr<ResumableHasher> inner;
+    QByteArray outerPad;
+};
+
+class QtHasher : public Hasher{
+public:
+
+    explicit QtHasher(QCryptographicHash::Algorithm algorithm)
+        : hash(algorithm)
+    {}
+
+    void addData(const char* data, size_t len) override{
+        this->hash.addData(QByteArrayView(data, static_cast<qsizetype>(len)));
+    }
+
+    QByteArray result() override{
+        return this->hash.result();
+    }
+
+private:
+    QCryptographicHash hash;
+};
+
+class QtHmacHasher : public Hasher{
+public:
+
+    QtHmacHasher(QCryptographicHash::Algorithm algorithm, const QByteArray& key)
+        : mac(algorithm, key)
+    {}
+
+    void addData(const char* data, size_t len) override{
+        this->mac.addData(QByteArrayView(data, static_cast<qsizetype>(len)));
+    }
+
+    QByteArray result() override{
+        return this->mac.result();
+    }
+
+private:
+    QMessageAuthenticationCode mac;
+};
+
+}
+
+std::unique_ptr<Hasher> Hasher::create(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey){
+    if(std::unique_ptr<ResumableHasher> hasher = createResumable(algorithm); hasher){
+        if(hmacKey.isEmpty())
+            return hasher;
+        return std::make_unique<HmacHasher>(algorithm, hmacKey);
+    }
+
+    if(hmacKey.isEmpty())
+        return std::make_unique<QtHasher>(algorithm);
+    return std::make_unique<QtHmacHasher>(algorithm, hmacKey);
+}
+
+BlockListHasher::BlockListHasher(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey, qint64 blockSize)
+    : algorithm(algorithm), hmacKey(hmacKey), blockSize(blockSize), current(Hasher::create(algorithm, hmacKey))
+{}
+
+void BlockListHasher::addData(const char* data, size_t len){
+    while(len > 0){
+        const size_t n = static_cast<size_t>(std::min<qint64>(static_cast<qint64>(len), this->blockSize - this->currentSize));
+        this->current->addData(data, n);
+        this->currentSize += static_cast<qint64>(n);
+        data += n;
+        len -= n;
+
+        if(this->currentSize == this->blockSize){
+            this->digests.append(this->current->result());
+            this->current = Hasher::create(this->algorithm, this->hmacKey);
+            this->currentSize = 0;
+        }
+    }
+}
+
+QByteArray BlockListHasher::result(){
+    if(this->currentSize > 0){
+        this->digests.append(this->current->result());
+        this->currentSize = 0;
+    }
+    return this->digests;
+}
+
+void BlockListHasher::setCompletedBlocks(QByteArray digests){
+    this->digests = std::move(digests);
+}
+
+bool BlockListHasher::isResumable() const{
+    return this->current->isResumable();
+}
+
+QByteArray BlockListHasher::saveState() const{
+    if(!this->current->isResumable())
+        return QByteArray();
+
+    QByteArray out;
+    putLE<quint8>(out, STATE_VERSION);
+    putLE<quint64>(out, static_cast<quint64>(this->blockSize));
+    putLE<quint64>(out, static_cast<quint64>(this->currentSize));
+    putLE<quint32>(out, static_cast<quint32>(this->digests.size()));
+    out.append(this->digests);
+    out.append(this->current->saveState());
+    return out;
+}
+
+bool BlockListHasher::restoreState(QByteArrayView state){
+    const char* data = state.data();
+    if(state.size() < 21
+            || getLE<quint8>(data) != STATE_VERSION
+            || getLE<quint64>(data + 1) != static_cast<quint64>(this->blockSize))
+        return false;
+
+    const quint64 currentSize = getLE<quint64>(data + 9);
+    const quint32 digestsLength = getLE<quint32>(data + 17);
+    if(currentSize >= static_cast<quint64>(this->blockSize) || digestsLength > static_cast<quint64>(state.size()) - 21)
+        return false;
+
+    std::unique_ptr<Hasher> current = Hasher::create(this->algorithm, this->hmacKey);
+    if(!current->restoreState(state.sliced(21 + digestsLength)))
+        return false;
+
+    this->current = std::move(current);
+    this->currentSize = static_cast<qint64>(currentSize);
+    this->digests = QByteArray(data + 21, digestsLength);
+    return true;
+}
+
+namespace{
+
+/**
+ * @brief random values for the gear-hash of the chunking (generated by splitmix64 with seed 0);
+ *      ATTENTION: changing them changes all chunk-boundaries
+ */
+constexpr std::array<quint64, 256> makeGearTable(){
+    std::array<quint64, 256> table{};
+    quint64 state = 0;
+    for(quint64& val : table){
+        state += 0x9e3779b97f4a7c15;
+        quint64 z = state;
+        z = (z ^ (z >> 30)) * 0xbf58476d1ce4e5b9;
+        z = (z ^ (z >> 27)) * 0x94d049bb133111eb;
+        val = z ^ (z >> 31);
+    }
+    return table;
+}
+
+constexpr std::array<quint64, 256> GEAR = makeGearTable();
+
+/**
+ * @brief returns a mask of the given count of the highest bits
+ *      (the high bits of the gear-hash depend on the last 64 bytes)
+ */
+constexpr quint64 highBits(int count){
+    return ~0ULL << (64 - count);
+}
+
+}
+
+ChunkIndexer::ChunkIndexer(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey, qint64 avgSize)
+    : algorithm(algorithm), hmacKey(hmacKey), minSize(avgSize / 4), avgSize(avgSize), maxSize(avgSize * 8),
+      maskSmall(highBits(std::bit_width(static_cast<quint64>(avgSize)) + 1)),
+      maskLarge(highBits(std::bit_width(static_cast<quint64>(avgSize)) - 3)),
+      current(Hasher::create(algorithm, hmacKey))
+{}
+
+void ChunkIndexer::addData(const char* data, size_t len){
+    while(len > 0){
+        size_t n;
+        bool boundary = false;
+        if(this->currentSize < this->minSize){
+            // there is never a boundary in the first minSize bytes
+            n = static_cast<size_t>(std::min<qint64>(static_cast<qint64>(len), this->minSize - this->currentSize));
+        }else{
+            const size_t limit = static_cast<size_t>(std::min<qint64>(static_cast<qint64>(len), this->maxSize - this->currentSize));
+            n = 0;
+            while(n < limit){
+                const quint64 mask = this->currentSize + static_cast<qint64>(n) < this->avgSize ? this->maskSmall : this->maskLarge;
+                this->fingerprint = (this->fingerprint << 1) + GEAR[static_cast<unsigned char>(data[n])];
+                n++;
+                if((this->fingerprint & mask) == 0){
+                    boundary = true;
+                    break;
+                }
+            }
+            boundary = boundary || this->currentSize + static_cast<qint64>(n) == this->maxSize;
+        }
+
+        this->current->addData(data, n);
+        this->currentSize += static_cast<qint64>(n);
+        data += n;
+        len -= n;
+
+        if(boundary)
+            this->finishChunk();
+    }
+}
+
+QByteArray ChunkIndexer::result(){
+    if(this->currentSize > 0)
+        this->finishChunk();
+    return this->chunks;
+}
+
+ChunkIndexer::Changes ChunkIndexer::compare(QByteArrayView oldChunks, QByteArrayView newChunks){
+    // the chunks are compared by length and digest; their order does not matter
+    std::vector<std::string_view> known;
+    known.reserve(static_cast<size_t>(oldChunks.size() / RECORD_SIZE));
+    for(qsizetype i = 0; i + RECORD_SIZE <= oldChunks.size(); i += RECORD_SIZE)
+        known.emplace_back(oldChunks.data() + i, RECORD_SIZE);
+    std::sort(known.begin(), known.end());
+
+    Changes changes;
+    for(qsizetype i = 0; i + RECORD_SIZE <= newChunks.size(); i += RECORD_SIZE){
+        const std::string_view chunk(newChunks.data() + i, RECORD_SIZE);
+        changes.chunkCount++;
+        if(!std::binary_search(known.begin(), known.end(), chunk)){
+            changes.changedChunks++;
+            changes.changedBytes += getLE<quint32>(chunk.data());
+        }
+    }
+    return changes;
+}
+
+void ChunkIndexer::finishChunk(){
+    putLE<quint32>(this->chunks, static_cast<quint32>(this->currentSize));
+    this->chunks.append(this->current->result().left(DIGEST_LENGTH));
+
+    this->current = Hasher::create(this->algorithm, this->hmacKey);
+    this->currentSize = 0;
+    this->fingerprint = 0;
+}
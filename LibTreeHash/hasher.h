@@ -0,0 +1,167 @@
+#ifndef HASHER_H
+#define HASHER_H
+
+#include <QByteArray>
+#include <QByteArrayView>
+#include <QCryptographicHash>
+#include <memory>
+
+namespace TreeHash{
+
+/**
+ * @brief incremental hash-function (or HMAC) whose state can be saved and restored,
+ *      so that hashing of a file can be continued later (e.g. after an interrupted run).
+ *      SHA-2, SHA-3, Keccak and Blake2b are implemented here (with the same results as QCryptographicHash);
+ *      all other algorithms use QCryptographicHash and are not resumable.
+ */
+class Hasher{
+public:
+
+    /**
+     * @brief creates a hasher for the given algorithm
+     * @param algorithm the hash-function
+     * @param hmacKey if not empty a HMAC with this key is computed
+     */
+    static std::unique_ptr<Hasher> create(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey = QByteArray());
+
+    virtual ~Hasher() = default;
+
+    virtual void addData(const char* data, size_t len) = 0;
+
+    /**
+     * @brief finishes the computation and returns the digest (the hasher can not be used afterwards)
+     */
+    virtual QByteArray result() = 0;
+
+    /**
+     * @brief returns true if saveState() and restoreState() are supported
+     */
+    virtual bool isResumable() const{
+        return false;
+    }
+
+    /**
+     * @brief serializes the current state (it does not contain the HMAC-key)
+     * @return the state or an empty array if the hasher is not resumable
+     */
+    virtual QByteArray saveState() const{
+        return QByteArray();
+    }
+
+    /**
+     * @brief replaces the current state by one returned by saveState() of a hasher with the same algorithm
+     * @return false if the state is malformed or belongs to another algorithm (the hasher is unchanged then)
+     */
+    virtual bool restoreState(QByteArrayView state){
+        return false;
+    }
+};
+
+/**
+ * @brief computes the digests of consecutive blocks of a fixed size (the last one may be shorter)
+ *      with the same hash-function (or HMAC) as the whole file;
+ *      they allow verifying parts of a file independently and locating corrupt ranges
+ */
+class BlockListHasher{
+public:
+
+    /**
+     * @param blockSize the size of the blocks (> 0)
+     */
+    BlockListHasher(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey, qint64 blockSize);
+
+    void addData(const char* data, size_t len);
+
+    /**
+     * @brief finishes the last block (if it contains data) and returns the concatenated digests
+     */
+    QByteArray result();
+
+    /**
+     * @brief continues a list of which the first blocks are already hashed
+     *      (must be called before any data is added)
+     * @param digests the digests of complete blocks
+     */
+    void setCompletedBlocks(QByteArray digests);
+
+    bool isResumable() const;
+
+    /**
+     * @brief serializes the digests so far and the state of the current block
+     * @return the state or an empty array if the hash-function is not resumable
+     */
+    QByteArray saveState() const;
+
+    /**
+     * @brief replaces the current state by one returned by saveState() of a hasher with the same parameters
+     * @return false if the state is malformed or does not match (the hasher is unchanged then)
+     */
+    bool restoreState(QByteArrayView state);
+
+private:
+    const QCryptographicHash::Algorithm algorithm;
+    const QByteArray hmacKey;
+    const qint64 blockSize;
+    std::unique_ptr<Hasher> current;
+    qint64 currentSize = 0;
+    QByteArray digests;
+};
+
+/**
+ * @brief splits data into content-defined chunks (FastCDC with normalized chunking) and computes their digests;
+ *      as the boundaries depend on the content, an edit only changes the chunks around it (even if it shifts the data),
+ *      so comparing the chunk-lists of two versions of a file shows which parts were changed
+ */
+class ChunkIndexer{
+public:
+
+    /// length of the digest-prefix stored per chunk
+    static constexpr qsizetype DIGEST_LENGTH = 16;
+    /// size of a chunk in the list (u32 length followed by the digest-prefix)
+    static constexpr qsizetype RECORD_SIZE = 4 + DIGEST_LENGTH;
+
+    /**
+     * @brief the result of compare()
+     */
+    struct Changes{
+        qint64 chunkCount = 0;
+        qint64 changedChunks = 0;
+        qint64 changedBytes = 0;
+    };
+
+    /**
+     * @param avgSize the targeted average size of the chunks (>= 64);
+     *      the chunks are between a quarter and 8 times of it
+     */
+    ChunkIndexer(QCryptographicHash::Algorithm algorithm, const QByteArray& hmacKey, qint64 avgSize);
+
+    void addData(const char* data, size_t len);
+
+    /**
+     * @brief finishes the last chunk (if it contains data) and returns the list of chunks
+     */
+    QByteArray result();
+
+    /**
+     * @brief counts the chunks of newChunks which do not exist in oldChunks
+     *      (both must be created with the same parameters)
+     */
+    static Changes compare(QByteArrayView oldChunks, QByteArrayView newChunks);
+
+private:
+    const QCryptographicHash::Algorithm algorithm;
+    const QByteArray hmacKey;
+    const qint64 minSize, avgSize, maxSize;
+    /// mask for the fingerprint before (harder to match) and after (easier to match) avgSize
+    const quint64 maskSmall, maskLarge;
+    std::unique_ptr<Hasher> current;
+    qint64 currentSize = 0;
+    quint64 fingerprint = 0;
+    QByteArray chunks;
+
+    void finishChunk();
+};
+
+}
+
+#endif // HASHER_H
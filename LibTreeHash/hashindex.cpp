@@ -0,0 +1,298 @@
+#include "hashindex.h"
+#include <algorithm>
+#include <sys/mman.h>
+
+using namespace TreeHash;
+
+namespace{
+
+EntryView viewOf(std::string_view path, const FileEntry& entry){
+    EntryView view;
+    view.path = path;
+    view.hash = entry.hash;
+    view.lastModified = entry.lastModified;
+    view.size = entry.size;
+    view.hashState = entry.hashState;
+    view.tailFingerprint = entry.tailFingerprint;
+    view.blockSize = entry.blockSize;
+    view.blockHashes = entry.blockHashes;
+    view.chunkSize = entry.chunkSize;
+    view.chunks = entry.chunks;
+    view.lastVerified = entry.lastVerified;
+    view.mtimeNs = entry.mtimeNs;
+    view.ctimeNs = entry.ctimeNs;
+    view.inode = entry.inode;
+    return view;
+}
+
+}
+
+FileEntry EntryView::toEntry() const{
+    FileEntry entry;
+    entry.hash = this->hash.toByteArray();
+    entry.lastModified = this->lastModified;
+    entry.size = this->size;
+    entry.hashState = this->hashState.toByteArray();
+    entry.tailFingerprint = this->tailFingerprint.toByteArray();
+    entry.blockSize = this->blockSize;
+    entry.blockHashes = this->blockHashes.toByteArray();
+    entry.chunkSize = this->chunkSize;
+    entry.chunks = this->chunks.toByteArray();
+    entry.lastVerified = this->lastVerified;
+    entry.mtimeNs = this->mtimeNs;
+    entry.ctimeNs = this->ctimeNs;
+    entry.inode = this->inode;
+    return entry;
+}
+
+void HashTable::Builder::reserve(size_t entries){
+    this->records.reserve(entries);
+}
+
+void HashTable::Builder::add(const EntryView& entry){
+    Record rec;
+    rec.pathOffset = this->strings.size();
+    rec.pathLength = static_cast<quint32>(entry.path.size());
+    rec.hashOffset = this->hashes.size();
+    rec.hashLength = static_cast<quint32>(entry.hash.size());
+    rec.lastModified = entry.lastModified;
+    rec.size = entry.size;
+    rec.hashStateLength = static_cast<quint32>(entry.hashState.size());
+    rec.tailFingerprintLength = static_cast<quint32>(entry.tailFingerprint.size());
+    rec.blockSize = static_cast<quint32>(entry.blockSize);
+    rec.blockHashesLength = static_cast<quint32>(entry.blockHashes.size());
+    rec.chunkSize = static_cast<quint32>(entry.chunkSize);
+    rec.chunksLength = static_cast<quint32>(entry.chunks.size());
+    rec.lastVerified = entry.lastVerified;
+    rec.mtimeNs = entry.mtimeNs;
+    rec.ctimeNs = entry.ctimeNs;
+    rec.inode = entry.inode;
+
+    this->strings.insert(this->strings.end(), entry.path.begin(), entry.path.end());
+    for(const QByteArrayView data : {entry.hash, entry.hashState, entry.tailFingerprint, entry.blockHashes, entry.chunks})
+        this->hashes.insert(this->hashes.end(), data.begin(), data.end());
+    this->records.push_back(rec);
+}
+
+std::shared_ptr<const HashTable> HashTable::Builder::build(){
+    const char* strings = this->strings.data();
+    const auto pathOf = [strings](const Record& rec) -> std::string_view{
+        return std::string_view(strings + rec.pathOffset, rec.pathLength);
+    };
+    const auto lessByPath = [&pathOf](const Record& a, const Record& b) -> bool{
+        return pathOf(a) < pathOf(b);
+    };
+
+    // hash-files are written in order, so sorting is mostly not necessary
+    const bool sortedAndUnique = std::adjacent_find(this->records.begin(), this->records.end(),
+        [&pathOf](const Record& a, const Record& b) -> bool{
+            return !(pathOf(a) < pathOf(b));
+        }) == this->records.end();
+
+    if(!sortedAndUnique){
+        std::stable_sort(this->records.begin(), this->records.end(), lessByPath);
+
+        // remove duplicates (keep the last one)
+        std::vector<Record> unique;
+        unique.reserve(this->records.size());
+        for(const Record& rec : this->records){
+            if(!unique.empty() && pathOf(unique.back()) == pathOf(rec))
+                unique.back() = rec;
+            else
+                unique.push_back(rec);
+        }
+        this->records = std::move(unique);
+    }
+
+    auto table = std::make_shared<HashTable>();
+    table->takeOwnership(std::move(this->records), std::move(this->strings), std::move(this->hashes));
+    this->records.clear();
+    this->strings.clear();
+    this->hashes.clear();
+    return table;
+}
+
+HashTable::~HashTable(){
+    if(this->mapping != nullptr)
+        munmap(this->mapping, this->mappingSize);
+}
+
+std::shared_ptr<const HashTable> HashTable::fromMemory(const Record* records, size_t recordCount,
+                                                       const char* strings, size_t stringsSize,
+                                                       const char* hashes, size_t hashesSize,
+                                                       void* mapping, size_t mappingSize){
+    auto table = std::make_shared<HashTable>();
+    table->records = records;
+    table->recordCount = recordCount;
+    table->strings = strings;
+    table->stringsSize = stringsSize;
+    table->hashes = hashes;
+    table->hashesSize = hashesSize;
+    table->mapping = mapping;
+    table->mappingSize = mappingSize;
+    return table;
+}
+
+void HashTable::takeOwnership(std::vector<Record>&& records, std::vector<char>&& strings, std::vector<char>&& hashes){
+    this->ownedRecords = std::move(records);
+    this->ownedStrings = std::move(strings);
+    this->ownedHashes = std::move(hashes);
+
+    this->records = this->ownedRecords.data();
+    this->recordCount = this->ownedRecords.size();
+    this->strings = this->ownedStrings.data();
+    this->stringsSize = this->ownedStrings.size();
+    this->hashes = this->ownedHashes.data();
+    this->hashesSize = this->ownedHashes.size();
+}
+
+std::string_view HashTable::path(size_t i) const{
+    // the data may come from a file, so never trust the offsets
+    const Record& rec = this->records[i];
+    if(rec.pathOffset > this->stringsSize || rec.pathLength > this->stringsSize - rec.pathOffset)
+        return std::string_view();
+    return std::string_view(this->strings + rec.pathOffset, rec.pathLength);
+}
+
+EntryView HashTable::entry(size_t i) const{
+    const Record& rec = this->records[i];
+
+    EntryView view;
+    view.path = this->path(i);
+    view.lastModified = rec.lastModified;
+    view.size = rec.size;
+    view.lastVerified = rec.lastVerified;
+    view.mtimeNs = rec.mtimeNs;
+    view.ctimeNs = rec.ctimeNs;
+    view.inode = rec.inode;
+    if(rec.hashOffset <= this->hashesSize && rec.hashLength <= this->hashesSize - rec.hashOffset){
+        view.hash = QByteArrayView(this->hashes + rec.hashOffset, rec.hashLength);
+
+        // the other data is optional -> ignore it if it is out of bounds
+        const char* extra = this->hashes + rec.hashOffset + rec.hashLength;
+        const quint64 extraLength = static_cast<quint64>(rec.hashStateLength) + rec.tailFingerprintLength
+                                    + rec.blockHashesLength + rec.chunksLength;
+        if(extraLength <= this->hashesSize - rec.hashOffset - rec.hashLength){
+            view.hashState = QByteArrayView(extra, rec.hashStateLength);
+            view.tailFingerprint = QByteArrayView(extra + rec.hashStateLength, rec.tailFingerprintLength);
+            view.blockSize = rec.blockSize;
+            view.blockHashes = QByteArrayView(extra + rec.hashStateLength + rec.tailFingerprintLength, rec.blockHashesLength);
+            view.chunkSize = rec.chunkSize;
+            view.chunks = QByteArrayView(view.blockHashes.data() + rec.blockHashesLength, rec.chunksLength);
+        }
+    }
+    return view;
+}
+
+size_t HashTable::find(std::string_view path) const{
+    size_t lo = 0, hi = this->recordCount;
+    while(lo < hi){
+        const size_t mid = lo + (hi - lo) / 2;
+        if(this->path(mid) < path)
+            lo = mid + 1;
+        else
+            hi = mid;
+    }
+
+    if(lo < this->recordCount && this->path(lo) == path)
+        return lo;
+    return this->recordCount;
+}
+
+std::shared_ptr<const HashTable> HashTable::detached() const{
+    auto table = std::make_shared<HashTable>();
+    table->takeOwnership(std::vector<Record>(this->records, this->records + this->recordCount),
+                         std::vector<char>(this->strings, this->strings + this->stringsSize),
+                         std::vector<char>(this->hashes, this->hashes + this->hashesSize));
+    return table;
+}
+
+HashIndex::HashIndex()
+    : base(std::make_shared<HashTable>()), entryCount(0)
+{}
+
+HashIndex::HashIndex(std::shared_ptr<const HashTable> base)
+    : base(std::move(base))
+{
+    this->entryCount = this->base->size();
+}
+
+std::optional<EntryView> HashIndex::find(std::string_view path) const{
+    if(const auto iter = this->overlay.find(path); iter != this->overlay.end()){
+        if(!iter->second)
+            return std::nullopt;
+
+        return viewOf(iter->first, *iter->second);
+    }
+
+    const size_t idx = this->base->find(path);
+    if(idx == this->base->size())
+        return std::nullopt;
+    return this->base->entry(idx);
+}
+
+bool HashIndex::contains(std::string_view path) const{
+    if(const auto iter = this->overlay.find(path); iter != this->overlay.end())
+        return iter->second.has_value();
+    return this->base->find(path) != this->base->size();
+}
+
+void HashIndex::put(std::string_view path, FileEntry entry){
+    if(const auto iter = this->overlay.find(path); iter != this->overlay.end()){
+        if(!iter->second)
+            this->entryCount++;
+        iter->second = std::move(entry);
+    }else{
+        if(this->base->find(path) == this->base->size())
+            this->entryCount++;
+        this->overlay.emplace(std::string(path), std::move(entry));
+    }
+}
+
+bool HashIndex::erase(std::string_view path){
+    const bool inBase = this->base->find(path) != this->base->size();
+
+    if(const auto iter = this->overlay.find(path); iter != this->overlay.end()){
+        if(!iter->second)
+            return false;
+
+        if(inBase)
+            iter->second.reset();
+        else
+            this->overlay.erase(iter);
+        this->entryCount--;
+        return true;
+    }
+
+    if(inBase){
+        this->overlay.emplace(std::string(path), std::nullopt);
+        this->entryCount--;
+        return true;
+    }
+    return false;
+}
+
+void HashIndex::forEach(const std::function<void(const EntryView&)>& fn) const{
+    // merge base and overlay (both are sorted by path)
+    const size_t baseSize = this->base->size();
+    size_t i = 0;
+    auto o = this->overlay.begin();
+    while(i < baseSize || o != this->overlay.end()){
+        if(o == this->overlay.end() || (i < baseSize && this->base->path(i) < std::string_view(o->first))){
+            fn(this->base->entry(i));
+            i++;
+        }else{
+            if(i < baseSize && this->base->path(i) == std::string_view(o->first))
+                i++;// replaced or removed by overlay
+
+            if(o->second)
+                fn(viewOf(o->first, *o->second));
+            o++;
+        }
+    }
+}
+
+void HashIndex::detach(){
+    if(this->base->isMapped())
+        this->base = this->base->detached();
+}
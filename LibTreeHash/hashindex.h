@@ -0,0 +1,232 @@
+#ifndef HASHINDEX_H
+#define HASHINDEX_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QByteArrayView>
+#include <string>
+#include <string_view>
+#include <vector>
+#include <map>
+#include <optional>
+#include <memory>
+#include <functional>
+
+namespace TreeHash{
+
+/**
+ * @brief the stored data of a file
+ */
+struct FileEntry{
+    /// the raw digest (empty if the stored hash was malformed)
+    QByteArray hash;
+    /// modification-time in seconds since epoch (-1 if unknown)
+    qint64 lastModified = -1;
+    /// size of the file when it was hashed (-1 if unknown)
+    qint64 size = -1;
+    /// serialized state of the hash-function after size bytes (see Hasher::saveState(); empty if not kept);
+    ///     if the file only grew since then just the appended data has to be hashed
+    QByteArray hashState;
+    /// digest of the last bytes before size; used to check that the hashed data was not changed since
+    QByteArray tailFingerprint;
+    /// size of the blocks of blockHashes (0 if no block-hashes are stored)
+    qint64 blockSize = 0;
+    /// the concatenated digests of all blocks (see BlockListHasher)
+    QByteArray blockHashes;
+    /// targeted average size of the chunks (0 if no chunk-list is stored)
+    qint64 chunkSize = 0;
+    /// the content-defined chunks of the file (see ChunkIndexer)
+    QByteArray chunks;
+    /// time of the last VERIFY which found the file intact, in seconds since epoch (-1 if never)
+    qint64 lastVerified = -1;
+    /// modification-time in nanoseconds since epoch when the file was hashed (-1 if unknown)
+    qint64 mtimeNs = -1;
+    /// status-change-time (ctime) in nanoseconds since epoch when the file was hashed (-1 if unknown)
+    qint64 ctimeNs = -1;
+    /// inode-number of the file when it was hashed (-1 if unknown)
+    qint64 inode = -1;
+};
+
+/**
+ * @brief read-only view of an entry;
+ *      it points into the HashIndex (or the mapped hash-file) and is only valid until the index is modified
+ */
+struct EntryView{
+    std::string_view path;
+    QByteArrayView hash;
+    qint64 lastModified = -1;
+    qint64 size = -1;
+    QByteArrayView hashState;
+    QByteArrayView tailFingerprint;
+    qint64 blockSize = 0;
+    QByteArrayView blockHashes;
+    qint64 chunkSize = 0;
+    QByteArrayView chunks;
+    qint64 lastVerified = -1;
+    qint64 mtimeNs = -1;
+    qint64 ctimeNs = -1;
+    qint64 inode = -1;
+
+    FileEntry toEntry() const;
+};
+
+/**
+ * @brief immutable table of entries, sorted by path;
+ *      the data is either owned by the table or points into a memory-mapped binary hash-file
+ */
+class HashTable{
+
+    Q_DISABLE_COPY(HashTable)
+
+public:
+    /**
+     * @brief fixed-width record (layout of the binary hash-file);
+     *      the offsets are relative to the start of the strings- / hashes-section;
+     *      the hash-state, the tail-fingerprint, the block-hashes and the chunks follow the digest in the hashes-section
+     */
+    struct Record{
+        quint64 pathOffset;
+        quint64 hashOffset;
+        qint64 lastModified;
+        quint32 pathLength;
+        quint32 hashLength;
+        qint64 size;
+        quint32 hashStateLength;
+        quint32 tailFingerprintLength;
+        quint32 blockSize;
+        quint32 blockHashesLength;
+        quint32 chunkSize;
+        quint32 chunksLength;
+        qint64 lastVerified;
+        qint64 mtimeNs;
+        qint64 ctimeNs;
+        qint64 inode;
+    };
+    static_assert(sizeof(Record) == 96, "the binary format relies on the layout of Record");
+
+    /**
+     * @brief collects entries (in any order) and creates an owning table from them
+     */
+    class Builder{
+    public:
+        void reserve(size_t entries);
+        /// adds an entry; if a path is added multiple times the last one wins
+        void add(const EntryView& entry);
+        void add(std::string_view path, QByteArrayView hash, qint64 lastModified){
+            EntryView entry;
+            entry.path = path;
+            entry.hash = hash;
+            entry.lastModified = lastModified;
+            this->add(entry);
+        }
+        std::shared_ptr<const HashTable> build();
+
+    private:
+        std::vector<Record> records;
+        std::vector<char> strings;
+        std::vector<char> hashes;
+    };
+
+    HashTable() = default;
+    ~HashTable();
+
+    /**
+     * @brief creates a table which uses the given memory directly;
+     *      ATTENTION: records must be sorted by path and all memory must stay valid as long as the table exists
+     * @param mapping if not nullptr it will be unmapped (munmap) when the table is destroyed
+     */
+    static std::shared_ptr<const HashTable> fromMemory(const Record* records, size_t recordCount,
+                                                       const char* strings, size_t stringsSize,
+                                                       const char* hashes, size_t hashesSize,
+                                                       void* mapping, size_t mappingSize);
+
+    size_t size() const{
+        return this->recordCount;
+    }
+
+    /// returns true if the data points into a memory-mapped file
+    bool isMapped() const{
+        return this->mapping != nullptr;
+    }
+
+    std::string_view path(size_t i) const;
+    EntryView entry(size_t i) const;
+
+    /**
+     * @brief binary-search for the path
+     * @return the index of the entry or size() if it does not exist
+     */
+    size_t find(std::string_view path) const;
+
+    /**
+     * @brief returns a copy of this table which owns its data
+     */
+    std::shared_ptr<const HashTable> detached() const;
+
+private:
+    const Record* records = nullptr;
+    size_t recordCount = 0;
+    const char* strings = nullptr;
+    size_t stringsSize = 0;
+    const char* hashes = nullptr;
+    size_t hashesSize = 0;
+
+    std::vector<Record> ownedRecords;
+    std::vector<char> ownedStrings;
+    std::vector<char> ownedHashes;
+
+    void* mapping = nullptr;
+    size_t mappingSize = 0;
+
+    void takeOwnership(std::vector<Record>&& records, std::vector<char>&& strings, std::vector<char>&& hashes);
+};
+
+/**
+ * @brief the entries of a hash-file;
+ *      it consists of an immutable base-table (as loaded) and the modifications made since then
+ */
+class HashIndex{
+public:
+    HashIndex();
+    explicit HashIndex(std::shared_ptr<const HashTable> base);
+
+    size_t size() const{
+        return this->entryCount;
+    }
+
+    std::optional<EntryView> find(std::string_view path) const;
+    bool contains(std::string_view path) const;
+
+    /// adds or replaces the entry
+    void put(std::string_view path, FileEntry entry);
+    /// returns true if the entry existed
+    bool erase(std::string_view path);
+
+    /**
+     * @brief calls fn for every entry, ordered by path
+     *      ATTENTION: do not modify the index from within fn
+     */
+    void forEach(const std::function<void(const EntryView&)>& fn) const;
+
+    /**
+     * @brief returns true if the base-table points into a memory-mapped file
+     */
+    bool isMapped() const{
+        return this->base->isMapped();
+    }
+    /**
+     * @brief copies a memory-mapped base-table into memory
+     *      (needed before the mapped file gets overwritten in place)
+     */
+    void detach();
+
+private:
+    std::shared_ptr<const HashTable> base;
+    /// modified entries; nullopt marks a removed entry of the base-table
+    std::map<std::string, std::optional<FileEntry>, std::less<>> overlay;
+    size_t entryCount;
+};
+
+}
+
+#endif // HASHINDEX_H
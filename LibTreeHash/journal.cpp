@@ -0,0 +1,549 @@
+#include "journal.h"
+#include <QFile>
+#include <QFileInfo>
+#include <algorithm>
+#include <array>
+#include <cerrno>
+#include <cstring>
+#include <fcntl.h>
+#include <unistd.h>
+
+using namespace TreeHash;
+using namespace nlohmann;
+
+namespace{
+
+/// payload-length (4), CRC32 (4), type (1)
+constexpr qint64 RECORD_HEADER_SIZE = 9;
+
+constexpr std::array<quint32, 256> CRC_TABLE = []{
+    std::array<quint32, 256> table{};
+    for(quint32 i = 0; i < 256; i++){
+        quint32 c = i;
+        for(int k = 0; k < 8; k++)
+            c = (c & 1) ? 0xEDB88320u ^ (c >> 1) : c >> 1;
+        table[i] = c;
+    }
+    return table;
+}();
+
+quint32 crc32(const char* data, size_t len){
+    quint32 crc = 0xFFFFFFFFu;
+    for(size_t i = 0; i < len; i++)
+        crc = CRC_TABLE[(crc ^ static_cast<unsigned char>(data[i])) & 0xFF] ^ (crc >> 8);
+    return crc ^ 0xFFFFFFFFu;
+}
+
+// all numbers are stored as little-endian
+
+void putU32(std::string& out, quint32 val){
+    for(int i = 0; i < 4; i++)
+        out.push_back(static_cast<char>(val >> (8 * i)));
+}
+
+void putI64(std::string& out, qint64 val){
+    const quint64 uval = static_cast<quint64>(val);
+    for(int i = 0; i < 8; i++)
+        out.push_back(static_cast<char>(uval >> (8 * i)));
+}
+
+void putBytes(std::string& out, const char* data, size_t len){
+    putU32(out, static_cast<quint32>(len));
+    out.append(data, len);
+}
+
+quint32 getU32(const char* data){
+    quint32 val = 0;
+    for(int i = 0; i < 4; i++)
+        val |= static_cast<quint32>(static_cast<unsigned char>(data[i])) << (8 * i);
+    return val;
+}
+
+/**
+ * @brief reads the fields of a record-payload (with bounds checks)
+ */
+class PayloadReader{
+public:
+    PayloadReader(const char* data, size_t len)
+        : cur(data), end(data + len)
+    {}
+
+    bool readU32(quint32& out){
+        if(this->end - this->cur < 4)
+            return false;
+        out = getU32(this->cur);
+        this->cur += 4;
+        return true;
+    }
+
+    bool readI64(qint64& out){
+        if(this->end - this->cur < 8)
+            return false;
+        quint64 val = 0;
+        for(int i = 0; i < 8; i++)
+            val |= static_cast<quint64>(static_cast<unsigned char>(this->cur[i])) << (8 * i);
+        out = static_cast<qint64>(val);
+        this->cur += 8;
+        return true;
+    }
+
+    bool readBytes(std::string_view& out){
+        quint32 len;
+        if(!this->readU32(len) || static_cast<size_t>(this->end - this->cur) < len)
+            return false;
+        out = std::string_view(this->cur, len);
+        this->cur += len;
+        return true;
+    }
+
+private:
+    const char* cur;
+    const char* const end;
+};
+
+bool applyRecord(Journal::RecordType type, const char* payload, size_t len, HashIndex& index, json& settings,
+                 Journal::UnfinishedRun& run){
+    PayloadReader reader(payload, len);
+    switch(type){
+        case Journal::RecordType::PUT: {
+            std::string_view path, hash, hashState, tailFingerprint, blockHashes, chunks;
+            FileEntry entry;
+            if(!reader.readBytes(path) || !reader.readBytes(hash) || !reader.readI64(entry.lastModified)
+                    || !reader.readI64(entry.size) || !reader.readBytes(hashState) || !reader.readBytes(tailFingerprint)
+                    || !reader.readI64(entry.blockSize) || !reader.readBytes(blockHashes)
+                    || !reader.readI64(entry.chunkSize) || !reader.readBytes(chunks)
+                    || !reader.readI64(entry.lastVerified)
+                    || !reader.readI64(entry.mtimeNs) || !reader.readI64(entry.ctimeNs) || !reader.readI64(entry.inode))
+                return false;
+            entry.hash = QByteArray(hash.data(), hash.size());
+            entry.hashState = QByteArray(hashState.data(), hashState.size());
+            entry.tailFingerprint = QByteArray(tailFingerprint.data(), tailFingerprint.size());
+            entry.blockHashes = QByteArray(blockHashes.data(), blockHashes.size());
+            entry.chunks = QByteArray(chunks.data(), chunks.size());
+            index.put(path, std::move(entry));
+            if(run.exists){
+                run.completed.emplace(path);
+                run.partial.erase(std::string(path));
+            }
+            return true;
+        }
+        case Journal::RecordType::ERASE: {
+            std::string_view path;
+            if(!reader.readBytes(path))
+                return false;
+            index.erase(path);
+            if(run.exists){
+                run.completed.erase(std::string(path));
+                run.partial.erase(std::string(path));
+            }
+            return true;
+        }
+        case Journal::RecordType::RUN_BEGIN: {
+            // a new run replaces an unfinished one
+            run = Journal::UnfinishedRun();
+            run.exists = true;
+            return true;
+        }
+        case Journal::RecordType::RUN_END: {
+            run = Journal::UnfinishedRun();
+            return true;
+        }
+        case Journal::RecordType::HASH_PROGRESS: {
+            std::string_view path, state, blockState;
+            Journal::HashProgress progress;
+            if(!reader.readBytes(path) || !reader.readI64(progress.offset) || !reader.readI64(progress.size)
+                    || !reader.readI64(progress.lastModified) || !reader.readBytes(state) || !reader.readBytes(blockState))
+                return false;
+            if(run.exists){
+                progress.state = QByteArray(state.data(), state.size());
+                progress.blockState = QByteArray(blockState.data(), blockState.size());
+                run.partial[std::string(path)] = std::move(progress);
+            }
+            return true;
+        }
+        case Journal::RecordType::VERIFIED: {
+            std::string_view path;
+            qint64 lastVerified;
+            if(!reader.readBytes(path) || !reader.readI64(lastVerified))
+                return false;
+            if(const auto existing = index.find(path); existing){
+                FileEntry entry = existing->toEntry();
+                entry.lastVerified = lastVerified;
+                index.put(path, std::move(entry));
+            }
+            return true;
+        }
+        case Journal::RecordType::SETTINGS: {
+            json parsed = json::parse(payload, payload + len, nullptr, false);
+            if(parsed.is_discarded())
+                return false;
+            settings = std::move(parsed);
+            return true;
+        }
+    }
+    return false;
+}
+
+bool writeAll(int fd, const char* data, size_t len){
+    while(len > 0){
+        const ssize_t written = ::write(fd, data, len);
+        if(written < 0){
+            if(errno == EINTR)
+                continue;
+            return false;
+        }
+        data += written;
+        len -= static_cast<size_t>(written);
+    }
+    return true;
+}
+
+std::string fileHeader(){
+    std::string header(Journal::MAGIC, sizeof(Journal::MAGIC));
+    putU32(header, Journal::VERSION);
+    return header;
+}
+
+/**
+ * @brief syncs the dir containing path (so that a created or renamed file survives a crash)
+ */
+void syncParentDir(const QString& path){
+    const int dirFd = ::open(QFile::encodeName(QFileInfo(path).absolutePath()).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(dirFd == -1)
+        return;
+    fsync(dirFd);
+    ::close(dirFd);
+}
+
+QString errnoString(){
+    return QString::fromLocal8Bit(strerror(errno));
+}
+
+}
+
+QString Journal::pathFor(const QString& hashFilePath){
+    return hashFilePath + QStringLiteral(".journal");
+}
+
+qint64 Journal::replay(const QString& path, HashIndex& index, json& settings, UnfinishedRun* run, QString* error){
+    UnfinishedRun replayedRun;
+    if(run != nullptr)
+        *run = UnfinishedRun();
+
+    QFile file(path);
+    if(!file.exists()){
+        if(error != nullptr)
+            *error = QString();
+        return 0;
+    }
+    if(!file.open(QFile::OpenModeFlag::ReadOnly)){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to open journal (%1)").arg(file.errorString());
+        return -1;
+    }
+
+    const QByteArray content = file.readAll();
+    const char* data = content.constData();
+    const qint64 size = content.size();
+
+    if(size < HEADER_SIZE){
+        // the header was not completely written -> nothing was journaled
+        if(error != nullptr)
+            *error = QString();
+        return 0;
+    }
+    if(std::memcmp(data, MAGIC, sizeof(MAGIC)) != 0 || getU32(data + sizeof(MAGIC)) != VERSION){
+        if(error != nullptr)
+            *error = QStringLiteral("can not load version of journal");
+        return -1;
+    }
+
+    qint64 pos = HEADER_SIZE;
+    while(size - pos >= RECORD_HEADER_SIZE){
+        const quint32 payloadLen = getU32(data + pos);
+        const quint32 crc = getU32(data + pos + 4);
+        if(payloadLen > size - pos - RECORD_HEADER_SIZE)
+            break;// incomplete
+
+        const char* typeAndPayload = data + pos + 8;
+        if(crc32(typeAndPayload, payloadLen + 1) != crc)
+            break;// corrupt
+
+        const auto type = static_cast<RecordType>(static_cast<quint8>(typeAndPayload[0]));
+        if(!applyRecord(type, typeAndPayload + 1, payloadLen, index, settings, replayedRun))
+            break;
+
+        pos += RECORD_HEADER_SIZE + payloadLen;
+    }
+
+    if(run != nullptr)
+        *run = std::move(replayedRun);
+
+    if(error != nullptr)
+        *error = QString();
+    return pos;
+}
+
+bool Journal::remove(const QString& path){
+    if(!QFile::exists(path))
+        return true;
+    return QFile::remove(path);
+}
+
+Journal::~Journal(){
+    this->close();
+}
+
+bool Journal::open(const QString& path, qint64 validSize, QString* error){
+    this->close();
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->failure = QString();
+
+    const int newFd = ::open(QFile::encodeName(path).constData(), O_RDWR | O_CREAT | O_APPEND | O_CLOEXEC, 0666);
+    if(newFd == -1){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to open journal (%1)").arg(errnoString());
+        return false;
+    }
+
+    bool ok;
+    if(validSize < HEADER_SIZE){
+        // new journal (or its header is incomplete)
+        const std::string header = fileHeader();
+        ok = ftruncate(newFd, 0) == 0 && writeAll(newFd, header.data(), header.size()) && fdatasync(newFd) == 0;
+        if(ok)
+            syncParentDir(path);
+        validSize = HEADER_SIZE;
+    }else{
+        // drop a torn tail, so that new records directly follow the intact ones
+        ok = ftruncate(newFd, validSize) == 0;
+    }
+    if(!ok){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to prepare journal (%1)").arg(errnoString());
+        ::close(newFd);
+        return false;
+    }
+
+    this->path = path;
+    this->fd = newFd;
+    this->committedSize = validSize;
+    this->pending.clear();
+    this->pendingRecords = 0;
+
+    if(error != nullptr)
+        *error = QString();
+    return true;
+}
+
+void Journal::close(){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if(this->fd == -1)
+        return;
+
+    this->commitLocked(nullptr);
+    ::close(this->fd);
+    this->fd = -1;
+}
+
+bool Journal::isOpen() const{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->fd != -1;
+}
+
+void Journal::setGroupCommit(int maxRecords, std::chrono::milliseconds maxDelay){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    this->maxPendingRecords = maxRecords;
+    this->maxPendingDelay = maxDelay;
+}
+
+void Journal::put(std::string_view path, const FileEntry& entry){
+    std::string payload;
+    payload.reserve(path.size() + entry.hash.size() + entry.hashState.size() + entry.tailFingerprint.size()
+                    + entry.blockHashes.size() + entry.chunks.size() + 92);
+    putBytes(payload, path.data(), path.size());
+    putBytes(payload, entry.hash.constData(), entry.hash.size());
+    putI64(payload, entry.lastModified);
+    putI64(payload, entry.size);
+    putBytes(payload, entry.hashState.constData(), entry.hashState.size());
+    putBytes(payload, entry.tailFingerprint.constData(), entry.tailFingerprint.size());
+    putI64(payload, entry.blockSize);
+    putBytes(payload, entry.blockHashes.constData(), entry.blockHashes.size());
+    putI64(payload, entry.chunkSize);
+    putBytes(payload, entry.chunks.constData(), entry.chunks.size());
+    putI64(payload, entry.lastVerified);
+    putI64(payload, entry.mtimeNs);
+    putI64(payload, entry.ctimeNs);
+    putI64(payload, entry.inode);
+    this->append(RecordType::PUT, payload);
+}
+
+void Journal::erase(std::string_view path){
+    std::string payload;
+    putBytes(payload, path.data(), path.size());
+    this->append(RecordType::ERASE, payload);
+}
+
+void Journal::storeSettings(const json& settings){
+    this->append(RecordType::SETTINGS, settings.dump());
+}
+
+void Journal::beginRun(){
+    this->append(RecordType::RUN_BEGIN, std::string());
+}
+
+void Journal::endRun(){
+    this->append(RecordType::RUN_END, std::string());
+}
+
+void Journal::hashProgress(std::string_view path, const HashProgress& progress){
+    std::string payload;
+    payload.reserve(path.size() + progress.state.size() + progress.blockState.size() + 40);
+    putBytes(payload, path.data(), path.size());
+    putI64(payload, progress.offset);
+    putI64(payload, progress.size);
+    putI64(payload, progress.lastModified);
+    putBytes(payload, progress.state.constData(), progress.state.size());
+    putBytes(payload, progress.blockState.constData(), progress.blockState.size());
+    this->append(RecordType::HASH_PROGRESS, payload);
+}
+
+void Journal::verified(std::string_view path, qint64 lastVerified){
+    std::string payload;
+    payload.reserve(path.size() + 12);
+    putBytes(payload, path.data(), path.size());
+    putI64(payload, lastVerified);
+    this->append(RecordType::VERIFIED, payload);
+}
+
+void Journal::append(RecordType type, const std::string& payload){
+    std::string typeAndPayload;
+    typeAndPayload.reserve(payload.size() + 1);
+    typeAndPayload.push_back(static_cast<char>(type));
+    typeAndPayload.append(payload);
+
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if(this->fd == -1)
+        return;
+
+    putU32(this->pending, static_cast<quint32>(payload.size()));
+    putU32(this->pending, crc32(typeAndPayload.data(), typeAndPayload.size()));
+    this->pending.append(typeAndPayload);
+
+    if(this->pendingRecords++ == 0)
+        this->firstPending = std::chrono::steady_clock::now();
+}
+
+bool Journal::commit(QString* error){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->commitLocked(error);
+}
+
+bool Journal::commitIfDue(QString* error){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if(this->pendingRecords < this->maxPendingRecords
+            && (this->pendingRecords == 0 || std::chrono::steady_clock::now() - this->firstPending < this->maxPendingDelay)){
+        if(error != nullptr)
+            *error = QString();
+        return true;
+    }
+    return this->commitLocked(error);
+}
+
+bool Journal::commitLocked(QString* error){
+    if(this->fd == -1){
+        if(error != nullptr)
+            *error = this->failure.isNull() ? QStringLiteral("journal is not open") : this->failure;
+        return false;
+    }
+
+    if(!this->pending.empty()){
+        if(!writeAll(this->fd, this->pending.data(), this->pending.size()) || fdatasync(this->fd) != 0){
+            if(error != nullptr)
+                *error = QStringLiteral("unable to write journal (%1)").arg(errnoString());
+            // do not leave a partial record in front of the next ones (the records stay pending)
+            if(ftruncate(this->fd, this->committedSize) != 0){
+                // the next records would follow the partial one and the replay would stop in front of them
+                // -> close the journal, so that the following commits fail
+                this->failure = QStringLiteral("journal was closed as a partial record could not be removed (%1)").arg(errnoString());
+                if(error != nullptr)
+                    *error += QStringLiteral("; ") + this->failure;
+                ::close(this->fd);
+                this->fd = -1;
+                this->pending.clear();
+                this->pendingRecords = 0;
+            }
+            return false;
+        }
+
+        this->committedSize += static_cast<qint64>(this->pending.size());
+        this->pending.clear();
+        this->pendingRecords = 0;
+    }
+
+    if(error != nullptr)
+        *error = QString();
+    return true;
+}
+
+qint64 Journal::size() const{
+    std::lock_guard<std::mutex> lock(this->mtx);
+    return this->committedSize;
+}
+
+bool Journal::dropUpTo(qint64 offset, QString* error){
+    std::lock_guard<std::mutex> lock(this->mtx);
+    if(this->fd == -1){
+        if(error != nullptr)
+            *error = QStringLiteral("journal is not open");
+        return false;
+    }
+
+    offset = std::clamp(offset, HEADER_SIZE, this->committedSize);
+
+    // keep the records after offset (pending records stay in memory and go to the new file)
+    std::string content = fileHeader();
+    const size_t headerSize = content.size();
+    content.resize(headerSize + static_cast<size_t>(this->committedSize - offset));
+    size_t done = 0;
+    while(done < content.size() - headerSize){
+        const ssize_t n = pread(this->fd, content.data() + headerSize + done, content.size() - headerSize - done,
+                                offset + static_cast<qint64>(done));
+        if(n <= 0){
+            if(n < 0 && errno == EINTR)
+                continue;
+            if(error != nullptr)
+                *error = QStringLiteral("unable to read journal (%1)").arg(errnoString());
+            return false;
+        }
+        done += static_cast<size_t>(n);
+    }
+
+    const QString tmpPath = this->path + QStringLiteral(".tmp");
+    const QByteArray nativeTmpPath = QFile::encodeName(tmpPath);
+    const int newFd = ::open(nativeTmpPath.constData(), O_RDWR | O_CREAT | O_TRUNC | O_APPEND | O_CLOEXEC, 0666);
+    if(newFd == -1){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to create journal (%1)").arg(errnoString());
+        return false;
+    }
+
+    if(!writeAll(newFd, content.data(), content.size()) || fdatasync(newFd) != 0
+            || rename(nativeTmpPath.constData(), QFile::encodeName(this->path).constData()) != 0){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to replace journal (%1)").arg(errnoString());
+        ::close(newFd);
+        ::unlink(nativeTmpPath.constData());
+        return false;
+    }
+    syncParentDir(this->path);
+
+    ::close(this->fd);
+    this->fd = newFd;
+    this->committedSize = static_cast<qint64>(content.size());
+
+    if(error != nullptr)
+        *error = QString();
+    return true;
+}
@@ -0,0 +1,181 @@
+#ifndef JOURNAL_H
+#define JOURNAL_H
+
+#include <QString>
+#include <chrono>
+#include <mutex>
+#include <string>
+#include <unordered_map>
+#include <unordered_set>
+#include "hashindex.h"
+#include "ext/nlohmann/json.hpp"
+
+namespace TreeHash{
+
+/**
+ * @brief append-only log of the changes to a hash-file (see FileFormat.txt);
+ *      records are buffered and synced in groups (group commit), so saving costs only the size of the changes.
+ *      All methods are thread-safe.
+ */
+class Journal{
+public:
+
+    static constexpr char MAGIC[8] = {'T', 'H', 'J', 'O', 'U', 'R', 'N', 'L'};
+    static constexpr quint32 VERSION = 1;
+    static constexpr qint64 HEADER_SIZE = sizeof(MAGIC) + sizeof(quint32);
+
+    enum class RecordType : quint8{
+        PUT = 1,
+        ERASE = 2,
+        SETTINGS = 3,
+        RUN_BEGIN = 4,
+        RUN_END = 5,
+        HASH_PROGRESS = 6,
+        VERIFIED = 7
+    };
+
+    /**
+     * @brief intermediate state of hashing a file (so that an interrupted run can continue from offset)
+     */
+    struct HashProgress{
+        /// count of bytes which were hashed
+        qint64 offset = 0;
+        /// size of the file (it must not have changed when continuing)
+        qint64 size = 0;
+        /// modification time of the file in milliseconds (it must not have changed when continuing)
+        qint64 lastModified = 0;
+        /// state of the hash-function (see Hasher::saveState())
+        QByteArray state;
+        /// state of the block-hashes (see BlockListHasher::saveState(); empty if none are computed)
+        QByteArray blockState;
+    };
+
+    /**
+     * @brief state of a run which was started (RUN_BEGIN) but did not finish (no RUN_END) before the journal ended
+     */
+    struct UnfinishedRun{
+        bool exists = false;
+        /// paths which were put since the run began
+        std::unordered_set<std::string> completed;
+        /// the last progress of files which were not completed
+        std::unordered_map<std::string, HashProgress> partial;
+    };
+
+    /**
+     * @brief returns the path of the journal which belongs to the given hash-file
+     */
+    static QString pathFor(const QString& hashFilePath);
+
+    /**
+     * @brief applies all intact records of the journal to index and settings;
+     *      replay stops at the first incomplete or corrupt record (e.g. torn write on crash)
+     * @param path path of the journal (it is no error if it does not exist)
+     * @param index the entries of the hash-file
+     * @param settings the settings of the hash-file
+     * @param run if not nullptr the state of an interrupted run will be stored here
+     * @param error if not nullptr an error-message will be stored on failure (null-string on success)
+     * @return the size of the intact part of the journal (0 if there is none) or -1 on failure
+     */
+    static qint64 replay(const QString& path, HashIndex& index, nlohmann::json& settings, UnfinishedRun* run, QString* error);
+
+    /**
+     * @brief deletes the journal at path (if it exists)
+     * @return false if it exists but could not be deleted
+     */
+    static bool remove(const QString& path);
+
+    Journal() = default;
+    Journal(const Journal&) = delete;
+    Journal& operator=(const Journal&) = delete;
+    ~Journal();
+
+    /**
+     * @brief opens the journal for appending; it is created if it does not exist
+     * @param path path of the journal
+     * @param validSize size returned by replay(); everything after it is discarded
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true on success
+     */
+    bool open(const QString& path, qint64 validSize, QString* error);
+
+    /**
+     * @brief syncs all pending records and closes the journal
+     */
+    void close();
+
+    bool isOpen() const;
+
+    /**
+     * @brief sets when pending records are synced by commitIfDue()
+     * @param maxRecords sync if at least this many records are pending
+     * @param maxDelay sync if the oldest pending record is at least this old
+     */
+    void setGroupCommit(int maxRecords, std::chrono::milliseconds maxDelay);
+
+    void put(std::string_view path, const FileEntry& entry);
+    void erase(std::string_view path);
+    void storeSettings(const nlohmann::json& settings);
+    /**
+     * @brief marks the begin of a run; all following puts until endRun() belong to it (see UnfinishedRun)
+     */
+    void beginRun();
+    void endRun();
+    /**
+     * @brief records the progress of hashing a file of the current run (it is dropped by a following put or erase)
+     */
+    void hashProgress(std::string_view path, const HashProgress& progress);
+    /**
+     * @brief records that the file was verified (only its lastVerified is changed)
+     */
+    void verified(std::string_view path, qint64 lastVerified);
+
+    /**
+     * @brief writes and syncs all pending records;
+     *      if a failed write leaves a partial record which can not be removed the journal is closed
+     *      (later commits fail and isOpen() returns false)
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true on success
+     */
+    bool commit(QString* error);
+
+    /**
+     * @brief like commit() but only if the group-commit limits are reached
+     */
+    bool commitIfDue(QString* error);
+
+    /**
+     * @brief returns the size of the journal (without pending records)
+     */
+    qint64 size() const;
+
+    /**
+     * @brief removes the first part of the journal (after it was folded into the hash-file);
+     *      the rest is written to a new file which atomically replaces the journal
+     * @param offset the size of the part to remove (a value previously returned by size())
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true on success
+     */
+    bool dropUpTo(qint64 offset, QString* error);
+
+private:
+    mutable std::mutex mtx;
+    QString path;
+    int fd = -1;
+    qint64 committedSize = 0;
+    /// why the journal was closed by a failed commit (null if it was not)
+    QString failure;
+
+    std::string pending;
+    int pendingRecords = 0;
+    std::chrono::steady_clock::time_point firstPending;
+
+    int maxPendingRecords = 1024;
+    std::chrono::milliseconds maxPendingDelay = std::chrono::milliseconds(1000);
+
+    void append(RecordType type, const std::string& payload);
+    bool commitLocked(QString* error);
+};
+
+}
+
+#endif // JOURNAL_H
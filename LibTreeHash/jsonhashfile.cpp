@@ -0,0 +1,1057 @@
+#include "jsonhashfile.h"
+#include "chunkedwriter.h"
+#include "libtreehash.h"
+#include <QFileDevice>
+#include <array>
+#include <charconv>
+#include <iterator>
+#include <optional>
+#include <vector>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+using namespace TreeHash;
+using namespace nlohmann;
+
+namespace{
+
+constexpr std::array<qint8, 256> HEX_VALUES = []{
+    std::array<qint8, 256> values{};
+    values.fill(-1);
+    for(int i = 0; i < 10; i++)
+        values['0' + i] = static_cast<qint8>(i);
+    for(int i = 0; i < 6; i++){
+        values['a' + i] = static_cast<qint8>(10 + i);
+        values['A' + i] = static_cast<qint8>(10 + i);
+    }
+    return values;
+}();
+
+/**
+ * @brief decodes a hex-string into out (reusing its buffer)
+ * @return false (and out is cleared) if hex is not a valid hex-string
+ */
+bool decodeHex(std::string_view hex, QByteArray& out){
+    if(hex.size() % 2 != 0){
+        out.clear();
+        return false;
+    }
+
+    out.resize(static_cast<qsizetype>(hex.size() / 2));
+    char* dst = out.data();
+    for(size_t i = 0; i < hex.size(); i += 2){
+        const int hi = HEX_VALUES[static_cast<unsigned char>(hex[i])];
+        const int lo = HEX_VALUES[static_cast<unsigned char>(hex[i + 1])];
+        if((hi | lo) < 0){
+            out.clear();
+            return false;
+        }
+        *dst++ = static_cast<char>(hi << 4 | lo);
+    }
+    return true;
+}
+
+/**
+ * @brief reads a device in big chunks and hands the data out char by char (for the JSON-parser)
+ */
+class DeviceInput{
+public:
+    static constexpr qint64 CHUNK_SIZE = 1024 * 1024;
+
+    /**
+     * @brief input-iterator over the remaining content of the device;
+     *      all copies share the position, a default-constructed iterator is the end
+     */
+    class Iterator{
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = char;
+        using difference_type = std::ptrdiff_t;
+        using pointer = const char*;
+        using reference = const char&;
+
+        Iterator() = default;
+        explicit Iterator(DeviceInput* input)
+            : input(input)
+        {}
+
+        const char& operator*() const{
+            return this->input->buffer[this->input->pos];
+        }
+
+        Iterator& operator++(){
+            this->input->advance();
+            return *this;
+        }
+
+        bool operator==(const Iterator& other) const{
+            return this->atEnd() == other.atEnd();
+        }
+
+        bool operator!=(const Iterator& other) const{
+            return !(*this == other);
+        }
+
+    private:
+        DeviceInput* input = nullptr;
+
+        bool atEnd() const{
+            return this->input == nullptr || this->input->atEnd();
+        }
+    };
+
+    explicit DeviceInput(QFileDevice& file)
+        : file(file), buffer(CHUNK_SIZE)
+    {
+        this->fill();
+    }
+
+    bool atEnd() const{
+        return this->pos == this->len;
+    }
+
+    /**
+     * @brief true if reading from the device failed
+     */
+    bool hasFailed() const{
+        return this->failed;
+    }
+
+    Iterator begin(){
+        return Iterator(this);
+    }
+
+    Iterator end(){
+        return Iterator();
+    }
+
+private:
+    QFileDevice& file;
+    std::vector<char> buffer;
+    qint64 pos = 0, len = 0;
+    bool failed = false;
+
+    void advance(){
+        if(++this->pos == this->len)
+            this->fill();
+    }
+
+    void fill(){
+        this->pos = 0;
+        this->len = this->file.read(this->buffer.data(), CHUNK_SIZE);
+        if(this->len < 0){
+            this->failed = true;
+            this->len = 0;
+        }
+    }
+};
+
+/**
+ * @brief builds a JSON-value from SAX-events (like a DOM-parser; a repeated key replaces the previous value)
+ */
+class ValueBuilder{
+public:
+    explicit ValueBuilder(json& root)
+        : root(root)
+    {}
+
+    bool null(){
+        this->add(json(nullptr));
+        return true;
+    }
+
+    bool boolean(bool val){
+        this->add(json(val));
+        return true;
+    }
+
+    bool number_integer(json::number_integer_t val){
+        this->add(json(val));
+        return true;
+    }
+
+    bool number_unsigned(json::number_unsigned_t val){
+        this->add(json(val));
+        return true;
+    }
+
+    bool number_float(json::number_float_t val, const json::string_t&){
+        this->add(json(val));
+        return true;
+    }
+
+    bool string(json::string_t& val){
+        this->add(json(std::move(val)));
+        return true;
+    }
+
+    bool binary(json::binary_t& val){
+        this->add(json::binary(std::move(val)));
+        return true;
+    }
+
+    bool start_object(std::size_t){
+        this->stack.push_back(this->add(json::object()));
+        return true;
+    }
+
+    bool end_object(){
+        this->stack.pop_back();
+        return true;
+    }
+
+    bool start_array(std::size_t){
+        this->stack.push_back(this->add(json::array()));
+        return true;
+    }
+
+    bool end_array(){
+        this->stack.pop_back();
+        return true;
+    }
+
+    bool key(json::string_t& val){
+        this->currentKey = std::move(val);
+        return true;
+    }
+
+private:
+    json& root;
+    /// the open objects and arrays (the elements of an array are only added while it is the innermost one,
+    ///     so the pointers stay valid)
+    std::vector<json*> stack;
+    std::string currentKey;
+
+    json* add(json&& val){
+        if(this->stack.empty()){
+            this->root = std::move(val);
+            return &this->root;
+        }
+
+        json& parent = *this->stack.back();
+        if(parent.is_array()){
+            parent.push_back(std::move(val));
+            return &parent.back();
+        }
+        json& element = parent[this->currentKey];
+        element = std::move(val);
+        return &element;
+    }
+};
+
+/**
+ * @brief SAX-handler which adds the entries of a hash-file directly to a HashTable::Builder;
+ *      only the settings are collected as JSON-value, unknown values are skipped
+ */
+class HashFileHandler{
+public:
+    HashTable::Builder entries;
+    json settings;
+    bool versionOk = false;
+    bool filesSeen = false;
+    QString error;
+
+    bool null(){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->null());
+        return this->scalar();
+    }
+
+    bool boolean(bool val){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->boolean(val));
+        return this->scalar();
+    }
+
+    bool number_integer(json::number_integer_t val){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->number_integer(val));
+        return this->number(static_cast<qint64>(val));
+    }
+
+    bool number_unsigned(json::number_unsigned_t val){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->number_unsigned(val));
+        return this->number(static_cast<qint64>(val));
+    }
+
+    bool number_float(json::number_float_t val, const json::string_t& str){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->number_float(val, str));
+        return this->number(static_cast<qint64>(val));
+    }
+
+    bool string(json::string_t& val){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->string(val));
+        if(this->skipDepth > 0)
+            return true;
+
+        switch(this->state){
+        case State::TOP:
+            if(this->currentKey == "version")
+                this->versionOk = val == LibTreeHash::FILE_VERSION;
+            return true;
+        case State::ENTRY:
+            if(this->currentKey == "hash")
+                decodeHex(val, this->hash);
+            else if(this->currentKey == "hashState")
+                decodeHex(val, this->hashState);
+            else if(this->currentKey == "tailFingerprint")
+                decodeHex(val, this->tailFingerprint);
+            else if(this->currentKey == "blockHashes")
+                decodeHex(val, this->blockHashes);
+            else if(this->currentKey == "chunks")
+                decodeHex(val, this->chunks);
+            return true;
+        default:
+            return this->scalar();
+        }
+    }
+
+    bool binary(json::binary_t& val){
+        if(this->state == State::SETTINGS)
+            return this->settingsValue(this->settingsParser->binary(val));
+        return this->scalar();
+    }
+
+    bool start_object(std::size_t elements){
+        if(this->state == State::SETTINGS){
+            this->settingsDepth++;
+            return this->settingsParser->start_object(elements);
+        }
+        if(this->skipDepth > 0){
+            this->skipDepth++;
+            return true;
+        }
+
+        switch(this->state){
+        case State::ROOT:
+            this->state = State::TOP;
+            return true;
+        case State::TOP:
+            if(this->currentKey == "files"){
+                // like in a DOM, a repeated key replaces the previous value
+                this->entries = HashTable::Builder();
+                if(elements != static_cast<std::size_t>(-1))
+                    this->entries.reserve(elements);
+                this->state = State::FILES;
+            }else{
+                this->skipDepth = 1;
+            }
+            return true;
+        case State::FILES:
+            this->hash.resize(0);// keeps the buffer
+            this->hashState.resize(0);
+            this->tailFingerprint.resize(0);
+            this->blockHashes.resize(0);
+            this->chunks.resize(0);
+            this->lastModified = -1;
+            this->lastVerified = -1;
+            this->mtimeNs = -1;
+            this->ctimeNs = -1;
+            this->inode = -1;
+            this->size = -1;
+            this->blockSize = 0;
+            this->chunkSize = 0;
+            this->state = State::ENTRY;
+            return true;
+        default:
+            this->skipDepth = 1;
+            return true;
+        }
+    }
+
+    bool end_object(){
+        if(this->state == State::SETTINGS){
+            this->settingsDepth--;
+            return this->settingsValue(this->settingsParser->end_object());
+        }
+        if(this->skipDepth > 0){
+            this->skipDepth--;
+            return true;
+        }
+
+        switch(this->state){
+        case State::ENTRY:
+            this->addEntry();
+            this->state = State::FILES;
+            break;
+        case State::FILES:
+            this->state = State::TOP;
+            break;
+        default:
+            break;
+        }
+        return true;
+    }
+
+    bool start_array(std::size_t elements){
+        if(this->state == State::SETTINGS){
+            this->settingsDepth++;
+            return this->settingsParser->start_array(elements);
+        }
+        if(this->skipDepth > 0){
+            this->skipDepth++;
+            return true;
+        }
+
+        if(this->state == State::ROOT)
+            return this->notAnObject();
+        if(this->state == State::TOP && this->currentKey == "files")
+            this->entries = HashTable::Builder();
+        if(this->state == State::FILES)
+            this->entries.add(this->path, QByteArrayView(), -1);
+        this->skipDepth = 1;
+        return true;
+    }
+
+    bool end_array(){
+        if(this->state == State::SETTINGS){
+            this->settingsDepth--;
+            return this->settingsValue(this->settingsParser->end_array());
+        }
+        this->skipDepth--;
+        return true;
+    }
+
+    bool key(json::string_t& val){
+        if(this->state == State::SETTINGS)
+            return this->settingsParser->key(val);
+        if(this->skipDepth > 0)
+            return true;
+
+        switch(this->state){
+        case State::TOP:
+            this->currentKey = val;
+            if(val == "files")
+                this->filesSeen = true;
+            if(val == "settings"){
+                this->settings = json();
+                this->settingsParser.emplace(this->settings);
+                this->state = State::SETTINGS;
+            }
+            return true;
+        case State::FILES:
+            this->path = val;
+            return true;
+        default:
+            this->currentKey = val;
+            return true;
+        }
+    }
+
+    template<class Exception>
+    bool parse_error(std::size_t, const std::string&, const Exception& ex){
+        this->error = QString::fromUtf8(ex.what());
+        return false;
+    }
+
+private:
+    enum class State{
+        ROOT,///< before the top-level value
+        TOP,///< in the top-level object
+        SETTINGS,///< in the value of "settings" (events are passed to settingsParser)
+        FILES,///< in the object of "files"
+        ENTRY///< in the object of one file
+    };
+
+    State state = State::ROOT;
+    int skipDepth = 0;
+    int settingsDepth = 0;
+    std::optional<ValueBuilder> settingsParser;
+
+    std::string currentKey;
+    std::string path;
+    QByteArray hash;
+    qint64 lastModified = -1;
+    qint64 lastVerified = -1;
+    qint64 mtimeNs = -1;
+    qint64 ctimeNs = -1;
+    qint64 inode = -1;
+    qint64 size = -1;
+    QByteArray hashState;
+    QByteArray tailFingerprint;
+    qint64 blockSize = 0;
+    QByteArray blockHashes;
+    qint64 chunkSize = 0;
+    QByteArray chunks;
+
+    void addEntry(){
+        EntryView entry;
+        entry.path = this->path;
+        entry.hash = this->hash;
+        entry.lastModified = this->lastModified;
+        entry.lastVerified = this->lastVerified;
+        entry.mtimeNs = this->mtimeNs;
+        entry.ctimeNs = this->ctimeNs;
+        entry.inode = this->inode;
+        entry.size = this->size;
+        entry.hashState = this->hashState;
+        entry.tailFingerprint = this->tailFingerprint;
+        entry.blockSize = this->blockSize;
+        entry.blockHashes = this->blockHashes;
+        entry.chunkSize = this->chunkSize;
+        entry.chunks = this->chunks;
+        this->entries.add(entry);
+    }
+
+    bool scalar(){
+        if(this->skipDepth > 0)
+            return true;
+
+        switch(this->state){
+        case State::ROOT:
+            return this->notAnObject();
+        case State::TOP:
+            if(this->currentKey == "version")
+                this->versionOk = false;
+            else if(this->currentKey == "files")
+                this->entries = HashTable::Builder();
+            return true;
+        case State::FILES:
+            this->entries.add(this->path, QByteArrayView(), -1);
+            return true;
+        default:
+            return true;
+        }
+    }
+
+    bool number(qint64 val){
+        if(this->skipDepth == 0 && this->state == State::ENTRY){
+            if(this->currentKey == "lastModified"){
+                this->lastModified = val;
+                return true;
+            }
+            if(this->currentKey == "lastVerified"){
+                this->lastVerified = val;
+                return true;
+            }
+            if(this->currentKey == "mtimeNs"){
+                this->mtimeNs = val;
+                return true;
+            }
+            if(this->currentKey == "ctimeNs"){
+                this->ctimeNs = val;
+                return true;
+            }
+            if(this->currentKey == "inode"){
+                this->inode = val;
+                return true;
+            }
+            if(this->currentKey == "size"){
+                this->size = val;
+                return true;
+            }
+            if(this->currentKey == "blockSize"){
+                this->blockSize = val;
+                return true;
+            }
+            if(this->currentKey == "chunkSize"){
+                this->chunkSize = val;
+                return true;
+            }
+        }
+        return this->scalar();
+    }
+
+    bool settingsValue(bool ok){
+        if(this->settingsDepth == 0)
+            this->state = State::TOP;
+        return ok;
+    }
+
+    bool notAnObject(){
+        this->error = QStringLiteral("unable to load hash-file: file is malformed (expected JSON-Object)");
+        return false;
+    }
+};
+
+/**
+ * @brief fast path for hash-files in the layout written by this library:
+ *      "files" is the first key and every entry has only "hash", (integer) "lastModified"
+ *      and optionally "hashState", (integer) "size", "tailFingerprint", "blockHashes", (integer) "blockSize",
+ *      "chunks", (integer) "chunkSize", (integer) "lastVerified", (integer) "mtimeNs", (integer) "ctimeNs" and (integer) "inode";
+ *      this is scanned directly instead of going through the generic tokenizer.
+ *      Anything else (escapes, other keys, floats, ...) is rejected and has to be handled by the generic parser.
+ */
+class LayoutScanner{
+public:
+    LayoutScanner(const char* data, size_t size)
+        : cur(data), end(data + size)
+    {}
+
+    /**
+     * @brief scans the beginning of the file up to the end of the files-object and adds the entries
+     * @return false if the data does not match the expected layout
+     */
+    bool scanFiles(HashTable::Builder& entries){
+        std::string_view str;
+        if(!this->consume('{') || !this->scanString(str) || str != "files" || !this->consume(':') || !this->consume('{'))
+            return false;
+        if(this->consume('}'))
+            return true;
+
+        std::string_view path, key;
+        QByteArray hash, hashState, tailFingerprint, blockHashes, chunks;
+        do{
+            if(!this->scanString(path) || !this->consume(':') || !this->consume('{'))
+                return false;
+
+            hash.resize(0);
+            hashState.resize(0);
+            tailFingerprint.resize(0);
+            blockHashes.resize(0);
+            chunks.resize(0);
+            EntryView entry;
+            entry.path = path;
+            if(!this->consume('}')){
+                do{
+                    if(!this->scanString(key) || !this->consume(':'))
+                        return false;
+
+                    if(key == "hash"){
+                        if(!this->scanHex(hash))
+                            return false;
+                    }else if(key == "lastModified"){
+                        if(!this->scanInteger(entry.lastModified))
+                            return false;
+                    }else if(key == "lastVerified"){
+                        if(!this->scanInteger(entry.lastVerified))
+                            return false;
+                    }else if(key == "mtimeNs"){
+                        if(!this->scanInteger(entry.mtimeNs))
+                            return false;
+                    }else if(key == "ctimeNs"){
+                        if(!this->scanInteger(entry.ctimeNs))
+                            return false;
+                    }else if(key == "inode"){
+                        if(!this->scanInteger(entry.inode))
+                            return false;
+                    }else if(key == "hashState"){
+                        if(!this->scanHex(hashState))
+                            return false;
+                    }else if(key == "size"){
+                        if(!this->scanInteger(entry.size))
+                            return false;
+                    }else if(key == "tailFingerprint"){
+                        if(!this->scanHex(tailFingerprint))
+                            return false;
+                    }else if(key == "blockHashes"){
+                        if(!this->scanHex(blockHashes))
+                            return false;
+                    }else if(key == "blockSize"){
+                        if(!this->scanInteger(entry.blockSize))
+                            return false;
+                    }else if(key == "chunks"){
+                        if(!this->scanHex(chunks))
+                            return false;
+                    }else if(key == "chunkSize"){
+                        if(!this->scanInteger(entry.chunkSize))
+                            return false;
+                    }else{
+                        return false;
+                    }
+                }while(this->consume(','));
+
+                if(!this->consume('}'))
+                    return false;
+            }
+
+            entry.hash = hash;
+            entry.hashState = hashState;
+            entry.tailFingerprint = tailFingerprint;
+            entry.blockHashes = blockHashes;
+            entry.chunks = chunks;
+            entries.add(entry);
+        }while(this->consume(','));
+
+        return this->consume('}');
+    }
+
+    /**
+     * @brief scans the ',' which separates the files-object from the next key
+     * @return the data starting at the next key or nullptr if there is none
+     */
+    const char* nextKey(){
+        if(!this->consume(','))
+            return nullptr;
+        this->skipWhitespace();
+        return this->cur < this->end && *this->cur == '"' ? this->cur : nullptr;
+    }
+
+    const char* dataEnd() const{
+        return this->end;
+    }
+
+private:
+    const char* cur;
+    const char* const end;
+
+    void skipWhitespace(){
+        while(this->cur < this->end && (*this->cur == ' ' || *this->cur == '\n' || *this->cur == '\r' || *this->cur == '\t'))
+            this->cur++;
+    }
+
+    bool consume(char c){
+        this->skipWhitespace();
+        if(this->cur < this->end && *this->cur == c){
+            this->cur++;
+            return true;
+        }
+        return false;
+    }
+
+    /**
+     * @brief scans a string without escapes
+     */
+    bool scanString(std::string_view& out){
+        if(!this->consume('"'))
+            return false;
+
+        const char* start = this->cur;
+        bool ascii = true;
+        for(; this->cur < this->end; this->cur++){
+            const unsigned char c = static_cast<unsigned char>(*this->cur);
+            if(c == '"'){
+                out = std::string_view(start, this->cur - start);
+                this->cur++;
+                return ascii || isValidUtf8(out);
+            }
+            if(c == '\\' || c < 0x20)
+                return false;
+            if(c >= 0x80)
+                ascii = false;
+        }
+        return false;
+    }
+
+    /**
+     * @brief scans a string and decodes it as hex (an invalid hex-string results in an empty array)
+     */
+    bool scanHex(QByteArray& out){
+        std::string_view hex;
+        if(!this->scanString(hex))
+            return false;
+        decodeHex(hex, out);
+        return true;
+    }
+
+    /**
+     * @brief scans an integer which fits into qint64 (no fraction or exponent)
+     */
+    bool scanInteger(qint64& out){
+        this->skipWhitespace();
+        const char* start = this->cur;
+        if(this->cur < this->end && *this->cur == '-')
+            this->cur++;
+
+        const char* digits = this->cur;
+        while(this->cur < this->end && *this->cur >= '0' && *this->cur <= '9')
+            this->cur++;
+
+        if(this->cur == digits || (this->cur - digits > 1 && *digits == '0'))
+            return false;
+        if(this->cur < this->end && (*this->cur == '.' || *this->cur == 'e' || *this->cur == 'E'))
+            return false;
+
+        // fails on overflow (e.g. timestamps in ns have 19 digits, so no fixed digit-limit can be used)
+        const auto res = std::from_chars(start, this->cur, out);
+        return res.ec == std::errc() && res.ptr == this->cur;
+    }
+
+    /**
+     * @brief checks UTF-8 as strict as the generic parser (no overlong forms, no surrogates, max. U+10FFFF)
+     */
+    static bool isValidUtf8(std::string_view str){
+        const unsigned char* s = reinterpret_cast<const unsigned char*>(str.data());
+        const unsigned char* e = s + str.size();
+        while(s < e){
+            const unsigned char c = *s++;
+            if(c < 0x80)
+                continue;
+
+            int following;
+            unsigned char min = 0x80, max = 0xBF;
+            if(c >= 0xC2 && c <= 0xDF){
+                following = 1;
+            }else if(c >= 0xE0 && c <= 0xEF){
+                following = 2;
+                if(c == 0xE0)
+                    min = 0xA0;
+                else if(c == 0xED)
+                    max = 0x9F;
+            }else if(c >= 0xF0 && c <= 0xF4){
+                following = 3;
+                if(c == 0xF0)
+                    min = 0x90;
+                else if(c == 0xF4)
+                    max = 0x8F;
+            }else{
+                return false;
+            }
+
+            if(e - s < following || *s < min || *s > max)
+                return false;
+            s++;
+            for(int i = 1; i < following; i++, s++){
+                if(*s < 0x80 || *s > 0xBF)
+                    return false;
+            }
+        }
+        return true;
+    }
+};
+
+/**
+ * @brief writes str as JSON-string (escaped like json::dump())
+ */
+void writeString(ChunkedWriter& out, std::string_view str){
+    bool plain = true;
+    for(const char c : str){
+        const unsigned char uc = static_cast<unsigned char>(c);
+        if(uc < 0x20 || uc >= 0x80 || c == '"' || c == '\\'){
+            plain = false;
+            break;
+        }
+    }
+
+    if(plain){
+        out.write("\"");
+        out.write(str);
+        out.write("\"");
+    }else{
+        out.write(json(std::string(str)).dump());
+    }
+}
+
+void writeHexString(ChunkedWriter& out, QByteArrayView data){
+    static constexpr char DIGITS[] = "0123456789abcdef";
+
+    char buffer[256];
+    qsizetype len = 0;
+    buffer[len++] = '"';
+    for(const char c : data){
+        if(len + 3 > static_cast<qsizetype>(sizeof(buffer))){
+            out.write(buffer, len);
+            len = 0;
+        }
+        const unsigned char uc = static_cast<unsigned char>(c);
+        buffer[len++] = DIGITS[uc >> 4];
+        buffer[len++] = DIGITS[uc & 0xF];
+    }
+    if(len + 1 > static_cast<qsizetype>(sizeof(buffer))){
+        out.write(buffer, len);
+        len = 0;
+    }
+    buffer[len++] = '"';
+    out.write(buffer, len);
+}
+
+void writeInteger(ChunkedWriter& out, qint64 val){
+    char buffer[24];
+    const auto res = std::to_chars(buffer, buffer + sizeof(buffer), val);
+    out.write(buffer, res.ptr - buffer);
+}
+
+/**
+ * @brief checks the result of the parser and passes the loaded data to the caller
+ */
+std::shared_ptr<const HashTable> finishLoad(bool parsed, HashFileHandler& handler, json& settings, QString* error){
+    if(!parsed){
+        if(error != nullptr)
+            *error = handler.error;
+        return nullptr;
+    }
+
+    if(!handler.versionOk){
+        if(error != nullptr)
+            *error = QStringLiteral("can not load version of hashfile");
+        return nullptr;
+    }
+
+    settings = std::move(handler.settings);
+    if(error != nullptr)
+        *error = QString();
+    return handler.entries.build();
+}
+
+/**
+ * @brief parses a hash-file which is completely in memory
+ */
+std::shared_ptr<const HashTable> loadMapped(const char* data, size_t size, json& settings, QString* error, bool* fastPath){
+    HashTable::Builder entries;
+    LayoutScanner scanner(data, size);
+    if(scanner.scanFiles(entries)){
+        // the remaining keys (settings, version) are small -> parse them as own object with the generic parser
+        if(const char* next = scanner.nextKey(); next != nullptr){
+            std::string rest("{");
+            rest.append(next, scanner.dataEnd());
+
+            HashFileHandler handler;
+            if(json::sax_parse(rest.cbegin(), rest.cend(), &handler) && !handler.filesSeen){
+                handler.entries = std::move(entries);
+                if(fastPath != nullptr)
+                    *fastPath = true;
+                return finishLoad(true, handler, settings, error);
+            }
+        }
+    }
+
+    // unexpected layout or malformed -> the generic parser handles it (and reports the right errors)
+    HashFileHandler handler;
+    const bool parsed = json::sax_parse(data, data + size, &handler);
+    return finishLoad(parsed, handler, settings, error);
+}
+
+}
+
+std::shared_ptr<const HashTable> JsonHashFile::load(QFileDevice& file, json& settings, QString* error, bool* fastPath){
+    if(fastPath != nullptr)
+        *fastPath = false;
+
+    // map regular files, so that the parser can run over one contiguous buffer without copying the data
+    struct stat fileInfo;
+    const int fd = file.handle();
+    if(fd != -1 && file.pos() == 0 && fstat(fd, &fileInfo) == 0 && S_ISREG(fileInfo.st_mode) && fileInfo.st_size > 0){
+        const size_t size = static_cast<size_t>(fileInfo.st_size);
+        void* mapping = mmap(nullptr, size, PROT_READ, MAP_PRIVATE, fd, 0);
+        if(mapping != MAP_FAILED){
+            madvise(mapping, size, MADV_SEQUENTIAL);
+
+            const char* data = static_cast<const char*>(mapping);
+            std::shared_ptr<const HashTable> entries = loadMapped(data, size, settings, error, fastPath);
+            munmap(mapping, size);
+            return entries;
+        }
+    }
+
+    // not mappable (e.g. stdin) -> stream it
+    DeviceInput input(file);
+    if(input.atEnd()){
+        if(input.hasFailed()){
+            if(error != nullptr)
+                *error = QStringLiteral("unable to load hash-file: %1").arg(file.errorString());
+            return nullptr;
+        }
+
+        settings = json();
+        if(error != nullptr)
+            *error = QString();
+        return std::make_shared<HashTable>();
+    }
+
+    HashFileHandler handler;
+    const bool parsed = json::sax_parse(input.begin(), input.end(), &handler);
+    if(input.hasFailed()){
+        // a read-error looks like a truncated file to the parser
+        if(error != nullptr)
+            *error = QStringLiteral("unable to load hash-file: %1").arg(file.errorString());
+        return nullptr;
+    }
+    return finishLoad(parsed, handler, settings, error);
+}
+
+QByteArray JsonHashFile::decodeHexDigest(std::string_view hex){
+    QByteArray decoded;
+    decodeHex(hex, decoded);
+    return decoded;
+}
+
+bool JsonHashFile::save(QFileDevice& file, const HashIndex& index, const json& settings, bool compact, QString* error){
+    // written in the same layout as json::dump(2) / json::dump() (keys are sorted: files, settings, version)
+    try{
+        ChunkedWriter out(file);
+
+        out.write(compact ? "{\"files\":" : "{\n  \"files\": ");
+        if(index.size() == 0){
+            out.write("{}");
+        }else{
+            out.write(compact ? "{" : "{\n");
+
+            bool first = true;
+            index.forEach([&out, &first, compact](const EntryView& entry) -> void{
+                if(!first)
+                    out.write(compact ? "," : ",\n");
+                first = false;
+
+                if(!compact)
+                    out.write("    ");
+                writeString(out, entry.path);
+                out.write(compact ? ":{" : ": {\n      ");
+                if(!entry.blockHashes.isEmpty()){
+                    out.write(compact ? "\"blockHashes\":" : "\"blockHashes\": ");
+                    writeHexString(out, entry.blockHashes);
+                    out.write(compact ? ",\"blockSize\":" : ",\n      \"blockSize\": ");
+                    writeInteger(out, entry.blockSize);
+                    out.write(compact ? "," : ",\n      ");
+                }
+                if(!entry.chunks.isEmpty()){
+                    out.write(compact ? "\"chunkSize\":" : "\"chunkSize\": ");
+                    writeInteger(out, entry.chunkSize);
+                    out.write(compact ? ",\"chunks\":" : ",\n      \"chunks\": ");
+                    writeHexString(out, entry.chunks);
+                    out.write(compact ? "," : ",\n      ");
+                }
+                if(entry.ctimeNs != -1){
+                    out.write(compact ? "\"ctimeNs\":" : "\"ctimeNs\": ");
+                    writeInteger(out, entry.ctimeNs);
+                    out.write(compact ? "," : ",\n      ");
+                }
+                out.write(compact ? "\"hash\":" : "\"hash\": ");
+                writeHexString(out, entry.hash);
+                if(!entry.hashState.isEmpty()){
+                    out.write(compact ? ",\"hashState\":" : ",\n      \"hashState\": ");
+                    writeHexString(out, entry.hashState);
+                }
+                if(entry.inode != -1){
+                    out.write(compact ? ",\"inode\":" : ",\n      \"inode\": ");
+                    writeInteger(out, entry.inode);
+                }
+                if(entry.lastModified != -1){
+                    out.write(compact ? ",\"lastModified\":" : ",\n      \"lastModified\": ");
+                    writeInteger(out, entry.lastModified);
+                }
+                if(entry.lastVerified != -1){
+                    out.write(compact ? ",\"lastVerified\":" : ",\n      \"lastVerified\": ");
+                    writeInteger(out, entry.lastVerified);
+                }
+                if(entry.mtimeNs != -1){
+                    out.write(compact ? ",\"mtimeNs\":" : ",\n      \"mtimeNs\": ");
+                    writeInteger(out, entry.mtimeNs);
+                }
+                if(entry.size != -1){
+                    out.write(compact ? ",\"size\":" : ",\n      \"size\": ");
+                    writeInteger(out, entry.size);
+                }
+                if(!entry.tailFingerprint.isEmpty()){
+                    out.write(compact ? ",\"tailFingerprint\":" : ",\n      \"tailFingerprint\": ");
+                    writeHexString(out, entry.tailFingerprint);
+                }
+                out.write(compact ? "}" : "\n    }");
+            });
+
+            out.write(compact ? "}" : "\n  }");
+        }
+
+        out.write(compact ? ",\"settings\":" : ",\n  \"settings\": ");
+        std::string settingsStr = settings.dump(compact ? -1 : 2);
+        if(!compact){
+            // nested one level deeper (strings can not contain raw line-breaks)
+            for(size_t pos = settingsStr.find('\n'); pos != std::string::npos; pos = settingsStr.find('\n', pos + 3))
+                settingsStr.insert(pos + 1, "  ");
+        }
+        out.write(settingsStr);
+
+        out.write(compact ? ",\"version\":" : ",\n  \"version\": ");
+        writeString(out, LibTreeHash::FILE_VERSION);
+        out.write(compact ? "}" : "\n}");
+
+        return out.finish(error);
+    }catch(std::exception& e){
+        // e.g. a path which is not valid UTF-8
+        if(error != nullptr)
+            *error = QString::fromUtf8(e.what());
+        return false;
+    }
+}
@@ -0,0 +1,53 @@
+#ifndef JSONHASHFILE_H
+#define JSONHASHFILE_H
+
+#include <QString>
+#include <memory>
+#include "hashindex.h"
+#include "ext/nlohmann/json.hpp"
+
+class QFileDevice;
+
+namespace TreeHash{
+
+/**
+ * @brief reads and writes the JSON hash-file format (version 2.0; see FileFormat.txt)
+ */
+class JsonHashFile{
+public:
+
+    /**
+     * @brief loads the entries of a JSON hash-file;
+     *      the file is parsed (SAX) directly into the table, so no DOM of the whole file is built;
+     *      regular files are memory-mapped and files in the layout written by this library are scanned by a fast path
+     * @param file the hash-file (must be open for reading)
+     * @param settings will be set to the stored settings (null if the file has none)
+     * @param error if not nullptr an error-message will be stored on failure (null-string on success)
+     * @param fastPath if not nullptr it will be set to true if the entries were read by the fast path
+     * @return the entries (empty for empty files) or nullptr on failure
+     */
+    static std::shared_ptr<const HashTable> load(QFileDevice& file, nlohmann::json& settings, QString* error,
+                                                 bool* fastPath = nullptr);
+
+    /**
+     * @brief writes the index as JSON hash-file; the entries are streamed to the device in chunks
+     *      (the output is identical to json::dump() of the whole document)
+     * @param file the destination (must be open for writing)
+     * @param index the entries to write
+     * @param settings the settings to store
+     * @param compact if true no whitespace is written, otherwise the document is indented by 2
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true on success
+     */
+    static bool save(QFileDevice& file, const HashIndex& index, const nlohmann::json& settings, bool compact, QString* error);
+
+    /**
+     * @brief decodes a hex-string
+     * @return the decoded bytes or an empty array if hex is not a valid hex-string
+     */
+    static QByteArray decodeHexDigest(std::string_view hex);
+};
+
+}
+
+#endif // JSONHASHFILE_H
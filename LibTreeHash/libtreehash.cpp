@@ -1,14 +1,43 @@
 #include "libtreehash.h"
 #include <QFileDevice>
 #include <QFileInfo>
+#include <QDateTime>
 #include <QDir>
 #include <QDirIterator>
 #include <QStringList>
 #include <QSet>
-#include <QMessageAuthenticationCode>
+#include <QSaveFile>
+#include <QScopeGuard>
+#include <QThread>
+#include <QRandomGenerator>
 #include <unistd.h>
+#include <fcntl.h>
+#include <sys/stat.h>
+#include <sys/statvfs.h>
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <condition_variable>
+#include <cmath>
+#include <map>
+#include <mutex>
+#include <numeric>
+#include <random>
+#include <thread>
+#include <unordered_set>
+#include <cerrno>
+#include <cstring>
+#include <deque>
+#include <exception>
 #include <qmetaobject.h>
 #include "ext/nlohmann/json.hpp"
+#include "hashindex.h"
+#include "binaryhashfile.h"
+#include "jsonhashfile.h"
+#include "journal.h"
+#include "hasher.h"
+#include "progresstracker.h"
+#include "tracer.h"
 
 using namespace TreeHash;
 using namespace nlohmann;
@@ -18,36 +47,405 @@ std::string LibTreeHash::FILE_VERSION = "2.0";
 
 const EventListener EventListener::VOID_EVENT_LISTENER = EventListener();
 
+/**
+ * @brief bounded queue between a run (producer) and a ResultStream (consumer)
+ */
+class ResultQueue{
+public:
+    explicit ResultQueue(size_t capacity) : capacity(std::max<size_t>(capacity, 1)) {}
+
+    /**
+     * @brief waits while the queue is full
+     * @return false if the consumer is gone
+     */
+    bool push(FileResult result){
+        std::unique_lock lock(this->mtx);
+        this->changed.wait(lock, [this]() -> bool{
+            return this->results.size() < this->capacity || this->closed;
+        });
+        if(this->closed)
+            return false;
+        this->results.push_back(std::move(result));
+        this->changed.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief waits until a result is available; rethrows the error of the run after the last result
+     * @return false if the run finished and all results were taken
+     */
+    bool pop(FileResult& result){
+        std::unique_lock lock(this->mtx);
+        this->changed.wait(lock, [this]() -> bool{
+            return !this->results.empty() || this->finished;
+        });
+        if(this->results.empty()){
+            if(this->error){
+                const std::exception_ptr err = this->error;
+                this->error = nullptr;
+                std::rethrow_exception(err);
+            }
+            return false;
+        }
+        result = std::move(this->results.front());
+        this->results.pop_front();
+        this->changed.notify_all();
+        return true;
+    }
+
+    /**
+     * @brief called by the producer after the run
+     */
+    void finish(std::exception_ptr error){
+        std::lock_guard lock(this->mtx);
+        this->finished = true;
+        this->error = error;
+        this->changed.notify_all();
+    }
+
+    /**
+     * @brief called by the consumer if it takes no more results
+     */
+    void close(){
+        std::lock_guard lock(this->mtx);
+        this->closed = true;
+        this->results.clear();
+        this->changed.notify_all();
+    }
+
+private:
+    const size_t capacity;
+    std::mutex mtx;
+    std::condition_variable changed;
+    std::deque<FileResult> results;
+    bool finished = false, closed = false;
+    std::exception_ptr error;
+};
+
+/**
+ * @brief adds the time until stop() (or its destruction) to a stage and records it as span in the trace;
+ *      does nothing for a null stage or tracer
+ */
+class StageTimer{
+public:
+    StageTimer(StageStats* stage, Tracer* tracer = nullptr, const char* span = nullptr, size_t lane = 0)
+        : stage(stage), tracer(tracer), span(span), lane(lane) {
+        if(stage != nullptr || tracer != nullptr)
+            this->start = std::chrono::steady_clock::now();
+    }
+    ~StageTimer(){
+        this->stop();
+    }
+
+    void stop(qint64 calls = 1){
+        if(this->stage == nullptr && this->tracer == nullptr)
+            return;
+
+        const auto end = std::chrono::steady_clock::now();
+        if(this->stage != nullptr){
+            this->stage->nanoseconds += std::chrono::duration_cast<std::chrono::nanoseconds>(end - this->start).count();
+            this->stage->calls += calls;
+        }
+        if(this->tracer != nullptr)
+            this->tracer->record(this->lane, this->span, this->start, end);
+        this->stage = nullptr;
+        this->tracer = nullptr;
+    }
+
+private:
+    StageStats* stage;
+    Tracer* tracer;
+    const char* span;
+    size_t lane;
+    std::chrono::steady_clock::time_point start;
+};
+
 class LibTreeHashPrivate{
 public:
 
     EventListener eventListener;
     std::unique_ptr<QFileDevice> hashFileSrc, hashFileDst;
+    /// set if the hash-file was given by path (it then can be replaced atomically)
+    QString hashFilePath;
     bool truncateHashFileDst = true;
     QStringList files;
     QString rootDir;
     QString hmacKey;
     QCryptographicHash::Algorithm hashAlgorithm = QCryptographicHash::Algorithm::Keccak_512;
 
-    json hashFileData;
+    json settings = json::object();
+    HashIndex index;
+    HashFileFormat hashFileFormat = HashFileFormat::JSON;
+    bool compactHashFile = false;
+
+    /// if set (and hashFilePath is set) changes are appended to the journal instead of rewriting the hash-file
+    bool journalEnabled = false;
+    Journal journal;
+    /// size of the intact part of the journal found on load (-1 if it could not be read)
+    qint64 journalValidSize = 0;
+    /// the settings as they are stored in hash-file + journal
+    json persistedSettings;
+    std::thread compactionThread;
+    std::atomic<bool> compactionRunning = false;
+    std::mutex compactionMtx;
+    QString compactionError;
+    /// set by the compaction when it renamed its snapshot over the hash-file
+    bool compactionCommitted = false;
+
+    qint64 checkpointSeconds = 0;
+    qint64 checkpointBytes = 0;
+    std::chrono::steady_clock::time_point lastCheckpoint;
+    qint64 bytesSinceCheckpoint = 0;
+
+    bool resume = false;
+    /// the run recorded in the journal which did not finish yet (the current one or an interrupted one)
+    Journal::UnfinishedRun unfinishedRun;
+    std::atomic<bool> stopRequested = false;
+    bool interrupted = false;
+    std::atomic<bool> paused = false;
+    std::mutex pauseMutex;
+    std::condition_variable pauseChanged;
+    /// stop at the first failure
+    bool failFast = false;
+    /// set by the first failure if failFast is enabled (also cancels the block-verify threads)
+    std::atomic<bool> failedFast = false;
+
+    /// receives the results while a ResultStream is active
+    std::shared_ptr<ResultQueue> resultQueue;
+    /// data of the file which is currently processed (for its FileResult)
+    std::chrono::steady_clock::time_point fileStart;
+    QByteArray fileDigest;
+
+    ProgressTracker progress;
+    std::chrono::milliseconds progressInterval{1000};
+
+    /// measure the time of the stages of a run
+    bool collectStats = false;
+    RunStats stats;
+    /// the last load of the hash-file (copied into the stats of every run)
+    StageStats loadStats;
+    /// records the spans of the run if a trace-file is set
+    std::unique_ptr<Tracer> tracer;
+    QString traceFile;
+
+    /// count of the slowest files which are kept (0 = disabled)
+    size_t slowFileCount = 0;
+    double stragglerRatio = 0.1;
+    std::vector<FileTiming> slowestFiles, stragglers;
+    /// the time a file of the current run took
+    struct FileSample{
+        /// index in the plan
+        size_t index;
+        QString device;
+        qint64 bytes;
+        std::chrono::microseconds duration;
+    };
+    /// batch size of the EventSink during a run
+    size_t eventBatchSize = 256;
+
+    /// entries of files with at least this size keep their hash-state (-1 = never)
+    qint64 hashStateMinSize = -1;
+    /// size of the blocks for the block-hashes (0 = disabled)
+    qint64 blockSize = 0;
+    /// count of threads which verify the blocks of a file
+    int threadCount = 1;
+    /// average size of the content-defined chunks (0 = disabled)
+    qint64 chunkSize = 0;
+    /// fraction of the blocks which VERIFY checks
+    double sampleRate = 1.0;
+    quint64 sampleSeed = QRandomGenerator::global()->generate64();
+    SampleCoverage sampleCoverage;
+    /// store lastVerified of intact files in VERIFY
+    bool recordVerified = false;
+    /// hash the suspect files in VERIFY_QUICK
+    bool escalateSuspects = false;
+    /// limits of VERIFY (0 = unlimited)
+    qint64 verifyBudgetSeconds = 0;
+    qint64 verifyBudgetBytes = 0;
+    bool budgetExhausted = false;
 
     bool rootSet = false;
     bool hashAlgoSet = false;
+    bool hashFileFormatSet = false;
+
+    ~LibTreeHashPrivate();
 
     bool saveHashFile();
+    bool writeHashFile(QFileDevice& file, QString* error);
+    static bool writeHashFile(QFileDevice& file, const HashIndex& index, const json& settings,
+                              HashFileFormat format, bool compact, QString* error);
+
+    /**
+     * @brief changes the index and records the change in the journal (if enabled)
+     */
+    void putEntry(std::string_view path, FileEntry entry);
+    bool eraseEntry(std::string_view path);
+    /**
+     * @brief sets lastVerified of the entry to now (if recordVerified is enabled)
+     */
+    void markVerified(const std::string& path);
+    /**
+     * @brief returns the files ordered by the lastVerified of their entries (oldest first)
+     */
+    QStringList filesByLastVerified() const;
+    /**
+     * @brief removes all entries whose path is not in listed (used by SYNC)
+     */
+    void eraseUnlistedEntries(const std::unordered_set<std::string>& listed);
+
+    void openJournal();
+    bool saveToJournal();
+    void removeJournal();
+    /**
+     * @brief writes a snapshot of the index as new hash-file in the background and drops the contained part of the journal
+     */
+    void startCompaction();
+    /**
+     * @brief waits for a running compaction and reports its errors
+     */
+    void finishCompaction();
+
+    /**
+     * @brief saves the progress of the running update if the checkpoint-interval elapsed
+     */
+    void checkpointIfDue();
+    bool isCheckpointDue() const;
+    /**
+     * @brief blocks while the run is paused (returns early if a stop was requested)
+     */
+    void waitWhilePaused();
+    /**
+     * @brief calls EventListener::onProgress if the progress-interval elapsed
+     * @param force call it even if the interval did not elapse
+     */
+    void reportProgress(bool force = false);
+    /**
+     * @brief returns the stage for a StageTimer (null if the stats are not collected)
+     */
+    StageStats* stage(StageStats& stage){
+        return this->collectStats ? &stage : nullptr;
+    }
+    void checkpoint();
+    /**
+     * @brief returns true if the file was already processed by the resumed run and was not modified since
+     */
+    bool isCompletedByRun(const QString& file, const std::string& relPath) const;
+
+    /**
+     * @brief what processFiles() does with a file (decided only by its metadata and its entry)
+     */
+    enum class PlannedAction{
+        /// read the file (update or verify it)
+        HASH,
+        /// the entry is up to date (or the file was processed by the resumed run)
+        SKIP,
+        /// VERIFY, VERIFY_QUICK: the size differs from the stored one -> fails without being read
+        SIZE_MISMATCH,
+        /// VERIFY_QUICK: the metadata matches the stored one
+        MATCH,
+        /// VERIFY_QUICK: the metadata differs from the stored one (see PlannedFile::reason)
+        SUSPECT,
+        /// VERIFY, VERIFY_QUICK, UPDATE_MODIFIED: the file has no entry
+        NO_ENTRY,
+        MALFORMED_ENTRY,
+        NOT_A_FILE
+    };
+    struct PlannedFile{
+        QString path;
+        QString relPath;
+        qint64 size = 0;
+        PlannedAction action = PlannedAction::NOT_A_FILE;
+        /// SUSPECT: which metadata differs
+        QString reason;
+        /// SIZE_MISMATCH: the size stored in the entry
+        qint64 storedSize = -1;
+    };
+    /**
+     * @brief classifies the files without reading them; the files which are not read come first
+     */
+    std::vector<PlannedFile> planFiles(RunMode runMode, const QStringList& files, bool resumeRun) const;
+    /**
+     * @brief finds the slowest files and the stragglers among the samples and warns about the stragglers
+     */
+    void reportSlowFiles(const std::vector<PlannedFile>& plan, const std::vector<FileSample>& samples);
 
     void verifyEntry(const QString& file, const QString& relPath);
-    void updateEntry(const QString& file, const QString& relPath);
+    /**
+     * @param previous if not nullptr and the file only grew since previous was hashed, only the appended data is hashed
+     */
+    void updateEntry(const QString& file, const QString& relPath, const FileEntry* previous = nullptr);
 
+    void useHashesFile(std::unique_ptr<QFileDevice>&& src, std::unique_ptr<QFileDevice>&& dst, bool truncateDest, const QString& path);
     void openHashFile();
 
     void loadSettings(QString* err);
     void storeSettings();
 
-    void processFiles(RunMode runMode);
-    QString computeFileHash(QString path);
+    void processFiles(RunMode runMode, bool resumeRun);
+    /**
+     * @brief hashes the file; if the run is recorded in the journal the progress of big files is saved at checkpoints
+     *      and an interrupted file is continued from its last progress
+     * @param path the file to hash
+     * @param relPath the path of the entry
+     * @param update true if called from an update (checkpoints are only made then)
+     * @param previous if not nullptr and the file only grew since previous was hashed
+     *      (checked by its size and tail-fingerprint), hashing continues from its hash-state
+     * @param stored if not nullptr the data which is stored besides the hash is set in it
+     *      (size, hash-state and tail-fingerprint if the file has at least hashStateMinSize bytes;
+     *      the block-hashes and the chunks if they are enabled and the file has more than one block / chunk)
+     * @return the hash or a null-array on error or if the run was stopped while hashing
+     */
+    QByteArray computeFileHash(const QString& path, const std::string& relPath, bool update,
+                               const FileEntry* previous = nullptr, FileEntry* stored = nullptr);
+    void saveHashProgress(const std::string& relPath, Journal::HashProgress progress);
+    /**
+     * @brief returns true if the file is bigger than when previous was hashed and the hashed part is unchanged
+     *      (according to the tail-fingerprint)
+     */
+    static bool onlyGrew(QFile& file, qint64 size, const FileEntry& previous);
+    /**
+     * @brief stores the modification-time, the status-change-time and the inode of the file in entry
+     */
+    static bool readStatData(const QString& path, FileEntry& entry);
+    /**
+     * @brief computes a digest of the last bytes (64 KiB) before end
+     * @return the digest or a null-array if the data could not be read
+     */
+    static QByteArray tailFingerprint(QFile& file, qint64 end);
+    /**
+     * @brief returns true if the entry has a complete list of block-hashes (for the current algorithm)
+     */
+    bool hasBlockHashes(const EntryView& entry) const;
+    /**
+     * @brief returns true if the block-hashes of previous can be continued when data is appended to the file
+     */
+    bool canContinueBlockHashes(const FileEntry& previous) const;
+    /**
+     * @brief returns the blocks of the entry which VERIFY checks (all or a sample; ascending)
+     */
+    std::vector<qint64> selectBlocks(const EntryView& entry) const;
+    /**
+     * @brief verifies the given blocks of the file (in parallel) and reports the corrupt ranges
+     */
+    void verifyBlocks(const QString& path, const EntryView& entry, const std::vector<qint64>& blocks);
+
+    /**
+     * @brief loads settings and entries from the hash-file (the format is detected automatically)
+     * @param hashFile the file to load
+     * @param error if not nullptr an error-message will be stored on failure (null-string on success)
+     */
+    void loadHashes(QFileDevice& hashFile, QString* error);
+    void loadJsonHashes(QFileDevice& hashFile, QString* error);
+    void loadBinaryHashes(QFileDevice& hashFile, QString* error);
 
-    static json loadHashes(QFileDevice& hashFile, QString* error);
+    /**
+     * @brief stats all given paths (relative to root) in parallel batches
+     * @param root the dir the paths are relative to
+     * @param relPaths the paths to check
+     * @param error if not nullptr an error-message will be stored if root could not be opened
+     * @return for every path: 0 if it is an existing file, ENOENT if it does not exist (or is no file), other errno-values on errors
+     */
+    static std::vector<int> probeFiles(const QString& root, const std::vector<std::string>& relPaths, QString* error);
 
     /**
      * @brief if file is open checks if it is readable / writeable;
@@ -58,14 +456,48 @@ public:
      * @return true if file is open and readable / writeable, false otherwise
      */
     static bool ensureFileOpen(QFileDevice& file, bool write, QString* error);
+    /**
+     * @brief reopens hashFileSrc (and hashFileDst if it was open) on hashFilePath
+     *          (needed after a new hash-file was renamed over the one the devices have open;
+     *          otherwise a later in-place rewrite would write into the unlinked file)
+     * @param error if not nullptr an error-message will be stored on failure
+     * @return true if the devices were reopened
+     */
+    bool reopenHashFile(QString* error);
 };
 }
 
+LibTreeHashPrivate::~LibTreeHashPrivate(){
+    this->finishCompaction();
+    this->journal.close();
+}
+
 LibTreeHash::LibTreeHash(const EventListener& listener, bool autosave)
     : autosave(autosave)
 {
     this->priv = new LibTreeHashPrivate();
     this->priv->eventListener = listener;
+
+    LibTreeHashPrivate* priv = this->priv;
+    this->priv->eventListener.onFailure = [priv]() -> void{
+        if(priv->failFast){
+            priv->failedFast = true;
+            priv->stopRequested = true;
+        }
+    };
+    this->priv->eventListener.onProcessed = [priv](const QString& path, bool success) -> void{
+        if(!priv->resultQueue)
+            return;
+
+        FileResult result;
+        result.path = path;
+        result.success = success;
+        result.digest = priv->fileDigest;
+        result.bytes = priv->progress.currentFileBytes();
+        result.duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - priv->fileStart);
+        if(!priv->resultQueue->push(std::move(result)))
+            priv->stopRequested = true;// nobody takes the results anymore
+    };
 }
 LibTreeHash::LibTreeHash(LibTreeHash&& mve)
     : autosave(mve.autosave)
@@ -104,6 +536,23 @@ QCryptographicHash::Algorithm LibTreeHash::getHashAlgorithm() const{
     return this->priv->hashAlgorithm;
 }
 
+void LibTreeHash::setHashFileFormat(HashFileFormat format){
+    this->priv->hashFileFormat = format;
+    this->priv->hashFileFormatSet = true;
+}
+
+HashFileFormat LibTreeHash::getHashFileFormat() const{
+    return this->priv->hashFileFormat;
+}
+
+void LibTreeHash::setCompactHashFile(bool compact){
+    this->priv->compactHashFile = compact;
+}
+
+bool LibTreeHash::isCompactHashFile() const{
+    return this->priv->compactHashFile;
+}
+
 void LibTreeHash::setHashesFilePath(const QString path){
     if(!QFileInfo::exists(path)){
         QFile file(path);
@@ -116,23 +565,63 @@ void LibTreeHash::setHashesFilePath(const QString path){
 
     auto srcFile = std::make_unique<QFile>(path);
     auto dstFile = std::make_unique<QFile>(path);
-    setHashesFile(std::move(srcFile), std::move(dstFile));
+    this->priv->useHashesFile(std::move(srcFile), std::move(dstFile), true, path);
 }
 
 void LibTreeHash::setHashesFile(std::unique_ptr<QFileDevice>&& src, std::unique_ptr<QFileDevice>&& dst, bool truncateDest)
 {
-    if(this->priv->hashFileSrc != nullptr && this->priv->hashFileSrc->isOpen()){
-        this->priv->hashFileSrc->close();
+    this->priv->useHashesFile(std::move(src), std::move(dst), truncateDest, QString());
+}
+
+void LibTreeHashPrivate::useHashesFile(std::unique_ptr<QFileDevice>&& src, std::unique_ptr<QFileDevice>&& dst, bool truncateDest, const QString& path){
+    this->finishCompaction();
+    this->journal.close();
+
+    if(this->hashFileSrc != nullptr && this->hashFileSrc->isOpen()){
+        this->hashFileSrc->close();
+    }
+    if(this->hashFileDst != nullptr && this->hashFileDst->isOpen()){
+        this->hashFileDst->close();
     }
-    if(this->priv->hashFileDst != nullptr && this->priv->hashFileDst->isOpen()){
-        this->priv->hashFileDst->close();
+
+    this->hashFileSrc = std::move(src);
+    this->hashFileDst = std::move(dst);
+    this->hashFilePath = path;
+    this->truncateHashFileDst = truncateDest;
+
+    this->openHashFile();
+}
+
+void LibTreeHash::setJournalEnabled(bool enabled){
+    this->priv->journalEnabled = enabled;
+    if(enabled){
+        this->priv->openJournal();
+    }else{
+        this->priv->finishCompaction();
+        this->priv->journal.close();
     }
+}
 
-    this->priv->hashFileSrc = std::move(src);
-    this->priv->hashFileDst = std::move(dst);
-    this->priv->truncateHashFileDst = truncateDest;
+bool LibTreeHash::isJournalEnabled() const{
+    return this->priv->journalEnabled;
+}
+
+void LibTreeHash::compactJournal(){
+    if(!this->priv->journal.isOpen()){
+        this->priv->eventListener.callOnError(QStringLiteral("journal is not enabled"), QStringLiteral("compactJournal"));
+        return;
+    }
+    if(this->priv->unfinishedRun.exists){
+        this->priv->eventListener.callOnWarning(QStringLiteral("an interrupted run is recorded in the journal; not compacting it"),
+                                                QStringLiteral("compactJournal"));
+        return;
+    }
 
-    this->priv->openHashFile();
+    this->priv->storeSettings();
+    if(!this->priv->saveToJournal())
+        return;
+    this->priv->startCompaction();
+    this->priv->finishCompaction();
 }
 
 const QFileDevice& LibTreeHash::getHashesFileSrc() const
@@ -144,6 +633,10 @@ const QFileDevice& LibTreeHash::getHashesFileDst() const{
     return *this->priv->hashFileDst;
 }
 
+qint64 LibTreeHash::getEntryCount() const{
+    return static_cast<qint64>(this->priv->index.size());
+}
+
 void LibTreeHash::setFiles(const QStringList paths)
 {
     this->priv->files = paths;
@@ -162,36 +655,404 @@ QString LibTreeHash::getHmacKey() const{
     return this->priv->hmacKey;
 }
 
-void LibTreeHash::run(){
+void LibTreeHash::setCheckpointInterval(qint64 seconds, qint64 bytes){
+    this->priv->checkpointSeconds = seconds;
+    this->priv->checkpointBytes = bytes;
+}
+
+void LibTreeHash::setResume(bool resume){
+    this->priv->resume = resume;
+}
+
+bool LibTreeHash::isResume() const{
+    return this->priv->resume;
+}
+
+void LibTreeHash::setHashStateMinSize(qint64 bytes){
+    this->priv->hashStateMinSize = bytes;
+}
+
+qint64 LibTreeHash::getHashStateMinSize() const{
+    return this->priv->hashStateMinSize;
+}
+
+void LibTreeHash::setBlockSize(qint64 bytes){
+    constexpr qint64 MAX_BLOCK_SIZE = 1024 * 1024 * 1024;
+    this->priv->blockSize = std::clamp<qint64>(bytes, 0, MAX_BLOCK_SIZE);
+}
+
+qint64 LibTreeHash::getBlockSize() const{
+    return this->priv->blockSize;
+}
+
+void LibTreeHash::setChunkSize(qint64 bytes){
+    constexpr qint64 MIN_CHUNK_SIZE = 4 * 1024;
+    constexpr qint64 MAX_CHUNK_SIZE = 64 * 1024 * 1024;
+    this->priv->chunkSize = bytes <= 0 ? 0 : std::clamp(bytes, MIN_CHUNK_SIZE, MAX_CHUNK_SIZE);
+}
+
+qint64 LibTreeHash::getChunkSize() const{
+    return this->priv->chunkSize;
+}
+
+void LibTreeHash::setSampleRate(double rate, quint64 seed){
+    this->priv->sampleRate = std::clamp(rate, 0.0, 1.0);
+    this->priv->sampleSeed = seed;
+}
+
+double LibTreeHash::getSampleRate() const{
+    return this->priv->sampleRate;
+}
+
+quint64 LibTreeHash::getSampleSeed() const{
+    return this->priv->sampleSeed;
+}
+
+SampleCoverage LibTreeHash::getSampleCoverage() const{
+    return this->priv->sampleCoverage;
+}
+
+void LibTreeHash::setEscalateSuspects(bool escalate){
+    this->priv->escalateSuspects = escalate;
+}
+
+bool LibTreeHash::isEscalateSuspects() const{
+    return this->priv->escalateSuspects;
+}
+
+void LibTreeHash::setRecordVerified(bool record){
+    this->priv->recordVerified = record;
+}
+
+bool LibTreeHash::isRecordVerified() const{
+    return this->priv->recordVerified;
+}
+
+void LibTreeHash::setVerifyBudget(qint64 seconds, qint64 bytes){
+    this->priv->verifyBudgetSeconds = std::max<qint64>(seconds, 0);
+    this->priv->verifyBudgetBytes = std::max<qint64>(bytes, 0);
+}
+
+bool LibTreeHash::wasBudgetExhausted() const{
+    return this->priv->budgetExhausted;
+}
+
+void LibTreeHash::setThreadCount(int threads){
+    this->priv->threadCount = std::max(threads, 1);
+}
+
+int LibTreeHash::getThreadCount() const{
+    return this->priv->threadCount;
+}
+
+void LibTreeHash::setEventSink(std::shared_ptr<EventSink> sink, size_t batchSize){
+    this->priv->eventListener.flushEvents();
+    this->priv->eventListener.sinkEvents = sink ? sink->wantedEvents() : 0;
+    this->priv->eventListener.sink = std::move(sink);
+    this->priv->eventBatchSize = std::max<size_t>(batchSize, 1);
+}
+
+void LibTreeHash::setProgressInterval(qint64 milliseconds){
+    this->priv->progressInterval = std::chrono::milliseconds(std::max<qint64>(milliseconds, 0));
+}
+
+qint64 LibTreeHash::getProgressInterval() const{
+    return this->priv->progressInterval.count();
+}
+
+Progress LibTreeHash::getProgress() const{
+    return this->priv->progress.get();
+}
+
+void LibTreeHash::requestStop(){
+    this->priv->stopRequested = true;
+}
+
+void LibTreeHash::pause(){
+    std::lock_guard lock(this->priv->pauseMutex);
+    this->priv->paused = true;
+}
+
+void LibTreeHash::resume(){
+    {
+        std::lock_guard lock(this->priv->pauseMutex);
+        this->priv->paused = false;
+    }
+    this->priv->pauseChanged.notify_all();
+}
+
+bool LibTreeHash::isPaused() const{
+    return this->priv->paused;
+}
+
+RunHandle LibTreeHash::runAsync(){
+    RunHandle handle;
+    handle.treeHash = this;
+    handle.result = std::async(std::launch::async, [this]() -> void{
+        this->run();
+    });
+    return handle;
+}
+
+ResultStream LibTreeHash::results(size_t bufferSize){
+    ResultStream stream;
+    stream.queue = std::make_shared<ResultQueue>(bufferSize);
+    this->priv->resultQueue = stream.queue;
+
+    stream.run.treeHash = this;
+    stream.run.result = std::async(std::launch::async, [this, queue = stream.queue]() -> void{
+        std::exception_ptr error;
+        try{
+            this->run();
+        }catch(...){
+            error = std::current_exception();
+        }
+        this->priv->resultQueue.reset();
+        queue->finish(error);
+    });
+    return stream;
+}
+
+ResultStream::~ResultStream(){
+    if(!this->queue)
+        return;
+    // the run stops at the next result (a paused one would never get there)
+    this->queue->close();
+    this->run.resume();
+}
+
+ResultStream::Iterator ResultStream::begin(){
+    Iterator iter;
+    iter.queue = this->queue.get();
+    iter.done = false;
+    ++iter;
+    return iter;
+}
+
+ResultStream::Iterator& ResultStream::Iterator::operator++(){
+    this->done = this->queue == nullptr || !this->queue->pop(this->current);
+    return *this;
+}
+
+RunHandle::~RunHandle(){
+    if(this->result.valid())
+        this->result.wait();
+}
+
+void RunHandle::cancel(){
+    if(this->treeHash == nullptr)
+        return;
+    this->treeHash->requestStop();
+    this->treeHash->resume();
+}
+
+void RunHandle::pause(){
+    if(this->treeHash != nullptr)
+        this->treeHash->pause();
+}
+
+void RunHandle::resume(){
+    if(this->treeHash != nullptr)
+        this->treeHash->resume();
+}
+
+bool RunHandle::isPaused() const{
+    return this->treeHash != nullptr && this->treeHash->isPaused();
+}
+
+bool RunHandle::isFinished() const{
+    return !this->result.valid() || this->result.wait_for(std::chrono::seconds(0)) == std::future_status::ready;
+}
+
+void RunHandle::wait(){
+    if(this->result.valid())
+        this->result.get();
+}
+
+bool RunHandle::waitFor(std::chrono::milliseconds timeout){
+    return !this->result.valid() || this->result.wait_for(timeout) == std::future_status::ready;
+}
+
+void LibTreeHashPrivate::waitWhilePaused(){
+    if(!this->paused)
+        return;
+
+    std::unique_lock lock(this->pauseMutex);
+    // requestStop() can not notify (it has to be async-signal-safe) -> check it periodically
+    while(this->paused && !this->stopRequested)
+        this->pauseChanged.wait_for(lock, std::chrono::milliseconds(100));
+}
+
+void LibTreeHashPrivate::reportProgress(bool force){
+    if(this->progress.update(this->progressInterval, force))
+        this->eventListener.callOnProgress(this->progress.get());
+}
+
+void LibTreeHash::setTraceFile(const QString& path, size_t spansPerThread){
+    this->priv->traceFile = path;
+    if(path.isEmpty())
+        this->priv->tracer.reset();
+    else
+        this->priv->tracer = std::make_unique<Tracer>(spansPerThread);
+}
+
+QString LibTreeHash::getTraceFile() const{
+    return this->priv->traceFile;
+}
+
+void LibTreeHash::setSlowFileReport(int count, double stragglerRatio){
+    this->priv->slowFileCount = static_cast<size_t>(std::max(count, 0));
+    this->priv->stragglerRatio = stragglerRatio;
+}
+
+std::vector<FileTiming> LibTreeHash::getSlowestFiles() const{
+    return this->priv->slowestFiles;
+}
+
+std::vector<FileTiming> LibTreeHash::getStragglers() const{
+    return this->priv->stragglers;
+}
+
+void LibTreeHash::setCollectStats(bool collect){
+    this->priv->collectStats = collect;
+}
+
+bool LibTreeHash::isCollectStats() const{
+    return this->priv->collectStats;
+}
+
+RunStats LibTreeHash::getRunStats() const{
+    return this->priv->stats;
+}
+
+bool LibTreeHash::wasInterrupted() const{
+    return this->priv->interrupted;
+}
+
+void LibTreeHash::setFailFast(bool failFast){
+    this->priv->failFast = failFast;
+}
+
+bool LibTreeHash::isFailFast() const{
+    return this->priv->failFast;
+}
+
+bool LibTreeHash::wasStoppedOnFailure() const{
+    return this->priv->failedFast;
+}
+
+RunStats LibTreeHash::run(){
     QString openError;
     if(!LibTreeHashPrivate::ensureFileOpen(*this->priv->hashFileSrc, false, &openError)){
         throw std::invalid_argument(QStringLiteral("unable to open HashesFile source: %1").arg(openError).toStdString());
     }
 
-    if(this->runMode == RunMode::UPDATE
-            || this->runMode == RunMode::UPDATE_NEW
-            || this->runMode == RunMode::UPDATE_MODIFIED){
+    // VERIFY only changes the hash-file if it records the verifications
+    const bool verify = this->runMode == RunMode::VERIFY || this->runMode == RunMode::VERIFY_QUICK;
+    const bool modifying = !verify || this->priv->recordVerified;
+    if(modifying){
         if(!LibTreeHashPrivate::ensureFileOpen(*this->priv->hashFileDst, true, &openError)){
             throw std::invalid_argument(QStringLiteral("unable to open HashesFile destination: %1").arg(openError).toStdString());
         }
     }
 
+    this->priv->stats = RunStats();
+    this->priv->stats.load = this->priv->loadStats;
+    if(this->priv->tracer)
+        this->priv->tracer->start(static_cast<size_t>(this->priv->threadCount));
+    StageTimer totalTimer(this->priv->stage(this->priv->stats.total), this->priv->tracer.get(), "run");
+
     QDir root(this->priv->rootDir);
     if(!root.exists()){
         this->priv->eventListener.callOnWarning(QStringLiteral("the root-dir does not exist"), QStringLiteral("run"));
     }
 
-    // ensure files obj is present
-    this->priv->hashFileData.emplace("files", json::value_t::object);
+    const bool update = this->runMode == RunMode::UPDATE
+            || this->runMode == RunMode::UPDATE_NEW
+            || this->runMode == RunMode::UPDATE_MODIFIED
+            || this->runMode == RunMode::SYNC;
+
+    // record the run in the journal, so that it can be resumed if it gets interrupted
+    bool resumeRun = false;
+    if(update && this->priv->journal.isOpen()){
+        if(this->priv->resume && this->priv->unfinishedRun.exists){
+            resumeRun = true;// continue the recorded run (its begin is still in the journal)
+        }else{
+            this->priv->journal.beginRun();
+            this->priv->unfinishedRun = Journal::UnfinishedRun();
+            this->priv->unfinishedRun.exists = true;
+        }
+    }else if(update && this->priv->resume){
+        this->priv->eventListener.callOnWarning(QStringLiteral("resuming needs the journal; processing all files"), QStringLiteral("run"));
+    }
 
-    this->priv->processFiles(this->runMode);
+    this->priv->interrupted = false;
+    this->priv->failedFast = false;
+    this->priv->budgetExhausted = false;
+    this->priv->sampleCoverage = SampleCoverage();
+    this->priv->bytesSinceCheckpoint = 0;
+    this->priv->lastCheckpoint = std::chrono::steady_clock::now();
+
+    this->priv->eventListener.batchSize = this->priv->eventBatchSize;
+    // also if the run throws: deliver the buffered events, stop batching and do not stop the next run at once
+    const auto finish = qScopeGuard([this]() -> void{
+        this->priv->stopRequested = false;
+        this->priv->eventListener.batchSize = 1;
+        this->priv->eventListener.flushEvents();
+    });
+
+    this->priv->processFiles(this->runMode, resumeRun);
+
+    if(update && this->priv->journal.isOpen() && !this->priv->interrupted){
+        this->priv->journal.endRun();
+        this->priv->unfinishedRun = Journal::UnfinishedRun();
+    }
 
-    if(this->autosave &&
-            (this->runMode == RunMode::UPDATE
-            || this->runMode == RunMode::UPDATE_NEW
-            || this->runMode == RunMode::UPDATE_MODIFIED)){
+    if(this->autosave && modifying){
         saveHashFile();
     }
+
+    totalTimer.stop();
+    if(this->priv->tracer){
+        QString err;
+        if(!this->priv->tracer->write(this->priv->traceFile, &err))
+            this->priv->eventListener.callOnWarning(QStringLiteral("unable to write trace (%1)").arg(err), this->priv->traceFile);
+    }
+    return this->priv->stats;
+}
+
+RunPlan LibTreeHash::dryRun() const{
+    const bool update = this->runMode != RunMode::VERIFY && this->runMode != RunMode::VERIFY_QUICK;
+    const bool resumeRun = update && this->priv->resume && this->priv->journal.isOpen() && this->priv->unfinishedRun.exists;
+
+    RunPlan plan;
+    for(const LibTreeHashPrivate::PlannedFile& planned : this->priv->planFiles(this->runMode, this->priv->files, resumeRun)){
+        switch(planned.action){
+            case LibTreeHashPrivate::PlannedAction::HASH:
+                plan.hashFiles++;
+                plan.hashBytes += planned.size;
+                break;
+            case LibTreeHashPrivate::PlannedAction::SKIP:
+            case LibTreeHashPrivate::PlannedAction::MATCH:
+                plan.skippedFiles++;
+                plan.skippedBytes += planned.size;
+                break;
+            case LibTreeHashPrivate::PlannedAction::SIZE_MISMATCH:
+                plan.sizeMismatches++;
+                break;
+            case LibTreeHashPrivate::PlannedAction::SUSPECT:
+                plan.suspectFiles++;
+                break;
+            case LibTreeHashPrivate::PlannedAction::NO_ENTRY:
+                plan.missingEntries++;
+                break;
+            case LibTreeHashPrivate::PlannedAction::MALFORMED_ENTRY:
+            case LibTreeHashPrivate::PlannedAction::NOT_A_FILE:
+                plan.invalidFiles++;
+                break;
+        }
+    }
+    return plan;
 }
 
 void LibTreeHash::saveHashFile(){
@@ -199,14 +1060,51 @@ void LibTreeHash::saveHashFile(){
 }
 
 bool LibTreeHashPrivate::saveHashFile(){
-    this->hashFileData["version"] = LibTreeHash::FILE_VERSION;
+    StageTimer timer(this->stage(this->stats.save), this->tracer.get(), "save");
     storeSettings();
 
-    std::string jsonData = this->hashFileData.dump(2);
+    if(this->journal.isOpen()){
+        const bool saved = this->saveToJournal();
+        // a journal which was closed by the failed commit can not take the changes -> save the whole file
+        if(saved || this->journal.isOpen())
+            return saved;
+    }
+
+    // a compaction started before the journal was closed must not rename its older snapshot over the file saved here
+    this->finishCompaction();
+
+    QString err;
+    if(!this->hashFilePath.isNull()){
+        // write a new file and rename it (the loaded file may be memory-mapped, so it must not be overwritten in place)
+        QSaveFile file(this->hashFilePath);
+        if(file.open(QFileDevice::OpenModeFlag::WriteOnly)){
+            if(!this->writeHashFile(file, &err)){
+                file.cancelWriting();
+                this->eventListener.callOnError(QStringLiteral("unable to save hashes (write): ") + err,
+                                                QStringLiteral("saving hashes"));
+                return false;
+            }
+
+            if(!file.commit()){
+                this->eventListener.callOnError(QStringLiteral("unable to save hashes (commit): ") + file.errorString(),
+                                                QStringLiteral("saving hashes"));
+                return false;
+            }
+
+            if(!this->reopenHashFile(&err)){
+                this->eventListener.callOnError(QStringLiteral("unable to reopen saved hashes: ") + err,
+                                                QStringLiteral("saving hashes"));
+                return false;
+            }
+
+            this->removeJournal();
+            return true;
+        }
+        // the dir might not be writeable -> rewrite the file in place
+    }
 
     // rewrite file
     QFileDevice& file = *this->hashFileDst;
-    QString err;
     if(!ensureFileOpen(file, true, &err)){
         this->eventListener.callOnError(QStringLiteral("unable to save hashes (open): ") + err,
                                         QStringLiteral("saving hashes"));
@@ -214,84 +1112,352 @@ bool LibTreeHashPrivate::saveHashFile(){
     }
 
     if(this->truncateHashFileDst){
+        this->index.detach();// truncating would invalidate the mapped entries
+
         if(!file.resize(0)){
             this->eventListener.callOnError(QStringLiteral("unable to save hashes (truncate): ") + file.errorString(),
                                             QStringLiteral("saving hashes"));
             return false;
         }
-    }
+    }
+
+    if(!this->writeHashFile(file, &err)){
+        this->eventListener.callOnError(QStringLiteral("unable to save hashes (write): ") + err,
+                                        QStringLiteral("saving hashes"));
+        return false;
+    }
+
+    file.flush();
+    fsync(file.handle());// without this the tests would read only an empty file
+
+    if(!this->hashFilePath.isNull())
+        this->removeJournal();
+    return true;
+}
+
+bool LibTreeHashPrivate::writeHashFile(QFileDevice& file, QString* error){
+    return writeHashFile(file, this->index, this->settings, this->hashFileFormat, this->compactHashFile, error);
+}
+
+bool LibTreeHashPrivate::writeHashFile(QFileDevice& file, const HashIndex& index, const json& settings,
+                                       HashFileFormat format, bool compact, QString* error){
+    if(format == HashFileFormat::BINARY){
+        return BinaryHashFile::save(file, index, QByteArray::fromStdString(settings.dump()), error);
+    }
+
+    return JsonHashFile::save(file, index, settings, compact, error);
+}
+
+void LibTreeHashPrivate::putEntry(std::string_view path, FileEntry entry){
+    StageTimer timer(nullptr, this->tracer.get(), "index update");
+    if(this->journal.isOpen()){
+        this->journal.put(path, entry);
+        if(this->unfinishedRun.exists){
+            this->unfinishedRun.completed.emplace(path);
+            this->unfinishedRun.partial.erase(std::string(path));
+        }
+    }
+    this->index.put(path, std::move(entry));
+
+    QString err;
+    if(!this->journal.commitIfDue(&err))
+        this->eventListener.callOnError(err, QStringLiteral("journal"));
+}
+
+void LibTreeHashPrivate::markVerified(const std::string& path){
+    if(!this->recordVerified)
+        return;
+    const auto existing = this->index.find(path);
+    if(!existing)
+        return;
+
+    const qint64 now = QDateTime::currentSecsSinceEpoch();
+    FileEntry entry = existing->toEntry();
+    entry.lastVerified = now;
+    this->index.put(path, std::move(entry));
+
+    // only the timestamp is journaled (instead of the whole entry)
+    if(this->journal.isOpen()){
+        this->journal.verified(path, now);
+
+        QString err;
+        if(!this->journal.commitIfDue(&err))
+            this->eventListener.callOnError(err, QStringLiteral("journal"));
+    }
+}
+
+QStringList LibTreeHashPrivate::filesByLastVerified() const{
+    const QDir root(this->rootDir);
+    std::vector<std::pair<qint64, qsizetype>> order;
+    order.reserve(static_cast<size_t>(this->files.size()));
+    for(qsizetype i = 0; i < this->files.size(); i++){
+        const auto entry = this->index.find(root.relativeFilePath(this->files[i]).toStdString());
+        order.emplace_back(entry ? entry->lastVerified : -1, i);
+    }
+    std::stable_sort(order.begin(), order.end(), [](const auto& a, const auto& b) -> bool{
+        return a.first < b.first;
+    });
+
+    QStringList sorted;
+    sorted.reserve(this->files.size());
+    for(const auto& [lastVerified, i] : order)
+        sorted.append(this->files[i]);
+    return sorted;
+}
+
+void LibTreeHashPrivate::eraseUnlistedEntries(const std::unordered_set<std::string>& listed){
+    std::vector<std::string> toErase;
+    this->index.forEach([&listed, &toErase](const EntryView& entry) -> void{
+        if(!listed.contains(std::string(entry.path)))
+            toErase.emplace_back(entry.path);
+    });
+    for(const std::string& path : toErase)
+        this->eraseEntry(path);
+}
+
+bool LibTreeHashPrivate::eraseEntry(std::string_view path){
+    if(!this->index.erase(path))
+        return false;
+
+    if(this->journal.isOpen()){
+        this->journal.erase(path);
+        if(this->unfinishedRun.exists){
+            this->unfinishedRun.completed.erase(std::string(path));
+            this->unfinishedRun.partial.erase(std::string(path));
+        }
+
+        QString err;
+        if(!this->journal.commitIfDue(&err))
+            this->eventListener.callOnError(err, QStringLiteral("journal"));
+    }
+    return true;
+}
+
+void LibTreeHashPrivate::openJournal(){
+    if(!this->journalEnabled || this->hashFilePath.isNull() || this->journal.isOpen())
+        return;
+    if(this->journalValidSize < 0){
+        this->eventListener.callOnError(QStringLiteral("the journal could not be loaded; not appending to it"),
+                                        QStringLiteral("opening journal"));
+        return;
+    }
+
+    QString err;
+    if(!this->journal.open(Journal::pathFor(this->hashFilePath), this->journalValidSize, &err))
+        this->eventListener.callOnError(err, QStringLiteral("opening journal"));
+}
+
+bool LibTreeHashPrivate::saveToJournal(){
+    if(this->settings != this->persistedSettings){
+        this->journal.storeSettings(this->settings);
+        this->persistedSettings = this->settings;
+    }
+
+    QString err;
+    if(!this->journal.commit(&err)){
+        this->eventListener.callOnError(QStringLiteral("unable to save hashes (journal): ") + err,
+                                        QStringLiteral("saving hashes"));
+        return false;
+    }
+
+    // fold the journal into the hash-file when replaying it would cost a noticeable part of loading
+    // (not while a run is recorded in it, as compacting would drop the begin of the run)
+    constexpr qint64 MIN_COMPACTION_SIZE = 4 * 1024 * 1024;
+    if(!this->unfinishedRun.exists
+            && this->journal.size() > std::max(MIN_COMPACTION_SIZE, QFileInfo(this->hashFilePath).size() / 2))
+        this->startCompaction();
+
+    return true;
+}
+
+void LibTreeHashPrivate::removeJournal(){
+    this->journalValidSize = 0;
+    this->unfinishedRun = Journal::UnfinishedRun();
+    if(!Journal::remove(Journal::pathFor(this->hashFilePath)))
+        this->eventListener.callOnError(QStringLiteral("unable to remove the journal (its changes are already saved)"),
+                                        QStringLiteral("saving hashes"));
+}
+
+void LibTreeHashPrivate::startCompaction(){
+    if(this->compactionRunning)
+        return;
+    this->finishCompaction();
+
+    // the journal up to here is contained in the snapshot (the base-table is shared, only the changes are copied)
+    const qint64 journalOffset = this->journal.size();
+    HashIndex snapshot = this->index;
+
+    this->compactionRunning = true;
+    this->compactionThread = std::thread([this, snapshot = std::move(snapshot), settings = this->settings,
+                                          format = this->hashFileFormat, compact = this->compactHashFile,
+                                          path = this->hashFilePath, journalOffset](){
+        QString err;
+        bool committed = false;
+        QSaveFile file(path);
+        if(!file.open(QFileDevice::OpenModeFlag::WriteOnly)){
+            err = QStringLiteral("unable to compact journal (open): ") + file.errorString();
+        }else if(!writeHashFile(file, snapshot, settings, format, compact, &err)){
+            file.cancelWriting();
+            err = QStringLiteral("unable to compact journal (write): ") + err;
+        }else if(!file.commit()){
+            err = QStringLiteral("unable to compact journal (commit): ") + file.errorString();
+        }else{
+            committed = true;
+            if(!this->journal.dropUpTo(journalOffset, &err)){
+                // the hash-file is complete, replaying the old records again does not change anything
+                err = QStringLiteral("unable to compact journal (truncate): ") + err;
+            }
+        }
 
-    if(file.write(jsonData.c_str()) == -1){
-        this->eventListener.callOnError(QStringLiteral("unable to save hashes (write): ") + file.errorString(),
-                                        QStringLiteral("saving hashes"));
-        return false;
-    }
+        {
+            std::lock_guard<std::mutex> lock(this->compactionMtx);
+            this->compactionError = err;
+            this->compactionCommitted = committed;
+        }
+        this->compactionRunning = false;
+    });
+}
 
-    file.flush();
-    fsync(file.handle());// without this the tests would read only an empty file
+void LibTreeHashPrivate::finishCompaction(){
+    if(!this->compactionThread.joinable())
+        return;
+    this->compactionThread.join();
 
-    return true;
+    QString err;
+    bool committed;
+    {
+        std::lock_guard<std::mutex> lock(this->compactionMtx);
+        err = this->compactionError;
+        committed = this->compactionCommitted;
+        this->compactionError = QString();
+        this->compactionCommitted = false;
+    }
+    if(!err.isNull())
+        this->eventListener.callOnError(err, QStringLiteral("compacting journal"));
+
+    // the devices are only used by this thread, so they are reopened here and not by the compaction
+    QString reopenErr;
+    if(committed && !this->reopenHashFile(&reopenErr))
+        this->eventListener.callOnError(QStringLiteral("unable to reopen compacted hashes: ") + reopenErr,
+                                        QStringLiteral("compacting journal"));
 }
 
 void LibTreeHashPrivate::storeSettings(){
-    json& settings = *this->hashFileData.emplace("settings", json::value_t::object).first;
-    settings["rootDir"] = this->rootDir.toStdString();
-    settings["hashAlgorithm"] = QMetaEnum::fromType<QCryptographicHash::Algorithm>().valueToKey(this->hashAlgorithm);
+    if(!this->settings.is_object())
+        this->settings = json::object();
+    this->settings["rootDir"] = this->rootDir.toStdString();
+    this->settings["hashAlgorithm"] = QMetaEnum::fromType<QCryptographicHash::Algorithm>().valueToKey(this->hashAlgorithm);
+}
+
+void LibTreeHashPrivate::checkpointIfDue(){
+    if(this->isCheckpointDue())
+        this->checkpoint();
+}
+
+bool LibTreeHashPrivate::isCheckpointDue() const{
+    const bool timeDue = this->checkpointSeconds > 0
+            && std::chrono::steady_clock::now() - this->lastCheckpoint >= std::chrono::seconds(this->checkpointSeconds);
+    const bool sizeDue = this->checkpointBytes > 0 && this->bytesSinceCheckpoint >= this->checkpointBytes;
+    return timeDue || sizeDue;
+}
+
+void LibTreeHashPrivate::checkpoint(){
+    this->lastCheckpoint = std::chrono::steady_clock::now();
+    this->bytesSinceCheckpoint = 0;
+
+    // without the journal the whole file is rewritten, which is not possible if the destination is only appended to (stdout)
+    if(!this->journal.isOpen() && this->hashFilePath.isNull() && !this->truncateHashFileDst)
+        return;
+    this->saveHashFile();
+}
+
+bool LibTreeHashPrivate::isCompletedByRun(const QString& file, const std::string& relPath) const{
+    if(!this->unfinishedRun.completed.contains(relPath))
+        return false;
+
+    const auto entry = this->index.find(relPath);
+    return entry && entry->lastModified == QFileInfo(file).lastModified().toSecsSinceEpoch();
 }
 
 void LibTreeHashPrivate::verifyEntry(const QString& file, const QString& relPath){
+    // planFiles() only passes files with a valid entry of the same size
+    const auto entry = this->index.find(relPath.toStdString());
+    if(this->hasBlockHashes(*entry)){
+        this->verifyBlocks(file, *entry, this->selectBlocks(*entry));
+        return;
+    }
+    const QByteArray expected = entry->hash.toByteArray();
+
     // compute hash
-    QString hash = this->computeFileHash(file);
+    QByteArray hash = this->computeFileHash(file, std::string(), false);
     if(hash.isNull()){
-        this->eventListener.callOnFileProcessed(file, false);
+        if(!this->interrupted)
+            this->eventListener.callOnFileProcessed(file, false);
         return;
     }
 
+    const qint64 size = QFileInfo(file).size();
+    this->sampleCoverage.totalBytes += size;
+    this->sampleCoverage.checkedBytes += size;
+
+    this->fileDigest = hash;
+
     // compare with list
-    const json& files = this->hashFileData["files"];
-    if(auto entry = files.find(relPath.toStdString()); entry != files.end()){
-        const auto storedHash = entry.value().find("hash");
-        if(storedHash != entry.value().end() && storedHash->is_string()){
-            std::string storedHashStr = storedHash->get<std::string>();
-            bool matches = storedHashStr.c_str() == hash;
-            this->eventListener.callOnFileProcessed(file, matches);
-        }else{
-            this->eventListener.callOnError(QStringLiteral("stored hash is not of type string; skipping"), file);
-            this->eventListener.callOnFileProcessed(file, false);
-        }
-    }else{
-        this->eventListener.callOnWarning(QStringLiteral("file has no saved hash; skipping"), file);
-        this->eventListener.callOnFileProcessed(file, false);//TODO maybe return true
-    }
+    const bool matches = expected == hash;
+    if(matches)
+        this->markVerified(relPath.toStdString());
+    this->eventListener.callOnFileProcessed(file, matches);
 }
 
-void LibTreeHashPrivate::updateEntry(const QString& file, const QString& relPath){
-    QString hash = this->computeFileHash(file);
+void LibTreeHashPrivate::updateEntry(const QString& file, const QString& relPath, const FileEntry* previous){
+    const std::string path = relPath.toStdString();
+    FileEntry entry;
+    QByteArray hash = this->computeFileHash(file, path, true, previous, &entry);
     if(hash.isNull()){
-        this->eventListener.callOnFileProcessed(file, false);
+        if(!this->interrupted)
+            this->eventListener.callOnFileProcessed(file, false);
         return;
     }
 
-    qint64 lastModified = QFileInfo(file).lastModified().toSecsSinceEpoch();
+    if(previous != nullptr && !previous->chunks.isEmpty() && previous->chunkSize == entry.chunkSize && !entry.chunks.isEmpty()){
+        const ChunkIndexer::Changes changes = ChunkIndexer::compare(previous->chunks, entry.chunks);
+        this->eventListener.callOnChunkChanges(file, changes.changedChunks, changes.chunkCount, changes.changedBytes);
+    }
 
-    json entry = json::object();
-    entry.emplace("hash", hash.toStdString());
-    entry.emplace("lastModified", lastModified);
-    this->hashFileData["files"][relPath.toStdString()] = entry;
+    this->fileDigest = hash;
+    entry.hash = hash;
+    entry.lastModified = QFileInfo(file).lastModified().toSecsSinceEpoch();
+    readStatData(file, entry);
+    this->putEntry(path, std::move(entry));
 
     this->eventListener.callOnFileProcessed(file, true);
 }
 
 void LibTreeHashPrivate::openHashFile(){
+    this->loadStats = StageStats();
+    StageTimer timer(&this->loadStats);
+
     QString loadError;
     if(!ensureFileOpen(*this->hashFileSrc, false, &loadError))
         return;
-    this->hashFileData = LibTreeHashPrivate::loadHashes(*this->hashFileSrc, &loadError);
+    this->loadHashes(*this->hashFileSrc, &loadError);
     if(!loadError.isNull()){
         this->eventListener.callOnError(loadError, QStringLiteral("loading hashfile"));
         return;
     }
 
+    // changes which were not yet folded into the hash-file (replayed even if the journal is disabled)
+    this->journalValidSize = 0;
+    this->unfinishedRun = Journal::UnfinishedRun();
+    if(!this->hashFilePath.isNull()){
+        this->journalValidSize = Journal::replay(Journal::pathFor(this->hashFilePath), this->index, this->settings,
+                                                 &this->unfinishedRun, &loadError);
+        if(!loadError.isNull())
+            this->eventListener.callOnError(loadError, QStringLiteral("loading journal"));
+    }
+    this->persistedSettings = this->settings;
+    this->openJournal();
+
     loadSettings(&loadError);
     if(!loadError.isNull()){
         ;
@@ -299,15 +1465,15 @@ void LibTreeHashPrivate::openHashFile(){
 }
 
 void LibTreeHashPrivate::loadSettings(QString* err){
-    if(const auto settings = this->hashFileData.find("settings"); settings != this->hashFileData.end()){
+    if(this->settings.is_object()){
         if(!this->rootSet){
-            if(const auto root = settings->find("rootDir"); root != settings->end()){
+            if(const auto root = this->settings.find("rootDir"); root != this->settings.end()){
                 this->rootDir = QString::fromStdString(root->get<std::string>());
             }
         }
 
         if(!this->hashAlgoSet){
-            if(const auto algo = settings->find("hashAlgorithm"); algo != settings->end()){
+            if(const auto algo = this->settings.find("hashAlgorithm"); algo != this->settings.end()){
                 std::string storedHashAlgo = algo->get<std::string>();
                 bool valid;
                 auto algoVal = QMetaEnum::fromType<QCryptographicHash::Algorithm>().keyToValue(storedHashAlgo.c_str(), &valid);
@@ -330,127 +1496,715 @@ void LibTreeHashPrivate::loadSettings(QString* err){
         *err = QString();
 }
 
-void LibTreeHashPrivate::processFiles(RunMode runMode){
+std::vector<LibTreeHashPrivate::PlannedFile> LibTreeHashPrivate::planFiles(RunMode runMode, const QStringList& files, bool resumeRun) const{
     const QDir root(this->rootDir);
+    std::vector<PlannedFile> plan;
+    plan.reserve(static_cast<size_t>(files.size()));
 
     QFileInfo fi;
-    QString relPath;
-    for(QString& f : this->files){
+    for(const QString& f : files){
+        PlannedFile& planned = plan.emplace_back();
+        planned.path = f;
+
         fi.setFile(f);
         if(!fi.isFile()){
-            this->eventListener.callOnWarning(QStringLiteral("item on file-list is not a file; skipping"), f);
-            this->eventListener.callOnFileProcessed(f, false);
+            planned.action = PlannedAction::NOT_A_FILE;
             continue;
         }
+        planned.relPath = root.relativeFilePath(f);
+        planned.size = fi.size();
 
-        // create relative path
-        relPath = root.relativeFilePath(f);
-        if(relPath.contains(QStringLiteral("../"))){
-            this->eventListener.callOnWarning(QStringLiteral("file is not in root-dir or its subdirs"), f);
+        const std::string relPath = planned.relPath.toStdString();
+        if(resumeRun && this->isCompletedByRun(f, relPath)){
+            planned.action = PlannedAction::SKIP;
+            continue;
         }
 
-        switch (runMode) {
+        const auto entry = this->index.find(relPath);
+        switch(runMode){
             case RunMode::VERIFY: {
-                this->verifyEntry(f, relPath);
+                if(!entry)
+                    planned.action = PlannedAction::NO_ENTRY;
+                else if(entry->hash.isEmpty())
+                    planned.action = PlannedAction::MALFORMED_ENTRY;
+                else if(entry->size >= 0 && entry->size != planned.size){
+                    planned.action = PlannedAction::SIZE_MISMATCH;// can not match -> no need to read it
+                    planned.storedSize = entry->size;
+                }else
+                    planned.action = PlannedAction::HASH;
+                break;
+            }
+            case RunMode::VERIFY_QUICK: {
+                if(!entry){
+                    planned.action = PlannedAction::NO_ENTRY;
+                    break;
+                }
+                if(entry->size >= 0 && entry->size != planned.size){
+                    planned.action = PlannedAction::SIZE_MISMATCH;
+                    planned.storedSize = entry->size;
+                    break;
+                }
+
+                // the values of older entries are not known -> only the stored ones are compared
+                FileEntry current;
+                QStringList differs;
+                if(!readStatData(f, current)){
+                    differs.append(QStringLiteral("unreadable"));
+                }else{
+                    if(entry->mtimeNs >= 0 ? entry->mtimeNs != current.mtimeNs
+                                           : entry->lastModified >= 0 && entry->lastModified != fi.lastModified().toSecsSinceEpoch())
+                        differs.append(QStringLiteral("mtime"));
+                    if(entry->ctimeNs >= 0 && entry->ctimeNs != current.ctimeNs)
+                        differs.append(QStringLiteral("ctime"));
+                    if(entry->inode >= 0 && entry->inode != current.inode)
+                        differs.append(QStringLiteral("inode"));
+                }
+
+                if(differs.isEmpty())
+                    planned.action = PlannedAction::MATCH;
+                else if(!this->escalateSuspects)
+                    planned.action = PlannedAction::SUSPECT;
+                else if(entry->hash.isEmpty())
+                    planned.action = PlannedAction::MALFORMED_ENTRY;
+                else
+                    planned.action = PlannedAction::HASH;
+                planned.reason = differs.join(QStringLiteral(", "));
                 break;
             }
             case RunMode::UPDATE: {
-                this->updateEntry(f, relPath);
+                planned.action = PlannedAction::HASH;
                 break;
             }
             case RunMode::UPDATE_NEW: {
-                if(!this->hashFileData["files"].contains(relPath.toStdString())){
-                    this->updateEntry(f, relPath);
-                }
+                planned.action = entry ? PlannedAction::SKIP : PlannedAction::HASH;
                 break;
             }
             case RunMode::UPDATE_MODIFIED: {
-                const auto& files = this->hashFileData["files"];
-                if(const auto fileEntry = files.find(relPath.toStdString()); fileEntry != files.end()){
-                    if(const auto lastModified = fileEntry->find("lastModified"); lastModified != fileEntry->end()){
-                        qint64 currentModTime = QFileInfo(f).lastModified().toSecsSinceEpoch();
-                        if(currentModTime > lastModified->get<qint64>()){
-                            this->updateEntry(f, relPath);
-                        }
-                    }else{
-                        this->eventListener.callOnError("file-entry is malformed; skipping", f);
-                        this->eventListener.callOnFileProcessed(f, false);
-                    }
+                if(!entry)
+                    planned.action = PlannedAction::NO_ENTRY;
+                else if(entry->lastModified == -1)
+                    planned.action = PlannedAction::MALFORMED_ENTRY;
+                else if(fi.lastModified().toSecsSinceEpoch() > entry->lastModified)
+                    planned.action = PlannedAction::HASH;
+                else
+                    planned.action = PlannedAction::SKIP;
+                break;
+            }
+            case RunMode::SYNC: {
+                // a malformed entry is replaced
+                if(!entry || entry->lastModified == -1 || fi.lastModified().toSecsSinceEpoch() > entry->lastModified)
+                    planned.action = PlannedAction::HASH;
+                else
+                    planned.action = PlannedAction::SKIP;
+                break;
+            }
+        }
+    }
+
+    // the files which are not read are finished first, so that their results are not delayed by the hashing
+    std::stable_partition(plan.begin(), plan.end(), [](const PlannedFile& planned) -> bool{
+        return planned.action != PlannedAction::HASH;
+    });
+    return plan;
+}
+
+void LibTreeHashPrivate::processFiles(RunMode runMode, bool resumeRun){
+    // with a budget the files which were not verified for the longest time go first
+    const bool budgeted = runMode == RunMode::VERIFY && (this->verifyBudgetSeconds > 0 || this->verifyBudgetBytes > 0);
+    StageTimer planTimer(this->stage(this->stats.plan), this->tracer.get(), "plan");
+    const std::vector<PlannedFile> plan = this->planFiles(runMode, budgeted ? this->filesByLastVerified() : this->files, resumeRun);
+    planTimer.stop(static_cast<qint64>(plan.size()));
+    const auto start = std::chrono::steady_clock::now();
+    qint64 verifiedBytes = 0;
+    // SYNC: the entries of all listed files; the others are removed at the end
+    std::unordered_set<std::string> listed;
+    std::vector<FileSample> samples;
+    this->slowestFiles.clear();
+    this->stragglers.clear();
+
+    qint64 totalBytes = 0;
+    for(const PlannedFile& planned : plan){
+        if(planned.action == PlannedAction::HASH)
+            totalBytes += planned.size;
+    }
+    this->progress.start(static_cast<qint64>(plan.size()), totalBytes);
+    this->reportProgress(true);
+
+    for(const PlannedFile& planned : plan){
+        const QString& f = planned.path;
+        const QString& relPath = planned.relPath;
+
+        this->waitWhilePaused();
+        if(this->stopRequested){
+            this->interrupted = true;
+            break;
+        }
+        this->fileStart = std::chrono::steady_clock::now();
+        this->fileDigest = QByteArray();
+        if(budgeted && planned.action == PlannedAction::HASH){
+            const auto elapsed = std::chrono::duration_cast<std::chrono::seconds>(std::chrono::steady_clock::now() - start);
+            if((this->verifyBudgetSeconds > 0 && elapsed.count() >= this->verifyBudgetSeconds)
+                    || (this->verifyBudgetBytes > 0 && verifiedBytes >= this->verifyBudgetBytes)){
+                this->budgetExhausted = true;
+                break;
+            }
+        }
+
+        if(planned.action == PlannedAction::NOT_A_FILE){
+            this->eventListener.callOnWarning(QStringLiteral("item on file-list is not a file; skipping"), f);
+            this->eventListener.callOnFileProcessed(f, false);
+            this->progress.finishFile();
+            this->stats.files++;
+            continue;
+        }
+
+        if(relPath.contains(QStringLiteral("../"))){
+            this->eventListener.callOnWarning(QStringLiteral("file is not in root-dir or its subdirs"), f);
+        }
+        if(runMode == RunMode::SYNC)
+            listed.insert(relPath.toStdString());
+
+        switch(planned.action){
+            case PlannedAction::SKIP:
+            case PlannedAction::NOT_A_FILE: {
+                break;
+            }
+            case PlannedAction::NO_ENTRY: {
+                this->eventListener.callOnWarning(QStringLiteral("file has no saved hash; skipping"), f);
+                this->eventListener.callOnFileProcessed(f, false);//TODO maybe return true
+                break;
+            }
+            case PlannedAction::MALFORMED_ENTRY: {
+                this->eventListener.callOnError(runMode == RunMode::VERIFY ? QStringLiteral("stored hash is malformed; skipping")
+                                                                           : QStringLiteral("file-entry is malformed; skipping"), f);
+                this->eventListener.callOnFileProcessed(f, false);
+                break;
+            }
+            case PlannedAction::SIZE_MISMATCH: {
+                this->sampleCoverage.totalBytes += planned.size;
+                this->eventListener.callOnWarning(QStringLiteral("size of file differs from the stored one (%1 instead of %2 bytes)")
+                                                      .arg(planned.size).arg(planned.storedSize), f);
+                this->eventListener.callOnFileProcessed(f, false);
+                break;
+            }
+            case PlannedAction::MATCH: {
+                this->eventListener.callOnFileProcessed(f, true);
+                break;
+            }
+            case PlannedAction::SUSPECT: {
+                this->eventListener.callOnWarning(QStringLiteral("metadata differs from the stored one (%1)").arg(planned.reason), f);
+                this->eventListener.callOnFileProcessed(f, false);
+                break;
+            }
+            case PlannedAction::HASH: {
+                StageTimer fileTimer(nullptr, this->tracer.get(), "file");
+                this->progress.startFile(f, planned.size);
+                if(runMode == RunMode::VERIFY || runMode == RunMode::VERIFY_QUICK){
+                    this->verifyEntry(f, relPath);
+                    verifiedBytes += planned.size;
+                }else if(const auto fileEntry = this->index.find(relPath.toStdString());
+                         fileEntry && fileEntry->lastModified != -1 && runMode != RunMode::UPDATE){
+                    // UPDATE_MODIFIED and SYNC: only the appended data of files which only grew has to be hashed
+                    // (copied, as the view becomes invalid when the index is modified)
+                    const FileEntry previous = fileEntry->toEntry();
+                    this->updateEntry(f, relPath, &previous);
                 }else{
-                    this->eventListener.callOnWarning("file has no saved hash; skipping", f);
-                    this->eventListener.callOnFileProcessed(f, false);//TODO maybe return true
+                    this->updateEntry(f, relPath);
+                }
+
+                if(this->slowFileCount > 0){
+                    const auto duration = std::chrono::duration_cast<std::chrono::microseconds>(std::chrono::steady_clock::now() - this->fileStart);
+                    samples.push_back(FileSample{static_cast<size_t>(&planned - plan.data()), this->progress.currentDeviceName(),
+                                                 this->progress.currentFileBytes(), duration});
                 }
                 break;
             }
         }
+        this->progress.finishFile();
+        this->reportProgress();
+        this->stats.files++;
+        if(planned.action == PlannedAction::HASH)
+            this->stats.readFiles++;
+        else if(planned.action == PlannedAction::SKIP || planned.action == PlannedAction::MATCH)
+            this->stats.skippedFiles++;
+
+        if(runMode != RunMode::VERIFY && runMode != RunMode::VERIFY_QUICK)
+            this->checkpointIfDue();
+    }
+    this->reportProgress(true);
+    if(this->slowFileCount > 0)
+        this->reportSlowFiles(plan, samples);
+
+    // an interrupted run did not see all files
+    if(runMode == RunMode::SYNC && !this->interrupted)
+        this->eraseUnlistedEntries(listed);
+}
+
+void LibTreeHashPrivate::reportSlowFiles(const std::vector<PlannedFile>& plan, const std::vector<FileSample>& samples){
+    // the throughput of smaller files is dominated by opening them
+    constexpr qint64 STRAGGLER_MIN_SIZE = 1024 * 1024;
+    // a median of fewer files says nothing about the device
+    constexpr size_t STRAGGLER_MIN_FILES = 3;
+
+    const auto toTiming = [&plan](const FileSample& sample) -> FileTiming{
+        FileTiming timing;
+        timing.path = plan[sample.index].path;
+        timing.device = sample.device;
+        timing.bytes = sample.bytes;
+        timing.duration = sample.duration;
+        if(sample.duration.count() > 0)
+            timing.bytesPerSecond = static_cast<double>(sample.bytes) * 1000000.0 / static_cast<double>(sample.duration.count());
+        return timing;
+    };
+
+    std::vector<const FileSample*> slowest;
+    slowest.reserve(samples.size());
+    for(const FileSample& sample : samples)
+        slowest.push_back(&sample);
+    const size_t count = std::min(this->slowFileCount, slowest.size());
+    std::partial_sort(slowest.begin(), slowest.begin() + count, slowest.end(), [](const FileSample* a, const FileSample* b) -> bool{
+        return a->duration > b->duration;
+    });
+    for(size_t i = 0; i < count; i++)
+        this->slowestFiles.push_back(toTiming(*slowest[i]));
+
+    std::map<QString, std::vector<double>> deviceRates;
+    std::vector<FileTiming> candidates;
+    for(const FileSample& sample : samples){
+        if(sample.bytes < STRAGGLER_MIN_SIZE || sample.duration.count() <= 0)
+            continue;
+        candidates.push_back(toTiming(sample));
+        deviceRates[sample.device].push_back(candidates.back().bytesPerSecond);
+    }
+
+    std::map<QString, double> medians;
+    for(auto& [device, rates] : deviceRates){
+        if(rates.size() < STRAGGLER_MIN_FILES)
+            continue;
+        const auto mid = rates.begin() + static_cast<std::ptrdiff_t>(rates.size() / 2);
+        std::nth_element(rates.begin(), mid, rates.end());
+        medians[device] = *mid;
+    }
+
+    for(FileTiming& timing : candidates){
+        const auto median = medians.find(timing.device);
+        if(median != medians.end() && timing.bytesPerSecond < median->second * this->stragglerRatio){
+            this->eventListener.callOnWarning(QStringLiteral("read throughput (%1 MiB/s) is far below the median of the device (%2 MiB/s)")
+                                                  .arg(timing.bytesPerSecond / (1024 * 1024), 0, 'f', 2)
+                                                  .arg(median->second / (1024 * 1024), 0, 'f', 2), timing.path);
+            this->stragglers.push_back(std::move(timing));
+        }
     }
+    std::sort(this->stragglers.begin(), this->stragglers.end(), [](const FileTiming& a, const FileTiming& b) -> bool{
+        return a.bytesPerSecond < b.bytesPerSecond;
+    });
 }
 
-QString LibTreeHashPrivate::computeFileHash(QString path){
+QByteArray LibTreeHashPrivate::computeFileHash(const QString& path, const std::string& relPath, bool update,
+                                               const FileEntry* previous, FileEntry* stored){
+    constexpr qint64 MAX_CHUNK_SIZE = 1024 * 1024;
+
     QFile file(path);
-    if(!file.open(QFile::OpenModeFlag::ReadOnly | QFile::OpenModeFlag::ExistingOnly)){
+    StageTimer openTimer(this->stage(this->stats.open), this->tracer.get(), "open");
+    if(!file.open(QFile::OpenModeFlag::ReadOnly | QFile::OpenModeFlag::ExistingOnly | QFile::OpenModeFlag::Unbuffered)){
+        this->eventListener.callOnError(QStringLiteral("unable to read file (%1)").arg(file.errorString()), path);
+        return QByteArray();
+    }
+    openTimer.stop();
+
+    const QByteArray key = this->hmacKey.toUtf8();
+    std::unique_ptr<Hasher> hasher = Hasher::create(this->hashAlgorithm, key);
+
+    const QFileInfo fi(file);
+    const qint64 size = fi.size();
+    const qint64 lastModified = fi.lastModified().toMSecsSinceEpoch();
+
+    // block-hashes are only useful for files with more than one block
+    std::unique_ptr<BlockListHasher> blockHasher;
+    if(stored != nullptr && this->blockSize > 0 && size > this->blockSize)
+        blockHasher = std::make_unique<BlockListHasher>(this->hashAlgorithm, key, this->blockSize);
+
+    // the progress can only be recorded if the run is recorded in the journal
+    const bool recordProgress = update && hasher->isResumable() && this->unfinishedRun.exists && this->journal.isOpen();
+
+    // the position from which on the data is added to the hash (start) and to the block-hashes (blockStart)
+    qint64 start = 0, blockStart = 0;
+    if(recordProgress){
+        if(const auto progress = this->unfinishedRun.partial.find(relPath); progress != this->unfinishedRun.partial.end()){
+            // continue where the interrupted run stopped (if the file was not changed since)
+            const Journal::HashProgress& p = progress->second;
+            if(p.size == size && p.lastModified == lastModified && hasher->restoreState(p.state)){
+                if(!blockHasher || blockHasher->restoreState(p.blockState))
+                    start = blockStart = p.offset;
+                else
+                    hasher = Hasher::create(this->hashAlgorithm, key);
+            }
+        }
+    }
+    if(start == 0 && previous != nullptr && (!blockHasher || this->canContinueBlockHashes(*previous))
+            && onlyGrew(file, size, *previous) && hasher->restoreState(previous->hashState)){
+        // only the appended data has to be hashed
+        start = blockStart = previous->size;
+        if(blockHasher){
+            // the last block was probably incomplete -> it is hashed again
+            // (files with only one block have no block-hashes -> that one is hashed again too)
+            const qint64 completeBlocks = previous->blockHashes.isEmpty() ? 0 : previous->size / this->blockSize;
+            blockHasher->setCompletedBlocks(previous->blockHashes.left(completeBlocks * QCryptographicHash::hashLength(this->hashAlgorithm)));
+            blockStart = completeBlocks * this->blockSize;
+        }
+    }
+    // the chunks can only be found if the whole file is read
+    std::unique_ptr<ChunkIndexer> chunkIndexer;
+    if(stored != nullptr && this->chunkSize > 0 && size > this->chunkSize && blockStart == 0)
+        chunkIndexer = std::make_unique<ChunkIndexer>(this->hashAlgorithm, key, this->chunkSize);
+
+    if(start > 0)
+        this->stats.continuedFiles++;
+
+    if(!file.seek(blockStart)){
         this->eventListener.callOnError(QStringLiteral("unable to read file (%1)").arg(file.errorString()), path);
-        return QString();
+        return QByteArray();
     }
 
-    if(this->hmacKey.isEmpty()){
-        // normal hash
-        QCryptographicHash hash(this->hashAlgorithm);
-        if(!hash.addData(&file)){
-            this->eventListener.callOnError(QStringLiteral("unable to read file"), path);
-            return QString();
+    const qint64 chunkSize = std::clamp<qint64>(size, 4096, MAX_CHUNK_SIZE);
+    const std::unique_ptr<char[]> buffer = std::make_unique_for_overwrite<char[]>(chunkSize);
+    qint64 pos = blockStart;
+    while(true){
+        this->waitWhilePaused();
+        StageTimer readTimer(this->stage(this->stats.read), this->tracer.get(), "read chunk");
+        const qint64 n = file.read(buffer.get(), chunkSize);
+        readTimer.stop();
+        if(n < 0){
+            this->eventListener.callOnError(QStringLiteral("unable to read file (%1)").arg(file.errorString()), path);
+            return QByteArray();
         }
+        if(n == 0)
+            break;
+
+        StageTimer hashTimer(this->stage(this->stats.hash), this->tracer.get(), "hash chunk");
+        if(blockHasher)
+            blockHasher->addData(buffer.get(), static_cast<size_t>(n));
+        if(chunkIndexer)
+            chunkIndexer->addData(buffer.get(), static_cast<size_t>(n));
+        if(pos + n > start){
+            const qint64 skip = std::max<qint64>(0, start - pos);
+            hasher->addData(buffer.get() + skip, static_cast<size_t>(n - skip));
+        }
+        hashTimer.stop();
+        pos += n;
+        this->bytesSinceCheckpoint += n;
+        this->stats.readBytes += n;
+        this->progress.addBytes(n);
+        this->reportProgress();
+
+        if(update){
+            const bool stop = recordProgress && this->stopRequested;
+            if(stop || this->isCheckpointDue()){
+                if(recordProgress && pos >= start){
+                    this->saveHashProgress(relPath, Journal::HashProgress{pos, size, lastModified, hasher->saveState(),
+                                                                          blockHasher ? blockHasher->saveState() : QByteArray()});
+                }
+                this->checkpoint();
 
-        return QString(hash.result().toHex());
-    }else{
-        // use HMAC
-        QMessageAuthenticationCode hash(this->hashAlgorithm);
-        hash.setKey(this->hmacKey.toUtf8());
-        if(!hash.addData(&file)){
-            this->eventListener.callOnError(QStringLiteral("unable to read file"), path);
-            return QString();
+                if(stop){
+                    this->interrupted = true;
+                    return QByteArray();
+                }
+            }
+        }
+        if(this->failedFast || (!update && this->stopRequested)){
+            // the result is not needed anymore (a partial verify can not be continued)
+            this->interrupted = true;
+            return QByteArray();
+        }
+    }
+
+    // the file may have changed its size while it was hashed -> pos is the hashed size
+    // (always stored, so that VERIFY can fail files of another size without reading them)
+    if(stored != nullptr)
+        stored->size = pos;
+    if(stored != nullptr && this->hashStateMinSize >= 0 && hasher->isResumable()){
+        if(pos > 0 && pos >= this->hashStateMinSize){
+            const QByteArray fingerprint = tailFingerprint(file, pos);
+            if(!fingerprint.isNull()){
+                stored->hashState = hasher->saveState();
+                stored->tailFingerprint = fingerprint;
+            }
         }
+    }
+    if(blockHasher){
+        stored->blockSize = this->blockSize;
+        stored->blockHashes = blockHasher->result();
+    }
+    if(chunkIndexer){
+        stored->chunkSize = this->chunkSize;
+        stored->chunks = chunkIndexer->result();
+    }
+
+    return hasher->result();
+}
+
+bool LibTreeHashPrivate::hasBlockHashes(const EntryView& entry) const{
+    if(entry.blockSize <= 0 || entry.size <= 0)
+        return false;
+    const qint64 blockCount = (entry.size + entry.blockSize - 1) / entry.blockSize;
+    return entry.blockHashes.size() == blockCount * QCryptographicHash::hashLength(this->hashAlgorithm);
+}
+
+bool LibTreeHashPrivate::canContinueBlockHashes(const FileEntry& previous) const{
+    // small files have no block-hashes, their only block is hashed again
+    if(previous.size <= this->blockSize)
+        return true;
+
+    EntryView view;
+    view.size = previous.size;
+    view.blockSize = previous.blockSize;
+    view.blockHashes = previous.blockHashes;
+    return previous.blockSize == this->blockSize && this->hasBlockHashes(view);
+}
 
-        return QString(hash.result().toHex());
+std::vector<qint64> LibTreeHashPrivate::selectBlocks(const EntryView& entry) const{
+    const qint64 blockCount = (entry.size + entry.blockSize - 1) / entry.blockSize;
+    std::vector<qint64> blocks(static_cast<size_t>(blockCount));
+    std::iota(blocks.begin(), blocks.end(), 0);
+    if(this->sampleRate >= 1.0)
+        return blocks;
+
+    // the blocks only depend on seed and path (FNV-1a), so that a run can be reproduced
+    quint64 pathHash = 0xcbf29ce484222325;
+    for(const char c : entry.path)
+        pathHash = (pathHash ^ static_cast<unsigned char>(c)) * 0x100000001b3;
+    std::mt19937_64 rng(this->sampleSeed ^ pathHash);
+
+    // partial Fisher-Yates shuffle
+    const qint64 count = std::clamp<qint64>(static_cast<qint64>(std::ceil(this->sampleRate * blockCount)), 1, blockCount);
+    for(qint64 i = 0; i < count; i++){
+        const qint64 j = i + static_cast<qint64>(rng() % static_cast<quint64>(blockCount - i));
+        std::swap(blocks[i], blocks[j]);
     }
+    blocks.resize(static_cast<size_t>(count));
+    std::sort(blocks.begin(), blocks.end());// read forwards
+    return blocks;
 }
 
-json LibTreeHashPrivate::loadHashes(QFileDevice& hashFile, QString* error){
-    try {
-        std::string fileContent = hashFile.readAll().toStdString();
-        if(fileContent.empty()){
-            if(error != nullptr)
-                *error = QString();
-            return json::object();
-        }
-        json loaded = json::parse(fileContent);
+void LibTreeHashPrivate::verifyBlocks(const QString& path, const EntryView& entry, const std::vector<qint64>& blocks){
+    constexpr qint64 MAX_CHUNK_SIZE = 1024 * 1024;
 
-        if(!loaded.is_object()){
-            if(error != nullptr)
-                *error = "unable to load hash-file: file is malformed (expected JSON-Object)";
-            return json::object();
-        }
+    // planFiles() only passes files whose size matches the stored one
+    const qint64 size = entry.size;
+    this->sampleCoverage.totalBytes += size;
 
-        if(const auto& ver = loaded.find("version"); ver != loaded.end()){
-            if(ver->get<std::string>() != LibTreeHash::FILE_VERSION){
-                if(error != nullptr)
-                    *error = QStringLiteral("can not load version of hashfile");
-                return json::object();
+    StageTimer openTimer(this->stage(this->stats.open), this->tracer.get(), "open");
+    const int fd = open(QFile::encodeName(path).constData(), O_RDONLY | O_CLOEXEC);
+    openTimer.stop();
+    if(fd == -1){
+        this->eventListener.callOnError(QStringLiteral("unable to read file (%1)").arg(QString::fromLocal8Bit(strerror(errno))), path);
+        this->eventListener.callOnFileProcessed(path, false);
+        return;
+    }
+
+    const qint64 blockCount = (size + entry.blockSize - 1) / entry.blockSize;
+    const qsizetype digestLength = entry.blockHashes.size() / blockCount;
+    const QByteArray key = this->hmacKey.toUtf8();
+
+    // every thread takes the next unchecked block (they are big enough to be read sequentially)
+    std::vector<char> corrupt(static_cast<size_t>(blockCount), 0);
+    std::atomic<size_t> nextBlock(0), checkedBlocks(0);
+    std::atomic<int> readError(0);
+    const int threadCount = static_cast<int>(std::min<qint64>(static_cast<qint64>(blocks.size()), this->threadCount));
+    // every thread has its own stats (merged after they finished)
+    std::vector<RunStats> threadStats(static_cast<size_t>(std::max(threadCount, 1)));
+    // only the calling thread (index 0) reports the progress (the listener is not called from the other threads)
+    const auto worker = [&](size_t index){
+        RunStats& local = threadStats[index];
+        const qint64 chunkSize = std::min(entry.blockSize, MAX_CHUNK_SIZE);
+        const std::unique_ptr<char[]> buffer = std::make_unique_for_overwrite<char[]>(chunkSize);
+        for(size_t i = nextBlock++; i < blocks.size() && readError == 0 && !this->failedFast && !this->stopRequested; i = nextBlock++){
+            const qint64 block = blocks[i];
+            const qint64 blockEnd = std::min((block + 1) * entry.blockSize, size);
+            std::unique_ptr<Hasher> hasher = Hasher::create(this->hashAlgorithm, key);
+            for(qint64 pos = block * entry.blockSize; pos < blockEnd;){
+                this->waitWhilePaused();
+                StageTimer readTimer(this->stage(local.read), this->tracer.get(), "read chunk", index);
+                const ssize_t n = pread(fd, buffer.get(), static_cast<size_t>(std::min(chunkSize, blockEnd - pos)), pos);
+                readTimer.stop();
+                if(n < 0 && errno == EINTR)
+                    continue;
+                if(n <= 0){
+                    // n == 0 -> the file was truncated meanwhile
+                    readError = n < 0 ? errno : EIO;
+                    return;
+                }
+                if(this->failedFast || this->stopRequested)
+                    return;
+                StageTimer hashTimer(this->stage(local.hash), this->tracer.get(), "hash chunk", index);
+                hasher->addData(buffer.get(), static_cast<size_t>(n));
+                hashTimer.stop();
+                pos += n;
+                local.readBytes += n;
+                this->progress.addBytes(n);
+                if(index == 0)
+                    this->reportProgress();
             }
-        }else{
-            if(error != nullptr)
-                *error = QStringLiteral("can not load version of hashfile");
-            return json::object();
+
+            const QByteArray digest = hasher->result();
+            corrupt[block] = QByteArrayView(digest) != entry.blockHashes.sliced(block * digestLength, digestLength);
+            if(corrupt[block] && this->failFast)
+                this->failedFast = true;// cancels the other threads
+            checkedBlocks++;
         }
+    };
+
+    std::vector<std::thread> threads;
+    for(int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker, static_cast<size_t>(i));
+    worker(0);
+    for(std::thread& t : threads)
+        t.join();
+
+    for(const RunStats& local : threadStats){
+        this->stats.read.nanoseconds += local.read.nanoseconds;
+        this->stats.read.calls += local.read.calls;
+        this->stats.hash.nanoseconds += local.hash.nanoseconds;
+        this->stats.hash.calls += local.hash.calls;
+        this->stats.readBytes += local.readBytes;
+    }
 
-        if(error != nullptr)
-            *error = QString();
-        return loaded;
+    close(fd);
+
+    if(readError != 0){
+        this->eventListener.callOnError(QStringLiteral("unable to read file (%1)").arg(QString::fromLocal8Bit(strerror(readError))), path);
+        this->eventListener.callOnFileProcessed(path, false);
+        return;
+    }
+
+    if(checkedBlocks < blocks.size() && std::find(corrupt.begin(), corrupt.end(), 1) == corrupt.end()){
+        // cancelled (stop or failure of something else) -> this file was not checked completely
+        this->interrupted = true;
+        return;
+    }
+
+    for(const qint64 block : blocks)
+        this->sampleCoverage.checkedBytes += std::min((block + 1) * entry.blockSize, size) - block * entry.blockSize;
+    if(static_cast<qint64>(blocks.size()) < blockCount)
+        this->sampleCoverage.sampledFiles++;
+
+    // report consecutive corrupt blocks as one range
+    bool matches = true;
+    for(qint64 block = 0; block < blockCount;){
+        if(!corrupt[block]){
+            block++;
+            continue;
+        }
+
+        qint64 end = block + 1;
+        while(end < blockCount && corrupt[end])
+            end++;
+
+        const qint64 offset = block * entry.blockSize;
+        this->eventListener.callOnCorruptRange(path, offset, std::min(end * entry.blockSize, size) - offset);
+        matches = false;
+        block = end;
+    }
+    // a sample does not verify the whole file
+    if(matches && static_cast<qint64>(blocks.size()) == blockCount)
+        this->markVerified(std::string(entry.path));// invalidates entry
+    this->eventListener.callOnFileProcessed(path, matches);
+}
+
+bool LibTreeHashPrivate::readStatData(const QString& path, FileEntry& entry){
+    constexpr qint64 NS_PER_SECOND = 1000000000;
+
+    struct stat st;
+    if(stat(QFile::encodeName(path).constData(), &st) != 0)
+        return false;
+#ifdef __APPLE__
+    entry.mtimeNs = static_cast<qint64>(st.st_mtimespec.tv_sec) * NS_PER_SECOND + st.st_mtimespec.tv_nsec;
+    entry.ctimeNs = static_cast<qint64>(st.st_ctimespec.tv_sec) * NS_PER_SECOND + st.st_ctimespec.tv_nsec;
+#else
+    entry.mtimeNs = static_cast<qint64>(st.st_mtim.tv_sec) * NS_PER_SECOND + st.st_mtim.tv_nsec;
+    entry.ctimeNs = static_cast<qint64>(st.st_ctim.tv_sec) * NS_PER_SECOND + st.st_ctim.tv_nsec;
+#endif
+    entry.inode = static_cast<qint64>(st.st_ino);
+    return true;
+}
+
+bool LibTreeHashPrivate::onlyGrew(QFile& file, qint64 size, const FileEntry& previous){
+    if(previous.size <= 0 || size <= previous.size || previous.hashState.isEmpty() || previous.tailFingerprint.isEmpty())
+        return false;
+    return tailFingerprint(file, previous.size) == previous.tailFingerprint;
+}
+
+QByteArray LibTreeHashPrivate::tailFingerprint(QFile& file, qint64 end){
+    constexpr qint64 TAIL_SIZE = 64 * 1024;
+
+    const qint64 start = std::max<qint64>(0, end - TAIL_SIZE);
+    if(!file.seek(start))
+        return QByteArray();
+    const QByteArray tail = file.read(end - start);
+    if(tail.size() != end - start)
+        return QByteArray();
+
+    std::unique_ptr<Hasher> hasher = Hasher::create(QCryptographicHash::Algorithm::Sha256);
+    hasher->addData(tail.constData(), static_cast<size_t>(tail.size()));
+    return hasher->result();
+}
+
+void LibTreeHashPrivate::saveHashProgress(const std::string& relPath, Journal::HashProgress progress){
+    this->journal.hashProgress(relPath, progress);
+    this->unfinishedRun.partial[relPath] = std::move(progress);
+}
+
+void LibTreeHashPrivate::loadHashes(QFileDevice& hashFile, QString* error){
+    this->settings = json::object();
+    this->index = HashIndex();
+
+    if(BinaryHashFile::isBinary(hashFile)){
+        this->loadBinaryHashes(hashFile, error);
+    }else{
+        this->loadJsonHashes(hashFile, error);
+    }
+}
+
+void LibTreeHashPrivate::loadJsonHashes(QFileDevice& hashFile, QString* error){
+    json storedSettings;
+    std::shared_ptr<const HashTable> entries = JsonHashFile::load(hashFile, storedSettings, error);
+    if(!entries)
+        return;
+
+    this->settings = std::move(storedSettings);
+    this->index = HashIndex(std::move(entries));
+    if(!this->hashFileFormatSet)
+        this->hashFileFormat = HashFileFormat::JSON;
+}
+
+void LibTreeHashPrivate::loadBinaryHashes(QFileDevice& hashFile, QString* error){
+    QByteArray storedSettings;
+    std::shared_ptr<const HashTable> entries = BinaryHashFile::load(hashFile, storedSettings, error);
+    if(!entries)
+        return;
+
+    try {
+        this->settings = storedSettings.isEmpty() ? json() : json::parse(storedSettings.constBegin(), storedSettings.constEnd());
     } catch (std::exception& e) {
         if(error != nullptr)
-            *error = e.what();
-        return json::object();
+            *error = QStringLiteral("unable to load hash-file: settings are malformed (%1)").arg(e.what());
+        return;
     }
+
+    this->index = HashIndex(std::move(entries));
+    if(!this->hashFileFormatSet)
+        this->hashFileFormat = HashFileFormat::BINARY;
+
+    if(error != nullptr)
+        *error = QString();
+}
+
+bool LibTreeHashPrivate::reopenHashFile(QString* error){
+    const bool dstOpen = this->hashFileDst->isOpen();
+    this->hashFileSrc->close();
+    this->hashFileDst->close();
+    return ensureFileOpen(*this->hashFileSrc, false, error) && (!dstOpen || ensureFileOpen(*this->hashFileDst, true, error));
 }
 
 bool LibTreeHashPrivate::ensureFileOpen(QFileDevice& file, bool write, QString* error){
@@ -503,23 +2257,17 @@ void LibTreeHash::cleanHashFile(const QStringList& keep){
         return;
     }
 
-    const auto hashes = this->priv->hashFileData.find("files");
-    if(hashes == this->priv->hashFileData.end()){
-        this->priv->eventListener.callOnError("hash-file is malformed", "cleanHashFile");
-        return;
-    }
-
     // filter hashes
     QSet<QString> keepSet(keep.begin(), keep.end());
-    for(auto iter = hashes->begin(); iter != hashes->end();){
-        QString f = QString::fromStdString(iter.key());
+    std::vector<std::string> toErase;
+    this->priv->index.forEach([&keepSet, &rootDir, &toErase](const EntryView& entry) -> void{
+        QString f = QString::fromUtf8(entry.path.data(), entry.path.size());
         QString absPath = rootDir.absoluteFilePath(f);
-        if(!keepSet.contains(f) && !keepSet.contains(absPath)){
-            iter = hashes->erase(iter);
-        }else{
-            iter++;
-        }
-    }
+        if(!keepSet.contains(f) && !keepSet.contains(absPath))
+            toErase.emplace_back(entry.path);
+    });
+    for(const std::string& path : toErase)
+        this->priv->eraseEntry(path);
 
     if(this->autosave)
         saveHashFile();
@@ -541,25 +2289,168 @@ QStringList LibTreeHash::checkForRemovedFiles(const QStringList& files){
         return QStringList();
     }
 
-    const auto hashes = this->priv->hashFileData.find("files");
-    if(hashes == this->priv->hashFileData.end()){
-        this->priv->eventListener.callOnError("hash-file is malformed", "cleanHashFile");
-        return QStringList();
-    }
-
     // find all removed files
     QStringList removed;
-    for(auto iter = hashes->begin(); iter != hashes->end(); iter++){
-        QString file = QString::fromStdString(iter.key());
+    this->priv->index.forEach([&removed, &files, &rootDir](const EntryView& entry) -> void{
+        QString file = QString::fromUtf8(entry.path.data(), entry.path.size());
         QString absPath = rootDir.absoluteFilePath(file);
         if(!files.contains(absPath)){
             removed.append(file);
         }
+    });
+
+    return removed;
+}
+
+QStringList LibTreeHash::probeForRemovedFiles(){
+    if(!this->priv->hashFileSrc){
+        this->priv->eventListener.callOnError("no hashfile was loaded", "probeForRemovedFiles");
+        return QStringList();
+    }
+    if(this->priv->rootDir.isNull()){
+        this->priv->eventListener.callOnError("no root-dir was set", "probeForRemovedFiles");
+        return QStringList();
+    }
+
+    std::vector<std::string> paths;
+    paths.reserve(this->priv->index.size());
+    this->priv->index.forEach([&paths](const EntryView& entry) -> void{
+        paths.emplace_back(entry.path);
+    });
+
+    QString err;
+    const std::vector<int> status = LibTreeHashPrivate::probeFiles(this->priv->rootDir, paths, &err);
+    if(!err.isNull()){
+        this->priv->eventListener.callOnError(err, "probeForRemovedFiles");
+        return QStringList();
+    }
+
+    QStringList removed;
+    for(size_t i = 0; i < paths.size(); i++){
+        if(status[i] == ENOENT){
+            removed.append(QString::fromStdString(paths[i]));
+        }else if(status[i] != 0){
+            this->priv->eventListener.callOnWarning(QStringLiteral("unable to stat file (%1); treating it as existing")
+                                                        .arg(QString::fromLocal8Bit(strerror(status[i]))),
+                                                    QString::fromStdString(paths[i]));
+        }
     }
 
     return removed;
 }
 
+void LibTreeHash::cleanRemovedFiles(){
+    if(!this->priv->hashFileSrc){
+        this->priv->eventListener.callOnError("no hashfile was loaded", "cleanRemovedFiles");
+        return;
+    }
+
+    const QStringList removed = probeForRemovedFiles();
+    for(const QString& f : removed){
+        this->priv->eraseEntry(f.toStdString());
+    }
+
+    if(this->autosave)
+        saveHashFile();
+}
+
+RemovedFilesStrategy LibTreeHash::chooseRemovedFilesStrategy() const{
+    // a path-lookup costs more than reading a dir-entry -> only probe if the index is clearly smaller than the tree
+    constexpr qint64 PROBE_COST_FACTOR = 2;
+    // the sample-walk must stay cheap compared to the walk it should avoid
+    constexpr qint64 MAX_SAMPLE_ENTRIES = 100000;
+
+    if(this->priv->rootDir.isNull())
+        return RemovedFilesStrategy::WALK_TREE;
+
+    const qint64 probeLimit = this->priv->index.size() * PROBE_COST_FACTOR;
+    const QByteArray root = QFile::encodeName(this->priv->rootDir);
+
+    // the used inodes describe the tree only if it is the whole filesystem (some filesystems have no inode-table)
+    struct stat rootInfo, parentInfo;
+    struct statvfs fsInfo;
+    if(stat(root.constData(), &rootInfo) == 0 && stat((root + "/..").constData(), &parentInfo) == 0
+            && (rootInfo.st_dev != parentInfo.st_dev || rootInfo.st_ino == parentInfo.st_ino)
+            && statvfs(root.constData(), &fsInfo) == 0 && fsInfo.f_files != 0){
+        const qint64 treeSizeEstimate = static_cast<qint64>(fsInfo.f_files - fsInfo.f_ffree);
+        if(probeLimit < treeSizeEstimate)
+            return RemovedFilesStrategy::PROBE_INDEX;
+        return RemovedFilesStrategy::WALK_TREE;
+    }
+
+    // a sample could not show that the tree is clearly larger -> walking is always correct
+    if(probeLimit >= MAX_SAMPLE_ENTRIES)
+        return RemovedFilesStrategy::WALK_TREE;
+
+    // count the dir-entries below the root-dir only until the tree is known to be clearly larger than the index
+    QDirIterator iter(this->priv->rootDir, QDir::Filter::AllEntries | QDir::Filter::Hidden | QDir::Filter::System | QDir::Filter::NoDotAndDotDot,
+                      QDirIterator::IteratorFlag::Subdirectories);
+    qint64 entries = 0;
+    while(iter.hasNext()){
+        iter.next();
+        if(++entries > probeLimit)
+            return RemovedFilesStrategy::PROBE_INDEX;
+    }
+    return RemovedFilesStrategy::WALK_TREE;
+}
+
+std::vector<int> LibTreeHashPrivate::probeFiles(const QString& root, const std::vector<std::string>& relPaths, QString* error){
+    // stat-calls mostly wait for the disk, so use more threads than cores
+    constexpr size_t BATCH_SIZE = 256;
+    constexpr int MAX_THREADS = 64;
+
+    std::vector<int> status(relPaths.size(), 0);
+
+    const int rootFd = open(QFile::encodeName(root).constData(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+    if(rootFd == -1){
+        if(error != nullptr)
+            *error = QStringLiteral("unable to open root-dir (%1)").arg(QString::fromLocal8Bit(strerror(errno)));
+        return status;
+    }
+
+    std::atomic<size_t> nextBatch(0);
+    const auto worker = [&](){
+        for(size_t start = nextBatch.fetch_add(BATCH_SIZE); start < relPaths.size(); start = nextBatch.fetch_add(BATCH_SIZE)){
+            const size_t end = std::min(start + BATCH_SIZE, relPaths.size());
+            for(size_t i = start; i < end; i++){
+                mode_t mode;
+#if defined(__linux__) && defined(STATX_TYPE)
+                struct statx stx;
+                if(statx(rootFd, relPaths[i].c_str(), AT_STATX_DONT_SYNC, STATX_TYPE, &stx) != 0){
+                    status[i] = errno == ENOTDIR ? ENOENT : errno;
+                    continue;
+                }
+                mode = stx.stx_mode;
+#else
+                struct stat st;
+                if(fstatat(rootFd, relPaths[i].c_str(), &st, 0) != 0){
+                    status[i] = errno == ENOTDIR ? ENOENT : errno;
+                    continue;
+                }
+                mode = st.st_mode;
+#endif
+                // dirs or other special files are not valid entries (same as in listAllFilesInDir())
+                status[i] = S_ISREG(mode) ? 0 : ENOENT;
+            }
+        }
+    };
+
+    const size_t batchCount = (relPaths.size() + BATCH_SIZE - 1) / BATCH_SIZE;
+    const int threadCount = static_cast<int>(std::min<size_t>(batchCount, std::min(MAX_THREADS, QThread::idealThreadCount() * 4)));
+    std::vector<std::thread> threads;
+    for(int i = 1; i < threadCount; i++)
+        threads.emplace_back(worker);
+    worker();
+    for(std::thread& t : threads)
+        t.join();
+
+    close(rootFd);
+
+    if(error != nullptr)
+        *error = QString();
+    return status;
+}
+
 QStringList TreeHash::listAllFilesInDir(const QString root, bool includeLinkedDirs, bool includeLinkedFiles)
 {
     if(!QFileInfo(root).isDir()){
@@ -5,6 +5,11 @@
 #include <QStringList>
 #include <QCryptographicHash>
 #include <memory>
+#include <future>
+#include <chrono>
+#include <iterator>
+#include <span>
+#include <vector>
 
 class QFileDevice;
 
@@ -18,7 +23,174 @@ enum class RunMode{
     /// updates the hashes of new or recently modified files
     UPDATE_MODIFIED,
     /// checks all files against the stored hashes
-    VERIFY
+    VERIFY,
+    /**
+     * updates the hashes of new or modified files and removes the entries of files which are not on the file-list
+     * (UPDATE_MODIFIED, UPDATE_NEW and LibTreeHash::cleanHashFile() in one pass)
+     */
+    SYNC,
+    /**
+     * checks only the size, modification-time, status-change-time and inode of all files against the stored ones
+     * (no file is read); files whose metadata differs are suspect and can be verified completely
+     * (see LibTreeHash::setEscalateSuspects())
+     */
+    VERIFY_QUICK
+};
+
+enum class HashFileFormat{
+    /// JSON (version 2.0; see FileFormat.txt)
+    JSON,
+    /// compact binary format (version 3; see FileFormat.txt) which is memory-mapped on load
+    BINARY
+};
+
+enum class RemovedFilesStrategy{
+    /// compare the hash-file against a listing of the whole tree (see LibTreeHash::checkForRemovedFiles())
+    WALK_TREE,
+    /// stat only the paths stored in the hash-file (see LibTreeHash::probeForRemovedFiles())
+    PROBE_INDEX
+};
+
+/**
+ * @brief time spent in a stage of a run and how often it was entered (see RunStats)
+ */
+struct StageStats{
+    /// monotonic time in nanoseconds
+    qint64 nanoseconds = 0;
+    qint64 calls = 0;
+};
+
+/**
+ * @brief where the time of a run was spent (see LibTreeHash::setCollectStats())
+ */
+struct RunStats{
+    /// loading the hash-file and replaying the journal (done when the hash-file is set, before the run)
+    StageStats load;
+    /// deciding what to do with the files by their metadata (calls = stat-ed files)
+    StageStats plan;
+    /// opening the files (calls = open syscalls)
+    StageStats open;
+    /// reading the files (calls = read syscalls)
+    StageStats read;
+    /// hashing the read data (including block-hashes and chunks)
+    StageStats hash;
+    /// saving the hash-file or the journal (also at checkpoints)
+    StageStats save;
+    /// the whole run (without load)
+    StageStats total;
+
+    /// count of the processed files
+    qint64 files = 0;
+    /// count of the files which were read
+    qint64 readFiles = 0;
+    /// count of the files which were not read as their entry is up to date (or their metadata matched in VERIFY_QUICK)
+    qint64 skippedFiles = 0;
+    /// count of the files of which only a part was read, as the hashing continued from a saved state
+    ///     (appended data or resumed run)
+    qint64 continuedFiles = 0;
+    /// bytes read from the files
+    qint64 readBytes = 0;
+};
+
+/**
+ * @brief how long reading a file took (see LibTreeHash::setSlowFileReport())
+ */
+struct FileTiming{
+    QString path;
+    /// the mount-point of the device of the file
+    QString device;
+    /// bytes read from the file
+    qint64 bytes = 0;
+    /// time spent on the file
+    std::chrono::microseconds duration{0};
+    double bytesPerSecond = 0;
+};
+
+/**
+ * @brief the throughput of a device (see Progress)
+ */
+struct DeviceProgress{
+    /// the mount-point of the device
+    QString device;
+    /// bytes read from the device
+    qint64 readBytes = 0;
+    /// moving average of the throughput
+    double bytesPerSecond = 0;
+};
+
+/**
+ * @brief the progress of a run (see LibTreeHash::getProgress())
+ */
+struct Progress{
+    /// count of all files of the run
+    qint64 totalFiles = 0;
+    /// count of the processed files (also the ones which were not read)
+    qint64 processedFiles = 0;
+    /// size of the files which are read (see RunPlan::hashBytes)
+    qint64 totalBytes = 0;
+    /// the part of totalBytes which was processed (including the read part of the current file)
+    qint64 processedBytes = 0;
+    /// moving average of the throughput
+    double bytesPerSecond = 0;
+    /// estimated seconds until all files are processed (-1 if unknown)
+    qint64 etaSeconds = -1;
+    /// the devices from which files were read
+    std::vector<DeviceProgress> devices;
+};
+
+/**
+ * @brief the kinds of events (bits of EventSink::wantedEvents())
+ */
+enum class EventType : unsigned{
+    /// see EventListener::onFileProcessed
+    FILE_PROCESSED = 1,
+    /// see EventListener::onWarning
+    WARNING = 2,
+    /// see EventListener::onError
+    ERROR = 4,
+    /// see EventListener::onCorruptRange
+    CORRUPT_RANGE = 8,
+    /// see EventListener::onChunkChanges
+    CHUNK_CHANGES = 16
+};
+
+/**
+ * @brief an event delivered to an EventSink
+ */
+struct Event{
+    EventType type;
+    /// the path of the file (or the location of a warning or an error)
+    QString path;
+    /// WARNING and ERROR: the message
+    QString msg;
+    /// FILE_PROCESSED: if the file was processed successfully
+    bool success = false;
+    /// CORRUPT_RANGE: offset, length; CHUNK_CHANGES: changedChunks, chunkCount, changedBytes
+    qint64 values[3] = {0, 0, 0};
+};
+
+/**
+ * @brief receives the events in batches instead of one call per event (see LibTreeHash::setEventSink())
+ */
+class EventSink{
+public:
+    static constexpr unsigned ALL_EVENTS = 0x1F;
+
+    virtual ~EventSink() = default;
+
+    /**
+     * @brief the events which are delivered (EventTypes or-ed together); the other ones are not even created
+     */
+    virtual unsigned wantedEvents() const{
+        return ALL_EVENTS;
+    }
+
+    /**
+     * @brief called with the collected events in the order in which they occurred
+     *      (on the thread which runs LibTreeHash::run());
+     *      ATTENTION: this method should not throw an exception
+     */
+    virtual void onEvents(std::span<const Event> events) = 0;
 };
 
 class EventListener{
@@ -51,24 +223,281 @@ public:
      * @param path location of error (mostly a file path)
      */
     std::function<void(QString msg, QString path)> onError;
+    /**
+     * @brief called for every range of a file which did not match its block-hashes (only in VERIFY mode);
+     *      consecutive corrupt blocks are reported as one range
+     *      ATTENTION: this method should not throw an exception
+     * @param path path of the file
+     * @param offset offset of the first corrupt byte
+     * @param length length of the range
+     */
+    std::function<void(QString path, qint64 offset, qint64 length)> onCorruptRange;
+    /**
+     * @brief called in UPDATE_MODIFIED after a file with a stored chunk-list was hashed (see LibTreeHash::setChunkSize())
+     *      ATTENTION: this method should not throw an exception
+     * @param path path of the file
+     * @param changedChunks count of chunks which did not exist in the previous version
+     * @param chunkCount count of all chunks of the file
+     * @param changedBytes size of the changed chunks
+     */
+    std::function<void(QString path, qint64 changedChunks, qint64 chunkCount, qint64 changedBytes)> onChunkChanges;
+    /**
+     * @brief called during a run at most once per progress-interval (see LibTreeHash::setProgressInterval()),
+     *      also while a big file is read, and at the begin and the end of the run
+     *      ATTENTION: this method should not throw an exception
+     * @param progress the current progress
+     */
+    std::function<void(const Progress& progress)> onProgress;
 
 private:
 
-    void callOnFileProcessed(QString path, bool success){
+    /// called on every error and unsuccessful file (used by LibTreeHash for fail-fast)
+    std::function<void()> onFailure;
+    /// called for every processed file (used by LibTreeHash for the ResultStream)
+    std::function<void(const QString&, bool)> onProcessed;
+
+    /// receives the events which it wants (see LibTreeHash::setEventSink())
+    std::shared_ptr<EventSink> sink;
+    unsigned sinkEvents = 0;
+    /// the events are delivered when this many were collected (only > 1 during a run)
+    size_t batchSize = 1;
+    std::vector<Event> batch;
+
+    bool wants(EventType type) const{
+        return sinkEvents & static_cast<unsigned>(type);
+    }
+    void addEvent(Event&& event){
+        batch.push_back(std::move(event));
+        if(batch.size() >= batchSize)
+            flushEvents();
+    }
+    void flushEvents(){
+        if(batch.empty())
+            return;
+        sink->onEvents(batch);
+        batch.clear();
+    }
+
+    void callOnFileProcessed(const QString& path, bool success){
         if(onFileProcessed)
             onFileProcessed(path, success);
+        if(onProcessed)
+            onProcessed(path, success);
+        if(wants(EventType::FILE_PROCESSED))
+            addEvent(Event{EventType::FILE_PROCESSED, path, QString(), success});
+        if(!success && onFailure)
+            onFailure();
     }
-    void callOnWarning(QString msg, QString path){
+    void callOnWarning(const QString& msg, const QString& path){
         if(onWarning)
             onWarning(msg, path);
+        if(wants(EventType::WARNING))
+            addEvent(Event{EventType::WARNING, path, msg});
     }
-    void callOnError(QString msg, QString path){
+    void callOnError(const QString& msg, const QString& path){
         if(onError)
             onError(msg, path);
+        if(wants(EventType::ERROR))
+            addEvent(Event{EventType::ERROR, path, msg});
+        if(onFailure)
+            onFailure();
+    }
+    void callOnCorruptRange(const QString& path, qint64 offset, qint64 length){
+        if(onCorruptRange)
+            onCorruptRange(path, offset, length);
+        if(wants(EventType::CORRUPT_RANGE))
+            addEvent(Event{EventType::CORRUPT_RANGE, path, QString(), false, {offset, length, 0}});
+    }
+    void callOnProgress(const Progress& progress){
+        if(onProgress)
+            onProgress(progress);
+    }
+    void callOnChunkChanges(const QString& path, qint64 changedChunks, qint64 chunkCount, qint64 changedBytes){
+        if(onChunkChanges)
+            onChunkChanges(path, changedChunks, chunkCount, changedBytes);
+        if(wants(EventType::CHUNK_CHANGES))
+            addEvent(Event{EventType::CHUNK_CHANGES, path, QString(), false, {changedChunks, chunkCount, changedBytes}});
     }
 
 };
 
+/**
+ * @brief how much data the last VERIFY checked (see LibTreeHash::setSampleRate())
+ */
+struct SampleCoverage{
+    /// size of all verified files
+    qint64 totalBytes = 0;
+    /// size of the checked data
+    qint64 checkedBytes = 0;
+    /// count of files of which only some blocks were checked
+    qint64 sampledFiles = 0;
+};
+
+/**
+ * @brief what a run would do, determined only from the metadata of the files and the hash-file (see LibTreeHash::dryRun())
+ */
+struct RunPlan{
+    /// count of the files which would be read
+    qint64 hashFiles = 0;
+    /// size of the files which would be read (at most; files which only grew and sampled files are read only partially)
+    qint64 hashBytes = 0;
+    /// count of the files which would not be read as their entry is up to date (or the resumed run processed them;
+    ///     VERIFY_QUICK: the files whose metadata matches)
+    qint64 skippedFiles = 0;
+    /// size of the skipped files
+    qint64 skippedBytes = 0;
+    /// VERIFY: count of the files which fail without being read as their size differs from the stored one
+    qint64 sizeMismatches = 0;
+    /// VERIFY and UPDATE_MODIFIED: count of the files which have no entry
+    qint64 missingEntries = 0;
+    /// count of the items which are not a file or have a malformed entry
+    qint64 invalidFiles = 0;
+    /// VERIFY_QUICK: count of the files whose metadata (besides the size) differs from the stored one (if not escalated)
+    qint64 suspectFiles = 0;
+};
+
+class LibTreeHash;
+/**
+ * @brief controls a run started by LibTreeHash::runAsync(); all methods are thread-safe.
+ *      The LibTreeHash must not be moved or destroyed while the run is active.
+ */
+class RunHandle{
+
+    friend class LibTreeHash;
+
+public:
+    RunHandle() = default;
+    RunHandle(RunHandle&& mve) = default;
+    RunHandle& operator=(RunHandle&& mve) = default;
+    /**
+     * @brief waits until the run finished
+     */
+    ~RunHandle();
+
+    /**
+     * @brief stops the run after the file which is currently processed (see LibTreeHash::requestStop());
+     *      a paused run is resumed to stop
+     */
+    void cancel();
+
+    /**
+     * @brief see LibTreeHash::pause()
+     */
+    void pause();
+
+    /**
+     * @brief see LibTreeHash::resume()
+     */
+    void resume();
+
+    bool isPaused() const;
+
+    /**
+     * @brief returns true if the run finished (or the handle has no run)
+     */
+    bool isFinished() const;
+
+    /**
+     * @brief waits until the run finished; rethrows the exception thrown by LibTreeHash::run() (only once)
+     */
+    void wait();
+
+    /**
+     * @brief waits until the run finished or the timeout elapsed
+     * @return true if the run finished
+     */
+    bool waitFor(std::chrono::milliseconds timeout);
+
+private:
+    LibTreeHash* treeHash = nullptr;
+    std::future<void> result;
+};
+
+/**
+ * @brief the result of a processed file (see LibTreeHash::results())
+ */
+struct FileResult{
+    QString path;
+    /// UPDATE: if no error occurred; VERIFY: if the hash matched (like EventListener::onFileProcessed)
+    bool success = false;
+    /// the computed hash (empty if the file was not read completely, e.g. if it was skipped or verified by its block-hashes)
+    QByteArray digest;
+    /// count of the bytes read from the file
+    qint64 bytes = 0;
+    /// time spent on the file (without the time the run was paused before it)
+    std::chrono::microseconds duration{0};
+};
+
+class ResultQueue;
+/**
+ * @brief the results of a run started by LibTreeHash::results(), to be consumed at the own pace
+ *      (e.g. <code>for(const FileResult& r : treeHash.results())</code>); the run waits while the buffer is full.
+ *      The results can be iterated only once.
+ */
+class ResultStream{
+
+    friend class LibTreeHash;
+
+public:
+    class Iterator{
+
+        friend class ResultStream;
+
+    public:
+        using iterator_category = std::input_iterator_tag;
+        using value_type = FileResult;
+        using difference_type = std::ptrdiff_t;
+
+        const FileResult& operator*() const{
+            return this->current;
+        }
+        const FileResult* operator->() const{
+            return &this->current;
+        }
+        /**
+         * @brief waits for the next result; rethrows the exception thrown by LibTreeHash::run() after the last result
+         */
+        Iterator& operator++();
+        void operator++(int){
+            ++*this;
+        }
+        bool operator==(std::default_sentinel_t) const{
+            return this->done;
+        }
+
+    private:
+        ResultQueue* queue = nullptr;
+        FileResult current;
+        bool done = true;
+    };
+
+    ResultStream() = default;
+    ResultStream(ResultStream&& mve) = default;
+    ResultStream& operator=(ResultStream&& mve) = default;
+    /**
+     * @brief if not all results were consumed the run stops after the file which is currently processed;
+     *      waits until the run finished
+     */
+    ~ResultStream();
+
+    Iterator begin();
+    std::default_sentinel_t end() const{
+        return std::default_sentinel;
+    }
+
+    /**
+     * @brief the handle to cancel or pause the run
+     */
+    RunHandle& handle(){
+        return this->run;
+    }
+
+private:
+    std::shared_ptr<ResultQueue> queue;
+    // destroyed first -> waits for the run after the queue was closed
+    RunHandle run;
+};
+
 class LibTreeHashPrivate;
 /**
  * @brief The LibTreeHash class provides the core functionality of the project,
@@ -97,8 +526,35 @@ public:
 
     static std::string FILE_VERSION;
 
-    void run();
+    /**
+     * @brief processes the files according to the mode
+     * @return what was processed and where the time was spent (the stages are only measured if enabled by setCollectStats())
+     */
+    RunStats run();
 
+    /**
+     * @brief starts run() in a new thread
+     * @return a handle to cancel, pause or wait for the run
+     */
+    RunHandle runAsync();
+
+    /**
+     * @brief starts run() in the background (like runAsync()) and returns the results of the files as they are processed;
+     *      the EventListener is still called
+     * @param bufferSize count of results which are buffered before the run waits for the consumer
+     */
+    ResultStream results(size_t bufferSize = 64);
+
+    /**
+     * @brief classifies the files like run() would, but only by their metadata and their entries (no file is read
+     *      and nothing is changed); the verify-budget is not considered
+     * @return the count and size of the files which would be read, skipped or fail
+     */
+    RunPlan dryRun() const;
+
+    /**
+     * @brief saves the hash-file (or, if the journal is enabled, syncs the journal)
+     */
     void saveHashFile();
 
     /**
@@ -149,7 +605,319 @@ public:
     QCryptographicHash::Algorithm getHashAlgorithm() const;
 
     /**
-     * @brief sets the path of the file containing the hashes (will be used as source and destination)
+     * @brief sets the format in which the hash-file will be saved
+     *      (by default the format of the loaded file is kept; new files are written as JSON)
+     *      ATTENTION: do not change the format while a process is running
+     * @param format the format to use
+     */
+    void setHashFileFormat(HashFileFormat format);
+
+    /**
+     * @brief returns the format in which the hash-file will be saved
+     */
+    HashFileFormat getHashFileFormat() const;
+
+    /**
+     * @brief if set to true JSON hash-files are written without indentation and line-breaks (default is false)
+     */
+    void setCompactHashFile(bool compact);
+
+    /**
+     * @brief returns true if JSON hash-files are written without indentation and line-breaks
+     */
+    bool isCompactHashFile() const;
+
+    /**
+     * @brief if enabled changes are appended to a journal next to the hash-file (<hash-file>.journal)
+     *      instead of rewriting the whole file on every save; they are synced in groups while processing
+     *      and the journal is folded into the hash-file in the background when it grows too big.
+     *      Only available if the hash-file was set by setHashesFilePath().
+     *      An existing journal is always applied on load; saving with the journal disabled removes it.
+     */
+    void setJournalEnabled(bool enabled);
+
+    /**
+     * @brief returns true if changes are appended to the journal
+     */
+    bool isJournalEnabled() const;
+
+    /**
+     * @brief folds the journal into the hash-file (blocks until it is done)
+     */
+    void compactJournal();
+
+    /**
+     * @brief while an update is running a checkpoint (see saveHashFile()) is made when the given time passed
+     *      or the given amount of data was hashed since the last one (0 disables a limit; both are disabled by default).
+     *      Without the journal every checkpoint rewrites the whole hash-file.
+     * @param seconds max time between checkpoints
+     * @param bytes max size of the files hashed between checkpoints
+     */
+    void setCheckpointInterval(qint64 seconds, qint64 bytes);
+
+    /**
+     * @brief if set to true an update continues the last run if that was interrupted (see requestStop()):
+     *      files which were already processed by it and which were not modified since are skipped.
+     *      The progress of runs is recorded in the journal, so this needs the journal to be enabled.
+     */
+    void setResume(bool resume);
+
+    /**
+     * @brief returns true if an interrupted run will be continued
+     */
+    bool isResume() const;
+
+    /**
+     * @brief entries of files with at least the given size keep the state of the hash-function
+     *      and a fingerprint of the last hashed bytes, so that UPDATE_MODIFIED only hashes the appended data
+     *      of files which only grew since (e.g. logs); -1 disables it (default).
+     *      Only supported by the SHA-2, SHA-3, Keccak and Blake2b algorithms; the state adds up to ~0.5 KiB per entry.
+     *      ATTENTION: changes of the file before its old end are only detected if they are in the last 64 KiB
+     * @param bytes the min size of a file to keep its hash-state
+     */
+    void setHashStateMinSize(qint64 bytes);
+
+    /**
+     * @brief returns the min size of files which keep their hash-state (-1 if disabled)
+     */
+    qint64 getHashStateMinSize() const;
+
+    /**
+     * @brief sets the size of the blocks for which UPDATE stores separate hashes (besides the hash of the whole file);
+     *      files with more than one block are then verified in parallel (see setThreadCount())
+     *      and VERIFY reports the corrupt ranges of them (see EventListener::onCorruptRange);
+     *      0 disables it (default), the max is 1 GiB.
+     *      The block-hashes take blockCount * hash-length bytes per entry.
+     * @param bytes the size of the blocks
+     */
+    void setBlockSize(qint64 bytes);
+
+    /**
+     * @brief returns the size of the blocks for the block-hashes (0 if disabled)
+     */
+    qint64 getBlockSize() const;
+
+    /**
+     * @brief sets the targeted average size of the content-defined chunks for which UPDATE stores a list
+     *      (length and digest of each; for files bigger than one chunk);
+     *      UPDATE_MODIFIED then reports which part of a modified file changed (see EventListener::onChunkChanges).
+     *      The whole file is still hashed. 0 disables it (default), otherwise it is clamped to 4 KiB - 64 MiB.
+     *      The list takes about 20 bytes per chunk.
+     * @param bytes the average chunk-size
+     */
+    void setChunkSize(qint64 bytes);
+
+    /**
+     * @brief returns the average size of the content-defined chunks (0 if disabled)
+     */
+    qint64 getChunkSize() const;
+
+    /**
+     * @brief sets the count of threads which verify the blocks of a file with block-hashes (default 1)
+     * @param threads the thread count
+     */
+    void setThreadCount(int threads);
+
+    /**
+     * @brief returns the count of threads which verify the blocks of a file
+     */
+    int getThreadCount() const;
+
+    /**
+     * @brief sets a sink which receives the events (besides the EventListener) in batches:
+     *      during run() they are collected and delivered when batchSize events were collected and at the end of the run,
+     *      otherwise at once; events which the sink does not want are not created
+     * @param sink the sink (nullptr to remove it)
+     * @param batchSize max count of events per batch
+     */
+    void setEventSink(std::shared_ptr<EventSink> sink, size_t batchSize = 256);
+
+    /**
+     * @brief sets the min interval between two calls of EventListener::onProgress (default 1000 ms);
+     *      the throughput is averaged over these intervals
+     * @param milliseconds the interval
+     */
+    void setProgressInterval(qint64 milliseconds);
+
+    /**
+     * @brief returns the min interval between two calls of EventListener::onProgress
+     */
+    qint64 getProgressInterval() const;
+
+    /**
+     * @brief returns the progress of the current (or last) run; can be called from any thread
+     */
+    Progress getProgress() const;
+
+    /**
+     * @brief enables measuring the time and counting the syscalls of the stages of run() (disabled by default);
+     *      the time of loading the hash-file is always measured
+     * @param collect if the stats should be collected
+     */
+    void setCollectStats(bool collect);
+
+    /**
+     * @brief returns if the stats of the stages are collected
+     */
+    bool isCollectStats() const;
+
+    /**
+     * @brief returns the stats of the last run (see run())
+     */
+    RunStats getRunStats() const;
+
+    /**
+     * @brief records spans of run() (plan, file, open, read chunk, hash chunk, index update, save) per thread
+     *      and writes them as Chrome trace-event JSON (loadable in Perfetto) at the end of every run;
+     *      every thread keeps only its newest spans in a ring-buffer (which takes about 24 bytes per span)
+     * @param path the file to write (an empty string disables the tracing)
+     * @param spansPerThread capacity of the ring-buffers
+     */
+    void setTraceFile(const QString& path, size_t spansPerThread = 65536);
+
+    /**
+     * @brief returns the file to which the trace is written (empty if disabled)
+     */
+    QString getTraceFile() const;
+
+    /**
+     * @brief measures how long every read file takes; after a run the slowest ones can be queried (see getSlowestFiles())
+     *      and files of at least 1 MiB whose throughput is far below the median of their device are reported as warning
+     *      and can be queried (see getStragglers()); this points at failing disks, fragmented files or throttled volumes
+     * @param count count of the slowest files which are kept (0 disables the measuring; default)
+     * @param stragglerRatio a file is a straggler if its throughput is below this fraction of the median of its device
+     */
+    void setSlowFileReport(int count, double stragglerRatio = 0.1);
+
+    /**
+     * @brief returns the slowest files of the last run (slowest first)
+     */
+    std::vector<FileTiming> getSlowestFiles() const;
+
+    /**
+     * @brief returns the files of the last run whose throughput was far below the median of their device (slowest first)
+     */
+    std::vector<FileTiming> getStragglers() const;
+
+    /**
+     * @brief sets the fraction of the blocks which VERIFY checks in files with block-hashes (see setBlockSize());
+     *      the blocks are chosen at random per file (at least one), files without block-hashes are checked completely.
+     *      A corrupt block is found by one run with the probability of the rate,
+     *      so it is missed by n runs with different seeds with (1 - rate)^n.
+     * @param rate the fraction to check (0 - 1; 1 checks everything, the default)
+     * @param seed the seed for choosing the blocks (by default a random one is chosen per instance);
+     *      a run with the same seed and rate checks the same blocks
+     */
+    void setSampleRate(double rate, quint64 seed);
+
+    /**
+     * @brief returns the fraction of the blocks which VERIFY checks
+     */
+    double getSampleRate() const;
+
+    /**
+     * @brief returns the seed for choosing the checked blocks
+     */
+    quint64 getSampleSeed() const;
+
+    /**
+     * @brief returns how much data the last VERIFY checked
+     */
+    SampleCoverage getSampleCoverage() const;
+
+    /**
+     * @brief if set to true VERIFY_QUICK verifies the suspect files (the ones whose metadata differs, but not their size)
+     *      by hashing them (like VERIFY); otherwise they fail
+     * @param escalate true to hash the suspect files
+     */
+    void setEscalateSuspects(bool escalate);
+
+    /**
+     * @brief returns true if VERIFY_QUICK hashes the suspect files
+     */
+    bool isEscalateSuspects() const;
+
+    /**
+     * @brief if set to true VERIFY stores the time at which a file was found intact (lastVerified) in its entry;
+     *      with the journal enabled only these changes are appended to it, otherwise the hash-file is rewritten after the run
+     * @param record true to record the verification
+     */
+    void setRecordVerified(bool record);
+
+    /**
+     * @brief returns true if VERIFY stores the time of the verification
+     */
+    bool isRecordVerified() const;
+
+    /**
+     * @brief limits VERIFY to the given time and / or amount of data; with a limit the files whose lastVerified is the oldest
+     *      (or which were never verified) are processed first, so that together with setRecordVerified()
+     *      consecutive runs continue where the last one stopped and cycle through the whole tree
+     *      (the last file is always completed, so the budget may be exceeded by it)
+     * @param seconds max duration of the run (0 = unlimited)
+     * @param bytes max size of the verified files (0 = unlimited)
+     */
+    void setVerifyBudget(qint64 seconds, qint64 bytes);
+
+    /**
+     * @brief returns true if the last VERIFY stopped because its budget was used up before all files were verified
+     */
+    bool wasBudgetExhausted() const;
+
+    /**
+     * @brief stops the current run() after the file which is currently processed (the results are saved as usual;
+     *      VERIFY abandons the file which is being verified); if no run is active the next one stops immediately.
+     *      This method is thread-safe and async-signal-safe.
+     */
+    void requestStop();
+
+    /**
+     * @brief pauses the current run() until resume() is called: no more data is read (also not by the threads of a
+     *      block-verify), while all progress stays in memory; if no run is active the next one starts paused.
+     *      A paused run can still be stopped by requestStop().
+     *      This method is thread-safe.
+     */
+    void pause();
+
+    /**
+     * @brief continues a paused run
+     *      This method is thread-safe.
+     */
+    void resume();
+
+    /**
+     * @brief returns true if the run is paused
+     */
+    bool isPaused() const;
+
+    /**
+     * @brief returns true if the last run() was stopped by requestStop() before all files were processed
+     *      (or by the first failure, see setFailFast())
+     */
+    bool wasInterrupted() const;
+
+    /**
+     * @brief if set to true run() stops at the first error or unsuccessful file (e.g. a mismatch in VERIFY):
+     *      the remaining files are not processed and the file which is being hashed is abandoned
+     *      (the blocks of a file with block-hashes are abandoned as soon as one of them is corrupt);
+     *      the results of the processed files are saved as usual
+     * @param failFast true to stop at the first failure
+     */
+    void setFailFast(bool failFast);
+
+    /**
+     * @brief returns true if run() stops at the first failure
+     */
+    bool isFailFast() const;
+
+    /**
+     * @brief returns true if the last run() was stopped by a failure (see setFailFast())
+     */
+    bool wasStoppedOnFailure() const;
+
+    /**
+     * @brief sets the path of the file containing the hashes (will be used as source and destination;
+     *      the file is replaced atomically on save)
      *      ATTENTION: do not change the path while a process is running
      */
     void setHashesFilePath(const QString path);
@@ -171,6 +939,11 @@ public:
      */
     const QFileDevice& getHashesFileDst() const;
 
+    /**
+     * @brief returns the count of the entries of the hash-file (including the changes which were not saved yet)
+     */
+    qint64 getEntryCount() const;
+
     /**
      * @brief sets all files to process
      *      ATTENTION: do not change the value while a process is running
@@ -195,6 +968,29 @@ public:
      * @return a list with all paths (relative to rootPath) which did not occur in the hash-file
      */
     QStringList checkForRemovedFiles(const QStringList& files);
+
+    /**
+     * @brief finds all files of the hash-file which does not exist any-more by probing only the stored paths
+     *      (the paths are stat'ed in parallel batches, the tree itself is not walked; symlinks are followed
+     *      like by listAllFilesInDir() with includeLinkedDirs and includeLinkedFiles)
+     * @return a list with all paths (relative to rootPath) which did not exist
+     */
+    QStringList probeForRemovedFiles();
+
+    /**
+     * @brief removes all entries from the hash-file whose files does not exist any-more (see probeForRemovedFiles())
+     */
+    void cleanRemovedFiles();
+
+    /**
+     * @brief estimates which strategy for finding removed files is cheaper
+     *      by comparing the count of entries in the hash-file with the size of the tree
+     *      (if the root-dir is a mount-point the used inodes of its filesystem are taken,
+     *      otherwise the tree is walked until it is known to be clearly larger than the index;
+     *      for big indexes this walk would cost too much, so the tree is assumed to be not larger)
+     * @return PROBE_INDEX if the index is small compared to the tree, WALK_TREE otherwise
+     */
+    RemovedFilesStrategy chooseRemovedFilesStrategy() const;
 };
 
 /**
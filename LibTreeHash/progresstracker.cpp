@@ -0,0 +1,109 @@
+#include "progresstracker.h"
+#include <QFile>
+#include <QStorageInfo>
+#include <algorithm>
+#include <cmath>
+#include <sys/stat.h>
+
+using namespace TreeHash;
+
+void ProgressTracker::start(qint64 totalFiles, qint64 totalBytes){
+    std::lock_guard lock(this->mtx);
+    this->totalFiles = totalFiles;
+    this->totalBytes = totalBytes;
+    this->processedFiles = 0;
+    this->completedBytes = 0;
+    this->bytesPerSecond = 0;
+    this->sampledBytes = 0;
+    this->sampled = false;
+    this->lastSample = std::chrono::steady_clock::now();
+    this->devices.clear();
+    this->currentDevice = nullptr;
+    this->currentPlannedBytes = 0;
+    this->fileBytes = 0;
+}
+
+void ProgressTracker::startFile(const QString& path, qint64 plannedBytes){
+    struct stat st;
+    const quint64 deviceId = stat(QFile::encodeName(path).constData(), &st) == 0 ? static_cast<quint64>(st.st_dev) : 0;
+
+    std::lock_guard lock(this->mtx);
+    auto device = this->devices.find(deviceId);
+    if(device == this->devices.end()){
+        // the mount-point is only looked up once per device
+        device = this->devices.emplace(deviceId, Device()).first;
+        device->second.name = QStorageInfo(path).rootPath();
+    }
+    this->currentDevice = &device->second;
+    this->currentPlannedBytes = plannedBytes;
+    this->fileBytes = 0;
+}
+
+void ProgressTracker::finishFile(){
+    std::lock_guard lock(this->mtx);
+    if(this->currentDevice != nullptr){
+        this->currentDevice->bytes += this->fileBytes;
+        this->completedBytes += this->currentPlannedBytes;
+        this->currentDevice = nullptr;
+        this->currentPlannedBytes = 0;
+    }
+    this->fileBytes = 0;
+    this->processedFiles++;
+}
+
+QString ProgressTracker::currentDeviceName() const{
+    std::lock_guard lock(this->mtx);
+    return this->currentDevice != nullptr ? this->currentDevice->name : QString();
+}
+
+bool ProgressTracker::update(std::chrono::milliseconds interval, bool force){
+    // lastSample is only written by this method (which is called by the thread which processes the files)
+    const auto now = std::chrono::steady_clock::now();
+    if(!force && now - this->lastSample < interval)
+        return false;
+
+    std::lock_guard lock(this->mtx);
+    const double seconds = std::chrono::duration<double>(now - this->lastSample).count();
+    if(seconds <= 0)
+        return true;
+
+    const auto average = [seconds](qint64 bytes, qint64& sampledBytes, double& bytesPerSecond, bool& sampled) -> void{
+        const double rate = (bytes - sampledBytes) / seconds;
+        bytesPerSecond = sampled ? SMOOTHING * rate + (1 - SMOOTHING) * bytesPerSecond : rate;
+        sampledBytes = bytes;
+        sampled = true;
+    };
+
+    qint64 total = 0;
+    for(auto& [id, device] : this->devices){
+        const qint64 bytes = this->readBytes(device);
+        average(bytes, device.sampledBytes, device.bytesPerSecond, device.sampled);
+        total += bytes;
+    }
+    average(total, this->sampledBytes, this->bytesPerSecond, this->sampled);
+
+    this->lastSample = now;
+    return true;
+}
+
+Progress ProgressTracker::get() const{
+    std::lock_guard lock(this->mtx);
+    Progress progress;
+    progress.totalFiles = this->totalFiles;
+    progress.processedFiles = this->processedFiles;
+    progress.totalBytes = this->totalBytes;
+    progress.processedBytes = this->completedBytes;
+    if(this->currentDevice != nullptr)
+        progress.processedBytes += std::min<qint64>(this->fileBytes, this->currentPlannedBytes);
+    progress.bytesPerSecond = this->bytesPerSecond;
+    if(this->bytesPerSecond > 0)
+        progress.etaSeconds = static_cast<qint64>(std::ceil(std::max<qint64>(this->totalBytes - progress.processedBytes, 0) / this->bytesPerSecond));
+
+    for(const auto& [id, device] : this->devices)
+        progress.devices.push_back(DeviceProgress{device.name, this->readBytes(device), device.bytesPerSecond});
+    return progress;
+}
+
+qint64 ProgressTracker::readBytes(const Device& device) const{
+    return &device == this->currentDevice ? device.bytes + this->fileBytes : device.bytes;
+}
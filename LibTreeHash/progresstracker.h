@@ -0,0 +1,96 @@
+#ifndef PROGRESSTRACKER_H
+#define PROGRESSTRACKER_H
+
+#include <QString>
+#include <atomic>
+#include <chrono>
+#include <map>
+#include <mutex>
+#include "libtreehash.h"
+
+namespace TreeHash{
+
+/**
+ * @brief counts the processed files and bytes of a run and computes the moving average of the throughput (per device);
+ *      the files are processed by one thread while the bytes may be added and the progress read by any thread
+ */
+class ProgressTracker{
+public:
+
+    /// weight of the newest sample in the moving averages
+    static constexpr double SMOOTHING = 0.3;
+
+    /**
+     * @brief resets the progress for a new run
+     * @param totalFiles count of all files of the run
+     * @param totalBytes size of the files which will be read
+     */
+    void start(qint64 totalFiles, qint64 totalBytes);
+
+    /**
+     * @brief marks the begin of reading a file
+     * @param path the file (its device is determined by it)
+     * @param plannedBytes the size of the file as counted in totalBytes
+     */
+    void startFile(const QString& path, qint64 plannedBytes);
+    /**
+     * @brief marks the file as processed (also called for files which were not read)
+     */
+    void finishFile();
+
+    void addBytes(qint64 n){
+        this->fileBytes += n;
+    }
+    /**
+     * @brief returns the count of bytes read from the current file
+     */
+    qint64 currentFileBytes() const{
+        return this->fileBytes;
+    }
+    /**
+     * @brief returns the mount-point of the device of the current file
+     */
+    QString currentDeviceName() const;
+
+    /**
+     * @brief takes a sample of the throughput if the interval elapsed since the last one
+     * @param force take it even if the interval did not elapse
+     * @return true if a sample was taken
+     */
+    bool update(std::chrono::milliseconds interval, bool force);
+
+    Progress get() const;
+
+private:
+    struct Device{
+        QString name;
+        /// bytes read from the completed files
+        qint64 bytes = 0;
+        /// bytes read at the last sample
+        qint64 sampledBytes = 0;
+        double bytesPerSecond = 0;
+        bool sampled = false;
+    };
+
+    mutable std::mutex mtx;
+    qint64 totalFiles = 0, totalBytes = 0;
+    qint64 processedFiles = 0;
+    /// the planned bytes of the completed files
+    qint64 completedBytes = 0;
+    double bytesPerSecond = 0;
+    qint64 sampledBytes = 0;
+    bool sampled = false;
+    std::chrono::steady_clock::time_point lastSample;
+
+    std::map<quint64, Device> devices;
+    Device* currentDevice = nullptr;
+    qint64 currentPlannedBytes = 0;
+    std::atomic<qint64> fileBytes = 0;
+
+    /// returns the bytes read from the device (including the current file); mtx must be locked
+    qint64 readBytes(const Device& device) const;
+};
+
+}
+
+#endif // PROGRESSTRACKER_H
@@ -0,0 +1,57 @@
+#include "tracer.h"
+#include <QSaveFile>
+#include <algorithm>
+
+using namespace TreeHash;
+
+Tracer::Tracer(size_t capacity)
+    : capacity(std::max<size_t>(capacity, 1))
+{
+    this->start(1);
+}
+
+void Tracer::start(size_t lanes){
+    this->origin = Clock::now();
+    this->lanes.resize(std::max<size_t>(lanes, 1));
+    for(Lane& lane : this->lanes)
+        lane.next = 0;
+}
+
+bool Tracer::write(const QString& path, QString* error) const{
+    // timestamps are microseconds since the start of the run
+    const auto micros = [this](Clock::time_point t) -> double{
+        return std::chrono::duration<double, std::micro>(t - this->origin).count();
+    };
+
+    QByteArray out;
+    out.reserve(1024 * 1024);
+    out.append("{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+    out.append("{\"name\":\"process_name\",\"ph\":\"M\",\"pid\":1,\"tid\":0,\"args\":{\"name\":\"TreeHash\"}}");
+    for(size_t i = 0; i < this->lanes.size(); i++){
+        const Lane& lane = this->lanes[i];
+        out.append(",\n{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":").append(QByteArray::number(static_cast<qint64>(i)))
+            .append(",\"args\":{\"name\":\"").append(i == 0 ? "run" : QByteArray("block-verify ") + QByteArray::number(static_cast<qint64>(i)))
+            .append("\"}}");
+
+        // the oldest span is the next one to be overwritten
+        const size_t count = std::min(lane.next, this->capacity);
+        const size_t first = lane.next > this->capacity ? lane.next % this->capacity : 0;
+        for(size_t j = 0; j < count; j++){
+            const Span& span = lane.spans[(first + j) % this->capacity];
+            out.append(",\n{\"name\":\"").append(span.name)
+                .append("\",\"ph\":\"X\",\"pid\":1,\"tid\":").append(QByteArray::number(static_cast<qint64>(i)))
+                .append(",\"ts\":").append(QByteArray::number(micros(span.begin), 'f', 3))
+                .append(",\"dur\":").append(QByteArray::number(micros(span.end) - micros(span.begin), 'f', 3))
+                .append('}');
+        }
+    }
+    out.append("\n]}\n");
+
+    QSaveFile file(path);
+    if(!file.open(QFile::OpenModeFlag::WriteOnly) || file.write(out) != out.size() || !file.commit()){
+        if(error != nullptr)
+            *error = file.errorString();
+        return false;
+    }
+    return true;
+}
@@ -0,0 +1,67 @@
+#ifndef TRACER_H
+#define TRACER_H
+
+#include <QString>
+#include <chrono>
+#include <memory>
+#include <vector>
+
+namespace TreeHash{
+
+/**
+ * @brief records spans (named time ranges) of a run and writes them as Chrome trace-event JSON (loadable in Perfetto);
+ *      every lane (the thread of the run and each block-verify thread) has its own ring-buffer which keeps the newest spans,
+ *      so that recording needs no lock
+ */
+class Tracer{
+public:
+
+    using Clock = std::chrono::steady_clock;
+
+    /**
+     * @param capacity max count of spans per lane
+     */
+    explicit Tracer(size_t capacity);
+
+    /**
+     * @brief drops the recorded spans and prepares the lanes for a run
+     * @param lanes count of lanes (lane 0 is the thread of the run)
+     */
+    void start(size_t lanes);
+
+    /**
+     * @brief records a span; a lane must only be used by one thread at a time
+     * @param name name of the span (must be a literal, it is not copied)
+     */
+    void record(size_t lane, const char* name, Clock::time_point begin, Clock::time_point end){
+        Lane& l = this->lanes[lane];
+        if(l.spans.empty())
+            l.spans.resize(this->capacity);
+        l.spans[l.next % this->capacity] = Span{name, begin, end};
+        l.next++;
+    }
+
+    /**
+     * @brief writes the recorded spans as trace-event JSON (replaces the file atomically)
+     */
+    bool write(const QString& path, QString* error) const;
+
+private:
+    struct Span{
+        const char* name;
+        Clock::time_point begin, end;
+    };
+    struct Lane{
+        std::vector<Span> spans;
+        /// count of all recorded spans (the older ones were overwritten)
+        size_t next = 0;
+    };
+
+    const size_t capacity;
+    Clock::time_point origin;
+    std::vector<Lane> lanes;
+};
+
+}
+
+#endif // TRACER_H
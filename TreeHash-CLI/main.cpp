@@ -4,6 +4,9 @@
 #include <QDir>
 #include <QFile>
 #include <QMetaEnum>
+#include <QSaveFile>
+#include <QDateTime>
+#include <csignal>
 #include "libtreehash.h"
 
 /* exit codes:
@@ -12,9 +15,154 @@
  * -2 => error from LibTreeHash
  * 1 => >= 1 file was unsuccessful
  * 2 => if an error occurred
+ * 3 => the run was interrupted (SIGINT / SIGTERM); the progress was saved
+ * 4 => the run stopped at the first unsuccessful file or error (--fail-fast)
  */
 
 namespace{
+/// the instance which is stopped by SIGINT / SIGTERM
+TreeHash::LibTreeHash* runningTreeHash = nullptr;
+
+/// counted by the EventListener for --metrics
+qint64 unsuccessfulFiles = 0;
+qint64 errorCount = 0;
+
+void onStopSignal(int){
+    if(runningTreeHash != nullptr)
+        runningTreeHash->requestStop();
+}
+
+/**
+ * installs a handler for SIGINT and SIGTERM which stops the run (a second signal terminates immediately)
+ */
+void installStopHandler(TreeHash::LibTreeHash& treeHash){
+    runningTreeHash = &treeHash;
+
+    struct sigaction action = {};
+    action.sa_handler = onStopSignal;
+    action.sa_flags = SA_RESETHAND;
+    sigemptyset(&action.sa_mask);
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+}
+
+void removeStopHandler(){
+    std::signal(SIGINT, SIG_DFL);
+    std::signal(SIGTERM, SIG_DFL);
+    runningTreeHash = nullptr;
+}
+
+QString formatBytes(double bytes){
+    static const char* const UNITS[] = {"B", "KiB", "MiB", "GiB", "TiB", "PiB"};
+    int unit = 0;
+    while(bytes >= 1024 && unit < 5){
+        bytes /= 1024;
+        unit++;
+    }
+    return QStringLiteral("%1 %2").arg(bytes, 0, 'f', unit == 0 ? 0 : 1).arg(UNITS[unit]);
+}
+
+QString formatDuration(qint64 seconds){
+    if(seconds < 0)
+        return QStringLiteral("?");
+    if(seconds >= 3600)
+        return QStringLiteral("%1h%2m").arg(seconds / 3600).arg(seconds / 60 % 60, 2, 10, QChar('0'));
+    return QStringLiteral("%1m%2s").arg(seconds / 60).arg(seconds % 60, 2, 10, QChar('0'));
+}
+
+/**
+ * prints the progress into one line of stderr, which is overwritten by the next one
+ */
+void printProgress(const TreeHash::Progress& progress, qsizetype& lastLength){
+    const double percent = progress.totalBytes > 0 ? 100.0 * progress.processedBytes / progress.totalBytes : 100.0;
+    QString line = QStringLiteral("files %1/%2, %3 of %4 (%5 %), %6/s, ETA %7")
+                       .arg(progress.processedFiles).arg(progress.totalFiles)
+                       .arg(formatBytes(progress.processedBytes), formatBytes(progress.totalBytes))
+                       .arg(percent, 0, 'f', 1)
+                       .arg(formatBytes(progress.bytesPerSecond), formatDuration(progress.etaSeconds));
+    if(progress.devices.size() > 1){
+        QStringList devices;
+        for(const TreeHash::DeviceProgress& device : progress.devices)
+            devices.append(QStringLiteral("%1: %2/s").arg(device.device, formatBytes(device.bytesPerSecond)));
+        line += QStringLiteral(" [%1]").arg(devices.join(", "));
+    }
+
+    const qsizetype length = line.size();
+    if(length < lastLength)
+        line += QString(lastLength - length, ' ');
+    lastLength = length;
+    std::cerr << '\r' << line.toStdString() << std::flush;
+}
+
+std::vector<std::pair<QString, TreeHash::StageStats>> listStages(const TreeHash::RunStats& stats){
+    return {
+        {"load", stats.load}, {"plan", stats.plan}, {"open", stats.open}, {"read", stats.read},
+        {"hash", stats.hash}, {"save", stats.save}, {"total", stats.total}
+    };
+}
+
+QString formatStats(const TreeHash::RunStats& stats){
+    const std::vector<std::pair<QString, TreeHash::StageStats>> stages = listStages(stats);
+
+    QString msg = QStringLiteral("%1 %2 %3\n").arg("stage", -5).arg("seconds", 12).arg("calls", 8);
+    for(const auto& [name, stage] : stages){
+        msg += QStringLiteral("%1 %2 %3\n").arg(name, -5).arg(stage.nanoseconds / 1e9, 12, 'f', 3).arg(stage.calls, 8);
+    }
+    msg += QStringLiteral("files: %1 (read: %2, skipped: %3, continued from a saved state: %4); read: %5 bytes\n")
+               .arg(stats.files).arg(stats.readFiles).arg(stats.skippedFiles).arg(stats.continuedFiles).arg(stats.readBytes);
+    return msg;
+}
+
+/**
+ * writes the progress and the stats of the run as OpenMetrics text-file (e.g. for the textfile-collector of node_exporter);
+ * the file is replaced atomically
+ */
+void writeMetrics(const QString& path, const QString& mode, const TreeHash::LibTreeHash& treeHash, bool finished){
+    const TreeHash::Progress progress = treeHash.getProgress();
+    const TreeHash::RunStats stats = treeHash.getRunStats();
+    const QString labels = QStringLiteral("mode=\"%1\"").arg(mode);
+
+    QString out;
+    const auto gauge = [&out, &labels](const QString& name, const QString& help, const QString& value) -> void{
+        out += QStringLiteral("# HELP treehash_%1 %2\n# TYPE treehash_%1 gauge\n").arg(name, help);
+        out += QStringLiteral("treehash_%1{%2} %3\n").arg(name, labels, value);
+    };
+    gauge("run_finished", "1 if the run finished, 0 while it is running", QString::number(finished ? 1 : 0));
+    gauge("run_interrupted", "1 if the run was stopped before all files were processed", QString::number(treeHash.wasInterrupted() ? 1 : 0));
+    gauge("timestamp_seconds", "time at which this file was written", QString::number(QDateTime::currentSecsSinceEpoch()));
+    gauge("files", "count of all files of the run", QString::number(progress.totalFiles));
+    gauge("files_processed", "count of the processed files", QString::number(progress.processedFiles));
+    gauge("files_unsuccessful", "count of the unsuccessful files (e.g. mismatches in verify)", QString::number(unsuccessfulFiles));
+    gauge("errors", "count of the errors", QString::number(errorCount));
+    gauge("bytes", "size of the files which are read", QString::number(progress.totalBytes));
+    gauge("bytes_read", "bytes read from the files", QString::number(stats.readBytes));
+    gauge("throughput_bytes_per_second", "moving average of the throughput", QString::number(progress.bytesPerSecond, 'f', 0));
+    gauge("eta_seconds", "estimated remaining time (-1 if unknown)", QString::number(progress.etaSeconds));
+    gauge("index_entries", "count of the entries of the hash-file", QString::number(treeHash.getEntryCount()));
+
+    const std::vector<std::pair<QString, TreeHash::StageStats>> stages = listStages(stats);
+    out += QStringLiteral("# HELP treehash_stage_seconds time spent in a stage of the run (--stats)\n# TYPE treehash_stage_seconds gauge\n");
+    for(const auto& [name, stage] : stages)
+        out += QStringLiteral("treehash_stage_seconds{%1,stage=\"%2\"} %3\n").arg(labels, name).arg(stage.nanoseconds / 1e9, 0, 'f', 6);
+    out += QStringLiteral("# HELP treehash_stage_calls how often a stage of the run was entered (--stats)\n# TYPE treehash_stage_calls gauge\n");
+    for(const auto& [name, stage] : stages)
+        out += QStringLiteral("treehash_stage_calls{%1,stage=\"%2\"} %3\n").arg(labels, name).arg(stage.calls);
+    out += QStringLiteral("# EOF\n");
+
+    QSaveFile file(path);
+    if(!file.open(QFile::OpenModeFlag::WriteOnly) || file.write(out.toUtf8()) < 0 || !file.commit())
+        std::cerr << QStringLiteral("unable to write metrics (%1)\n").arg(file.errorString()).toStdString();
+}
+
+QString formatSlowFiles(const std::vector<TreeHash::FileTiming>& slowest){
+    QString msg = QStringLiteral("%1 %2 %3  %4\n").arg("seconds", 10).arg("size", 10).arg("throughput", 12).arg("file");
+    for(const TreeHash::FileTiming& timing : slowest){
+        msg += QStringLiteral("%1 %2 %3  %4\n").arg(timing.duration.count() / 1e6, 10, 'f', 3)
+                   .arg(formatBytes(timing.bytes), 10).arg(formatBytes(timing.bytesPerSecond) + "/s", 12).arg(timing.path);
+    }
+    return msg;
+}
+
 QStringList listFiles(QCommandLineParser& args){
     const QDir root(args.value("r"));
     QFileInfo fi;
@@ -142,6 +290,7 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
 
             if(exitCode < 1)
                 exitCode = 1;
+            unsuccessfulFiles++;
         }else{
             if(loglevel >= 3){
                 if(hashfileFromStdin)
@@ -169,8 +318,44 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
 
         if(exitCode < 2)
             exitCode = 2;
+        errorCount++;
+    };
+    eventListener.onCorruptRange = [loglevel, hashfileFromStdin](QString path, qint64 offset, qint64 length) -> void{
+        if(loglevel >= 1){
+            if(hashfileFromStdin)
+                std::cerr << QStringLiteral("CORRUPT: bytes %1-%2 @ %3\n").arg(offset).arg(offset + length - 1).arg(path).toStdString();
+            else
+                std::cout << QStringLiteral("CORRUPT: bytes %1-%2 @ %3\n").arg(offset).arg(offset + length - 1).arg(path).toStdString();
+        }
+    };
+
+    eventListener.onChunkChanges = [loglevel, hashfileFromStdin](QString path, qint64 changedChunks, qint64 chunkCount, qint64 changedBytes) -> void{
+        if(loglevel >= 3){
+            if(hashfileFromStdin)
+                std::cerr << QStringLiteral("file changed: %1 of %2 chunks (%3 bytes) @ %4\n")
+                                 .arg(changedChunks).arg(chunkCount).arg(changedBytes).arg(path).toStdString();
+            else
+                std::cout << QStringLiteral("file changed: %1 of %2 chunks (%3 bytes) @ %4\n")
+                                 .arg(changedChunks).arg(chunkCount).arg(changedBytes).arg(path).toStdString();
+        }
     };
 
+    if(args.isSet("progress") || args.isSet("metrics")){
+        const bool showProgress = args.isSet("progress");
+        const QString metricsPath = args.value("metrics");
+        const QString mode = args.value("m");
+        auto lastMetrics = std::chrono::steady_clock::now();
+        eventListener.onProgress = [showProgress, metricsPath, mode, &treeHash, lastMetrics, lastLength = qsizetype(0)]
+                (const TreeHash::Progress& progress) mutable -> void{
+            if(showProgress)
+                printProgress(progress, lastLength);
+            if(!metricsPath.isEmpty() && std::chrono::steady_clock::now() - lastMetrics >= std::chrono::seconds(15)){
+                lastMetrics = std::chrono::steady_clock::now();
+                writeMetrics(metricsPath, mode, treeHash, false);
+            }
+        };
+    }
+
     treeHash = TreeHash::LibTreeHash(eventListener);
 
     if(needsMode){
@@ -184,6 +369,10 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
             mode = TreeHash::RunMode::UPDATE_MODIFIED;
         }else if(modeStr == "verify"){
             mode = TreeHash::RunMode::VERIFY;
+        }else if(modeStr == "verify_quick"){
+            mode = TreeHash::RunMode::VERIFY_QUICK;
+        }else if(modeStr == "sync"){
+            mode = TreeHash::RunMode::SYNC;
         }else{
             std::cerr << "mode has an invalid value\n\n";
             args.showHelp(-1);
@@ -208,6 +397,138 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
         }
     }
 
+    if(args.isSet("format")){
+        const QString formatStr = args.value("format");
+        if(formatStr == "json"){
+            treeHash.setHashFileFormat(TreeHash::HashFileFormat::JSON);
+        }else if(formatStr == "binary"){
+            treeHash.setHashFileFormat(TreeHash::HashFileFormat::BINARY);
+        }else{
+            std::cerr << "invalid hashfile-format\n";
+            exitCode = -1;
+            return false;
+        }
+    }
+
+    if(args.isSet("compact"))
+        treeHash.setCompactHashFile(true);
+
+    // a verify-budget records the verifications of every run -> only append them instead of rewriting the hash-file
+    const bool useJournal = args.isSet("journal") || args.isSet("resume")
+            || args.isSet("verify-budget") || args.isSet("verify-budget-size");
+    if(useJournal && hashfileFromStdin){
+        std::cerr << "the journal (also used by --resume and --verify-budget) can not be used if the hash-file is read from stdin\n";
+        exitCode = -1;
+        return false;
+    }
+
+    if(args.isSet("checkpoint") || args.isSet("checkpoint-size")){
+        bool validSecs = true, validSize = true;
+        const qint64 seconds = args.isSet("checkpoint") ? args.value("checkpoint").toLongLong(&validSecs) : 0;
+        const qint64 mebibytes = args.isSet("checkpoint-size") ? args.value("checkpoint-size").toLongLong(&validSize) : 0;
+        if(!validSecs || !validSize || seconds < 0 || mebibytes < 0){
+            std::cerr << "invalid checkpoint-interval\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setCheckpointInterval(seconds, mebibytes * 1024 * 1024);
+    }
+    treeHash.setResume(args.isSet("resume"));
+
+    if(args.isSet("keep-hash-state")){
+        bool valid;
+        const qint64 mebibytes = args.value("keep-hash-state").toLongLong(&valid);
+        if(!valid || mebibytes < 0){
+            std::cerr << "invalid min size for keeping the hash-state\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setHashStateMinSize(mebibytes * 1024 * 1024);
+    }
+
+    if(args.isSet("block-hashes")){
+        bool valid;
+        const qint64 mebibytes = args.value("block-hashes").toLongLong(&valid);
+        if(!valid || mebibytes <= 0 || mebibytes > 1024){
+            std::cerr << "invalid block-size (must be between 1 and 1024 MiB)\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setBlockSize(mebibytes * 1024 * 1024);
+    }
+    if(args.isSet("chunk-index")){
+        bool valid;
+        const qint64 kibibytes = args.value("chunk-index").toLongLong(&valid);
+        if(!valid || kibibytes < 4 || kibibytes > 64 * 1024){
+            std::cerr << "invalid chunk-size (must be between 4 and 65536 KiB)\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setChunkSize(kibibytes * 1024);
+    }
+    if(args.isSet("sample") || args.isSet("seed")){
+        bool valid = true;
+        const double percent = args.isSet("sample") ? args.value("sample").toDouble(&valid) : 100.0;
+        if(!valid || percent <= 0.0 || percent > 100.0){
+            std::cerr << "invalid sample rate (must be more than 0 and at most 100 %)\n";
+            exitCode = -1;
+            return false;
+        }
+        quint64 seed = treeHash.getSampleSeed();
+        if(args.isSet("seed")){
+            seed = args.value("seed").toULongLong(&valid);
+            if(!valid){
+                std::cerr << "invalid seed\n";
+                exitCode = -1;
+                return false;
+            }
+        }
+        treeHash.setSampleRate(percent / 100.0, seed);
+    }
+    if(args.isSet("verify-budget") || args.isSet("verify-budget-size")){
+        bool valid = true;
+        const qint64 minutes = args.isSet("verify-budget") ? args.value("verify-budget").toLongLong(&valid) : 0;
+        if(!valid || minutes < 0){
+            std::cerr << "invalid verify-budget\n";
+            exitCode = -1;
+            return false;
+        }
+        const qint64 gibibytes = args.isSet("verify-budget-size") ? args.value("verify-budget-size").toLongLong(&valid) : 0;
+        if(!valid || gibibytes < 0){
+            std::cerr << "invalid verify-budget-size\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setVerifyBudget(minutes * 60, gibibytes * 1024 * 1024 * 1024);
+    }
+    // a budget only cycles through the tree if the verifications are recorded
+    treeHash.setRecordVerified(args.isSet("record-verified") || args.isSet("verify-budget") || args.isSet("verify-budget-size"));
+    treeHash.setEscalateSuspects(args.isSet("escalate"));
+    treeHash.setFailFast(args.isSet("fail-fast"));
+    treeHash.setCollectStats(args.isSet("stats") || args.isSet("metrics"));
+    if(args.isSet("trace"))
+        treeHash.setTraceFile(args.value("trace"));
+    if(args.isSet("slowest")){
+        bool valid;
+        const int count = args.value("slowest").toInt(&valid);
+        if(!valid || count < 1){
+            std::cerr << "invalid count for slowest\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setSlowFileReport(count);
+    }
+    if(args.isSet("threads")){
+        bool valid;
+        const int threads = args.value("threads").toInt(&valid);
+        if(!valid || threads < 1){
+            std::cerr << "invalid thread count\n";
+            exitCode = -1;
+            return false;
+        }
+        treeHash.setThreadCount(threads);
+    }
+
     if(!hashfileFromStdin){
         QFileInfo hashfileInfo(args.value("f"));
         if(hashfileInfo.exists()){
@@ -217,7 +538,7 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
                 return false;
             }
         }else{
-            if(treeHash.getRunMode() == TreeHash::RunMode::VERIFY){
+            if(treeHash.getRunMode() == TreeHash::RunMode::VERIFY || treeHash.getRunMode() == TreeHash::RunMode::VERIFY_QUICK){
                 std::cerr << "hash-file does not exist\n";
                 exitCode = -1;
                 return false;
@@ -225,7 +546,8 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
         }
     }
 
-    treeHash.setFiles(listFiles(args));
+    if(needsMode)// clean and check-removed list the files themselves (if they need them at all)
+        treeHash.setFiles(listFiles(args));
     treeHash.setHmacKey(args.value("k"));
 
     if(hashfileFromStdin){
@@ -246,6 +568,8 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
         treeHash.setHashesFile(std::move(in), std::move(out), false);
     }else{
         treeHash.setHashesFilePath(args.value("f"));
+        if(useJournal)
+            treeHash.setJournalEnabled(true);
     }
 
     if(args.isSet("r")){
@@ -267,6 +591,25 @@ bool initLibTreeHash(QCommandLineParser& args, TreeHash::LibTreeHash& treeHash,
     return true;
 }
 
+/**
+ * decides if removed files should be found by probing the paths from the hashfile instead of walking the tree
+ * (-i can only be honoured by walking; -e only if the caller filters the result afterwards;
+ * probing follows symlinks, so --no-linked-dirs and --no-linked-files can only be honoured by walking)
+ */
+bool useProbing(QCommandLineParser& args, const TreeHash::LibTreeHash& treeHash, bool filtersExcludes){
+    if(args.isSet("i") || (!filtersExcludes && args.isSet("e")))
+        return false;
+    if(args.isSet("no-linked-dirs") || args.isSet("no-linked-files"))
+        return false;
+
+    const QString strategy = args.value("removed-strategy");
+    if(strategy == "walk")
+        return false;
+    if(strategy == "probe")
+        return true;
+    return treeHash.chooseRemovedFilesStrategy() == TreeHash::RemovedFilesStrategy::PROBE_INDEX;
+}
+
 void setupCommands(QCommandLineParser& parser){
     parser.setSingleDashWordOptionMode(QCommandLineParser::SingleDashWordOptionMode::ParseAsCompactedShortOptions);
     parser.setOptionsAfterPositionalArgumentsMode(QCommandLineParser::OptionsAfterPositionalArgumentsMode::ParseAsOptions);
@@ -274,7 +617,8 @@ void setupCommands(QCommandLineParser& parser){
     parser.addOptions({
         {{"m", "mode"},
             "mode of operation",
-            "'update', 'update_new', 'update_mod' or 'verify'"},
+            "'update', 'update_new', 'update_mod', 'sync' (update_mod + update_new + -c in one pass), 'verify' "
+                "or 'verify_quick' (compare only size, mtime, ctime and inode)"},
         {{"l", "loglevel"},
             "sets the verbosity of the log ('w' is default)",
             "'q' -> print nothing, 'e' -> show only errors, 'w' -> show errors and warnings, 'a' -> show errors, warnings and processed files"},
@@ -298,10 +642,86 @@ void setupCommands(QCommandLineParser& parser){
             "cleans the hash-file: removes all files which does not exist any-more (can be used with -e and -i) (it might be smart to make a backup of the file)"},
         {"check-removed",
             "checks if any files from the hashfile does not exist any-more (can be used with -e and -i)"},
+        {"removed-strategy",
+            "how -c and --check-removed find removed files (ignored if -i, --no-linked-dirs or --no-linked-files is set; -c also walks if -e is set)",
+            "'auto' (default) -> choose by size of hashfile and tree, 'walk' -> list all files of the tree, 'probe' -> stat only the paths from the hashfile"},
         {"no-linked-dirs",
             "exclude linked directories from scan"},
         {"no-linked-files",
             "exclude linked files from scan"},
+        {"format",
+            "set the format in which the hash-file will be saved (default is the format of the loaded file or 'json' for new files); "
+                "can be used to convert an existing hash-file",
+            "'json' or 'binary'"},
+        {"compact",
+            "write the hash-file (format 'json') without indentation and line-breaks"},
+        {"journal",
+            "append changes to a journal next to the hash-file instead of rewriting it (it is folded into the hash-file when it gets big)"},
+        {"checkpoint",
+            "save the progress of an update at least every n seconds (without --journal this rewrites the whole hash-file)",
+            "seconds"},
+        {"checkpoint-size",
+            "save the progress of an update at least every n MiB of hashed data",
+            "MiB"},
+        {"resume",
+            "continue the last update if it was interrupted: skip files which it already processed and which were not modified since (implies --journal)"},
+        {"keep-hash-state",
+            "store the state of the hash-function for files of at least n MiB, so that 'update_mod' only hashes the appended data "
+                "of files which only grew (e.g. logs)",
+            "MiB"},
+        {"block-hashes",
+            "additionally store a hash for every block of n MiB of files bigger than one block, "
+                "so that 'verify' can check them in parallel and report the corrupt ranges",
+            "MiB"},
+        {"chunk-index",
+            "additionally store a list of content-defined chunks (of n KiB on average) of files, "
+                "so that 'update_mod' reports how much of a modified file changed (shown with '-l a')",
+            "KiB"},
+        {"sample",
+            "let 'verify' check only the given percentage of the blocks of files with block-hashes (chosen at random; "
+                "files without block-hashes are checked completely) and print the coverage",
+            "percent"},
+        {"seed",
+            "the seed for choosing the blocks with --sample (printed with the coverage; random by default)",
+            "n"},
+        {"fail-fast",
+            "stop at the first unsuccessful file or error (e.g. a mismatch in 'verify') and exit with code 4; "
+                "the file which is being hashed is abandoned"},
+        {"escalate",
+            "let 'verify_quick' hash the files whose metadata (besides the size) differs instead of failing them"},
+        {"record-verified",
+            "let 'verify' store the time at which a file was found intact in the hash-file (lastVerified)"},
+        {"verify-budget",
+            "stop 'verify' after n minutes; the files which were not verified for the longest time are verified first "
+                "(implies --record-verified and --journal), so that consecutive runs cycle through the whole tree",
+            "minutes"},
+        {"verify-budget-size",
+            "like --verify-budget but stop after n GiB of verified files",
+            "GiB"},
+        {"progress",
+            "show the count of processed files and bytes, the throughput (per device if more than one is read) "
+                "and the estimated remaining time on stderr"},
+        {"stats",
+            "print the time spent in each stage (loading the hash-file, planning, opening, reading, hashing, saving) "
+                "and how often it was entered, and counts of the processed files and bytes"},
+        {"metrics",
+            "write the progress and the stats (see --stats) of the run as OpenMetrics text-file (e.g. for the textfile-collector "
+                "of node_exporter) every 15 seconds and at the end; the file is replaced atomically",
+            "file-path"},
+        {"trace",
+            "record what the threads of the run do (plan, open, read, hash, index update, save) and write it as Chrome "
+                "trace-event JSON (open it in Perfetto); only the newest 65536 spans of every thread are kept",
+            "file-path"},
+        {"slowest",
+            "print the n files which took the longest to read; files of at least 1 MiB whose throughput is below "
+                "a tenth of the median of their device are reported as warning",
+            "n"},
+        {"dry-run",
+            "only print how many files (and bytes) the mode would read, skip or fail (decided by the file-sizes, modification-times "
+                "and the hash-file without reading any file); nothing is changed"},
+        {"threads",
+            "count of threads which verify the blocks of a file with block-hashes (default 1)",
+            "n"},
         {"hash-alg",
             "set the algorithm to use for computing the hashes",
             "Sha256, Sha512, Sha3_256, Sha3_512, Keccak_256, Keccak_512 (default), Blake2b_256, Blake2b_512"}
@@ -317,7 +737,71 @@ int execNormal(QCommandLineParser& args){
         int exitCode = 0;
 
         if(initLibTreeHash(args, treeHash, exitCode, true)){
-            treeHash.run();
+            if(args.isSet("dry-run")){
+                const TreeHash::RunPlan plan = treeHash.dryRun();
+                const QString msg = QStringLiteral("files to read: %1 (%2 bytes)\nfiles to skip: %3 (%4 bytes)\n"
+                                                   "size differs from hash-file: %5\nmetadata differs from hash-file: %6\n"
+                                                   "no saved hash: %7\nnot a file or malformed entry: %8\n")
+                                        .arg(plan.hashFiles).arg(plan.hashBytes).arg(plan.skippedFiles).arg(plan.skippedBytes)
+                                        .arg(plan.sizeMismatches).arg(plan.suspectFiles).arg(plan.missingEntries).arg(plan.invalidFiles);
+                if(args.value("f") == "-")
+                    std::cerr << msg.toStdString();
+                else
+                    std::cout << msg.toStdString();
+                return exitCode;
+            }
+
+            installStopHandler(treeHash);
+            const TreeHash::RunStats stats = treeHash.run();
+            removeStopHandler();
+            if(args.isSet("progress"))
+                std::cerr << '\n';// end the progress-line
+
+            if(args.isSet("metrics"))
+                writeMetrics(args.value("metrics"), args.value("m"), treeHash, true);
+
+            if(args.isSet("stats")){
+                // the report must not mix with the hash-file on stdout
+                if(args.value("f") == "-")
+                    std::cerr << formatStats(stats).toStdString();
+                else
+                    std::cout << formatStats(stats).toStdString();
+            }
+
+            if(args.isSet("slowest")){
+                // the report must not mix with the hash-file on stdout
+                if(args.value("f") == "-")
+                    std::cerr << formatSlowFiles(treeHash.getSlowestFiles()).toStdString();
+                else
+                    std::cout << formatSlowFiles(treeHash.getSlowestFiles()).toStdString();
+            }
+
+            if(args.isSet("sample") && treeHash.getRunMode() == TreeHash::RunMode::VERIFY && args.value("l") != "q"){
+                const TreeHash::SampleCoverage coverage = treeHash.getSampleCoverage();
+                const double percent = coverage.totalBytes > 0 ? 100.0 * coverage.checkedBytes / coverage.totalBytes : 100.0;
+                const QString msg = QStringLiteral("coverage: checked %1 of %2 bytes (%3 %) in %4 sampled files; seed %5\n")
+                                        .arg(coverage.checkedBytes).arg(coverage.totalBytes).arg(percent, 0, 'f', 2)
+                                        .arg(coverage.sampledFiles).arg(treeHash.getSampleSeed());
+                // the report must not mix with the hash-file on stdout
+                if(args.value("f") == "-")
+                    std::cerr << msg.toStdString();
+                else
+                    std::cout << msg.toStdString();
+            }
+
+            if(treeHash.wasBudgetExhausted())
+                std::cerr << "verify-budget used up; the files which were not verified are the first ones of the next run\n";
+
+            if(treeHash.wasStoppedOnFailure()){
+                std::cerr << "stopped at the first failure\n";
+                exitCode = 4;
+            }else if(treeHash.wasInterrupted()){
+                if(treeHash.getRunMode() == TreeHash::RunMode::VERIFY || treeHash.getRunMode() == TreeHash::RunMode::VERIFY_QUICK)
+                    std::cerr << "interrupted\n";
+                else
+                    std::cerr << "interrupted; the processed files were saved (continue with --resume)\n";
+                exitCode = 3;
+            }
         }
 
         return exitCode;
@@ -333,8 +817,12 @@ int execClean(QCommandLineParser& args){
         int exitCode = 0;
 
         if(initLibTreeHash(args, treeHash, exitCode, false)){
-            QStringList keep = listFiles(args);
-            treeHash.cleanHashFile(keep);
+            if(useProbing(args, treeHash, false)){
+                treeHash.cleanRemovedFiles();
+            }else{
+                QStringList keep = listFiles(args);
+                treeHash.cleanHashFile(keep);
+            }
         }
 
         return exitCode;
@@ -350,8 +838,13 @@ int execRemoved(QCommandLineParser& args){
         int exitCode = 0;
 
         if(initLibTreeHash(args, treeHash, exitCode, false)){
-            QStringList existing = listFiles(args);
-            QStringList missing = treeHash.checkForRemovedFiles(existing);
+            QStringList missing;
+            if(useProbing(args, treeHash, true)){
+                missing = treeHash.probeForRemovedFiles();
+            }else{
+                QStringList existing = listFiles(args);
+                missing = treeHash.checkForRemovedFiles(existing);
+            }
 
             if(exitCode == 0){// errors would change exitCode in eventListener
                 // remove all excluded files from missing
@@ -402,6 +895,15 @@ int exec(QCommandLineParser& parser){
         return -1;
     }
 
+    if(parser.isSet("removed-strategy")){
+        const QString strategy = parser.value("removed-strategy");
+        if(strategy != "auto" && strategy != "walk" && strategy != "probe"){
+            std::cerr << "removed-strategy has an invalid value\n\n";
+            parser.showHelp(-1);
+            return -1;
+        }
+    }
+
     // detect mode (clean or normal) and execute
     if(parser.isSet("c")){
         // check for incompatible options